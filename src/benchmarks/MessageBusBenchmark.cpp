@@ -0,0 +1,305 @@
+/**
+ * @brief MessageBus 发布开销基准测试
+ *
+ * 模拟手势期间的高频主题（MAP_CENTER_CHANGED），比较：
+ *   legacy   旧实现：QMultiHash::values() 复制订阅者，按槽函数名 invokeMethod
+ *   string   按主题名发布（内部换算为 TopicId），订阅时已解析 QMetaMethod
+ *   topicId  按预先登记的 TopicId 发布，槽函数订阅
+ *   functor  按 TopicId 发布，函数对象订阅
+ * 输出每次发布的平均耗时（ns）和相对旧实现的倍数。
+ *
+ * 随后是多线程压力测试：N 个发布线程同时向同一主题发布，订阅者在主线程
+ * （消息排队投递，主线程持续处理事件），另有一个线程不断订阅、取消订阅，
+ * 使订阅表在发布期间反复替换。输出各线程数下的总吞吐量，并核对投递数量。
+ *
+ * 用法：YEFSMessageBusBenchmark [--messages 1000000] [--subscribers 4] [--topics 64]
+ *                               [--threads 1,2,4,8] [--stress-messages 200000]
+ */
+
+#include "core/MessageBus.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMultiHash>
+#include <QPair>
+#include <QVariantMap>
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace YEFS;
+
+namespace {
+
+// ============================================================================
+// 旧实现（对照组）
+// ============================================================================
+
+class LegacyBus
+{
+public:
+    void publish(const QString& topic, const QVariant& data)
+    {
+        auto subscribers = m_subscribers.values(topic);
+        for (const auto& subscriber : subscribers) {
+            if (subscriber.first) {
+                QMetaObject::invokeMethod(subscriber.first, subscriber.second,
+                                          Qt::AutoConnection,
+                                          Q_ARG(QString, topic),
+                                          Q_ARG(QVariant, data));
+            }
+        }
+    }
+
+    void subscribe(const QString& topic, QObject* receiver, const char* slot)
+    {
+        m_subscribers.insert(topic, qMakePair(receiver, slot));
+    }
+
+private:
+    QMultiHash<QString, QPair<QObject*, const char*>> m_subscribers;
+};
+
+} // namespace
+
+// ============================================================================
+// 订阅者
+// ============================================================================
+
+class Receiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    quint64 received = 0;
+
+public slots:
+    void onMessage(const QString& topic, const QVariant& data)
+    {
+        Q_UNUSED(topic)
+        Q_UNUSED(data)
+        ++received;
+    }
+};
+
+namespace {
+
+struct Result {
+    const char* name;
+    double nsPerPublish;
+};
+
+Result measure(const char* name, quint64 messages, const std::function<void(const QVariant&)>& publish)
+{
+    QVariantMap payload;
+    payload["latitude"] = 39.9042;
+    payload["longitude"] = 116.4074;
+    const QVariant data(payload);
+
+    // 预热
+    for (quint64 i = 0; i < messages / 10 + 1; ++i) {
+        publish(data);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (quint64 i = 0; i < messages; ++i) {
+        publish(data);
+    }
+    return {name, double(timer.nsecsElapsed()) / double(messages)};
+}
+
+struct StressResult {
+    int threads;
+    double messagesPerSecond;
+    quint64 published;
+    quint64 delivered;
+    quint64 churn;
+};
+
+StressResult stress(MessageBus* bus, MessageBus::TopicId topic, const QList<Receiver*>& sinks,
+                    int threads, quint64 messages)
+{
+    QVariantMap payload;
+    payload["latitude"] = 39.9042;
+    payload["longitude"] = 116.4074;
+    const QVariant data(payload);
+
+    quint64 before = 0;
+    for (const Receiver* sink : sinks) {
+        before += sink->received;
+    }
+
+    const quint64 perThread = qMax<quint64>(1, messages / quint64(threads));
+    std::atomic<int> running{threads};
+    std::atomic<bool> stop{false};
+    std::atomic<quint64> churn{0};
+
+    // 订阅表写端：在独立主题上反复订阅、取消订阅
+    std::thread churner([&]() {
+        QObject context;
+        const MessageBus::TopicId churnTopic = bus->topic(QStringLiteral("bench/stress/churn"));
+        while (!stop.load(std::memory_order_relaxed)) {
+            bus->subscribe(churnTopic, &context, [](const QString&, const QVariant&) {});
+            bus->unsubscribeAll(&context);
+            churn.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::thread> publishers;
+    publishers.reserve(threads);
+    for (int i = 0; i < threads; ++i) {
+        publishers.emplace_back([&]() {
+            for (quint64 n = 0; n < perThread; ++n) {
+                bus->publish(topic, data);
+            }
+            running.fetch_sub(1);
+        });
+    }
+    while (running.load() > 0) {
+        QCoreApplication::processEvents();
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    for (std::thread& publisher : publishers) {
+        publisher.join();
+    }
+    stop.store(true);
+    churner.join();
+
+    // 处理剩余的排队消息
+    QCoreApplication::sendPostedEvents();
+    quint64 after = 0;
+    for (const Receiver* sink : sinks) {
+        after += sink->received;
+    }
+
+    const quint64 published = perThread * quint64(threads);
+    return {threads, double(published) * 1e9 / double(qMax<qint64>(1, elapsed)),
+            published, after - before, churn.load()};
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("YEFSMessageBusBenchmark"));
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription(QStringLiteral("MessageBus publish benchmark"));
+    cli.addHelpOption();
+    QCommandLineOption messagesOption(QStringLiteral("messages"), QStringLiteral("Messages per case."),
+                                      QStringLiteral("n"), QStringLiteral("1000000"));
+    QCommandLineOption subscribersOption(QStringLiteral("subscribers"), QStringLiteral("Subscribers on the hot topic."),
+                                         QStringLiteral("n"), QStringLiteral("4"));
+    QCommandLineOption topicsOption(QStringLiteral("topics"), QStringLiteral("Other registered topics."),
+                                    QStringLiteral("n"), QStringLiteral("64"));
+    QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("Publisher thread counts for the stress case."),
+                                     QStringLiteral("list"), QStringLiteral("1,2,4,8"));
+    QCommandLineOption stressMessagesOption(QStringLiteral("stress-messages"), QStringLiteral("Messages per stress run."),
+                                            QStringLiteral("n"), QStringLiteral("200000"));
+    cli.addOptions({messagesOption, subscribersOption, topicsOption, threadsOption, stressMessagesOption});
+    cli.process(app);
+
+    const quint64 messages = qMax<quint64>(1, cli.value(messagesOption).toULongLong());
+    const int subscriberCount = qMax(1, cli.value(subscribersOption).toInt());
+    const int topicCount = qMax(0, cli.value(topicsOption).toInt());
+    const QString hotTopic = QString::fromLatin1(Topics::MAP_CENTER_CHANGED);
+
+    QList<Receiver*> receivers;
+    for (int i = 0; i < subscriberCount; ++i) {
+        receivers.append(new Receiver());
+    }
+    Receiver idle;
+
+    // 对照组
+    LegacyBus legacy;
+    for (int i = 0; i < topicCount; ++i) {
+        legacy.subscribe(QStringLiteral("bench/topic/%1").arg(i), &idle, "onMessage");
+    }
+    for (Receiver* receiver : std::as_const(receivers)) {
+        legacy.subscribe(hotTopic, receiver, "onMessage");
+    }
+
+    // 槽函数订阅
+    MessageBus* bus = MessageBus::instance();
+    for (int i = 0; i < topicCount; ++i) {
+        bus->subscribe(QStringLiteral("bench/topic/%1").arg(i), &idle, "onMessage");
+    }
+    const MessageBus::TopicId slotTopic = bus->topic(hotTopic);
+    for (Receiver* receiver : std::as_const(receivers)) {
+        bus->subscribe(slotTopic, receiver, "onMessage");
+    }
+
+    // 函数对象订阅（独立主题，避免与槽函数订阅者叠加）
+    const MessageBus::TopicId functorTopic = bus->topic(QStringLiteral("bench/functor"));
+    for (Receiver* receiver : std::as_const(receivers)) {
+        bus->subscribe(functorTopic, receiver, [receiver](const QString& topic, const QVariant& data) {
+            receiver->onMessage(topic, data);
+        });
+    }
+
+    QList<Result> results;
+    results.append(measure("legacy", messages, [&](const QVariant& data) {
+        legacy.publish(hotTopic, data);
+    }));
+    results.append(measure("string", messages, [&](const QVariant& data) {
+        bus->publish(hotTopic, data);
+    }));
+    results.append(measure("topicId", messages, [&](const QVariant& data) {
+        bus->publish(slotTopic, data);
+    }));
+    results.append(measure("functor", messages, [&](const QVariant& data) {
+        bus->publish(functorTopic, data);
+    }));
+
+    std::printf("%-10s %14s %10s\n", "case", "ns/publish", "speedup");
+    const double baseline = results.first().nsPerPublish;
+    for (const Result& result : std::as_const(results)) {
+        std::printf("%-10s %14.1f %9.2fx\n", result.name, result.nsPerPublish, baseline / result.nsPerPublish);
+    }
+
+    quint64 delivered = 0;
+    for (Receiver* receiver : std::as_const(receivers)) {
+        delivered += receiver->received;
+    }
+    std::printf("\n%d subscribers, %d other topics, %llu deliveries.\n",
+                subscriberCount, topicCount, static_cast<unsigned long long>(delivered));
+
+    // 多线程压力测试：复用主线程中的槽函数订阅者
+    const quint64 stressMessages = qMax<quint64>(1, cli.value(stressMessagesOption).toULongLong());
+    const QStringList threadCounts = cli.value(threadsOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    const MessageBus::TopicId stressTopic = bus->topic(QStringLiteral("bench/stress"));
+    for (Receiver* receiver : std::as_const(receivers)) {
+        bus->subscribe(stressTopic, receiver, "onMessage");
+    }
+
+    std::printf("\n%-8s %14s %12s %12s %10s\n", "threads", "msgs/s", "published", "delivered", "churn");
+    bool complete = true;
+    for (const QString& value : threadCounts) {
+        const int threads = value.trimmed().toInt();
+        if (threads <= 0) {
+            continue;
+        }
+        const StressResult result = stress(bus, stressTopic, receivers, threads, stressMessages);
+        std::printf("%-8d %14.0f %12llu %12llu %10llu\n", result.threads, result.messagesPerSecond,
+                    static_cast<unsigned long long>(result.published),
+                    static_cast<unsigned long long>(result.delivered),
+                    static_cast<unsigned long long>(result.churn));
+        complete = complete && result.delivered == result.published * quint64(subscriberCount);
+    }
+    if (!complete) {
+        std::printf("\nWARNING: delivered count does not match published x subscribers.\n");
+    }
+
+    qDeleteAll(receivers);
+    return complete ? 0 : 1;
+}
+
+#include "MessageBusBenchmark.moc"
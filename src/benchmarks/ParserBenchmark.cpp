@@ -0,0 +1,497 @@
+/**
+ * @brief 矢量格式解析器基准测试
+ *
+ * 生成指定大小的合成 GPX（长轨迹）、KML（深层文件夹 + 大多边形）和
+ * GeoJSON（大型 FeatureCollection）文件，分别用 GPXParser、KMLParser、
+ * GeoJSONParser 解析，输出吞吐量（MB/s、features/s）、峰值 RSS 和分配次数。
+ *
+ * 用法：YEFSParserBenchmark [--size-mb 64] [--iterations 3] [--format all|gpx|kml|geojson]
+ *                           [--dir <目录>] [--keep]
+ */
+
+#include "core/IMapParser.h"
+#include "core/IMapSource.h"
+#include "core/parsers/GPXParser.h"
+#include "core/parsers/KMLParser.h"
+#include "core/parsers/GeoJSONParser.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTimeZone>
+#include <QtMath>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
+#include <sys/resource.h>
+#endif
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// ============================================================================
+// 分配计数
+// ============================================================================
+//
+// Qt 容器经 malloc 分配，glibc 下替换 malloc 系列函数即可统计全部分配；
+// 其他平台只能统计 operator new。
+
+namespace {
+
+std::atomic<quint64> g_allocations{0};
+std::atomic<quint64> g_allocatedBytes{0};
+
+inline void countAllocation(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+} // extern "C"
+#else
+void* operator new(size_t size)
+{
+    countAllocation(size);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace {
+
+using namespace YEFS;
+
+// ============================================================================
+// 内存统计
+// ============================================================================
+
+// 尽量重置峰值 RSS，返回 false 表示峰值从进程启动起累计
+bool resetPeakRss()
+{
+#if defined(Q_OS_LINUX)
+    // Linux 4.0+：向 clear_refs 写 5 重置 VmHWM
+    QFile file(QStringLiteral("/proc/self/clear_refs"));
+    return file.open(QIODevice::WriteOnly) && file.write("5") == 1;
+#else
+    return false;
+#endif
+}
+
+qint64 peakRssBytes()
+{
+#if defined(Q_OS_LINUX)
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (file.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : file.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+    }
+    return 0;
+#elif defined(Q_OS_MACOS)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return qint64(usage.ru_maxrss);
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return qint64(counters.PeakWorkingSetSize);
+#else
+    return 0;
+#endif
+}
+
+// ============================================================================
+// 合成数据生成
+// ============================================================================
+
+// 带缓冲的写入器，按块刷入文件
+class ChunkWriter
+{
+public:
+    explicit ChunkWriter(QFile& file) : m_file(file) { m_buffer.reserve(kChunk + 4096); }
+    ~ChunkWriter() { flush(); }
+
+    ChunkWriter& operator<<(const char* text) { m_buffer.append(text); return maybeFlush(); }
+    ChunkWriter& operator<<(const QByteArray& text) { m_buffer.append(text); return maybeFlush(); }
+    ChunkWriter& operator<<(double value) {
+        m_buffer.append(QByteArray::number(value, 'f', 7));
+        return maybeFlush();
+    }
+    ChunkWriter& operator<<(qint64 value) { m_buffer.append(QByteArray::number(value)); return maybeFlush(); }
+
+    qint64 written() const { return m_written + m_buffer.size(); }
+
+    void flush() {
+        m_file.write(m_buffer);
+        m_written += m_buffer.size();
+        m_buffer.clear();
+    }
+
+private:
+    static constexpr qsizetype kChunk = 1 << 20;
+
+    ChunkWriter& maybeFlush() {
+        if (m_buffer.size() >= kChunk) {
+            flush();
+        }
+        return *this;
+    }
+
+    QFile& m_file;
+    QByteArray m_buffer;
+    qint64 m_written = 0;
+};
+
+// 单条长轨迹被切成多段，每个点带海拔和时间
+void generateGpx(const QString& path, qint64 targetBytes, std::mt19937& random)
+{
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    ChunkWriter out(file);
+    std::normal_distribution<double> step(0.0, 0.00005);
+
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<gpx version=\"1.1\" creator=\"YEFSParserBenchmark\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n";
+
+    double lon = 116.3;
+    double lat = 39.9;
+    double ele = 50.0;
+    qint64 time = QDateTime(QDate(2024, 1, 1), QTime(0, 0), QTimeZone::UTC).toMSecsSinceEpoch();
+    int track = 0;
+    while (out.written() < targetBytes) {
+        out << "<trk><name>Track " << qint64(track++) << "</name>\n";
+        for (int segment = 0; segment < 4 && out.written() < targetBytes; ++segment) {
+            out << "<trkseg>\n";
+            for (int i = 0; i < 50000; ++i) {
+                lon += step(random);
+                lat += step(random);
+                ele += step(random) * 1000.0;
+                time += 1000;
+                out << "<trkpt lat=\"" << lat << "\" lon=\"" << lon << "\"><ele>" << ele
+                    << "</ele><time>"
+                    << QDateTime::fromMSecsSinceEpoch(time, QTimeZone::UTC).toString(Qt::ISODate).toLatin1()
+                    << "</time></trkpt>\n";
+            }
+            out << "</trkseg>\n";
+        }
+        out << "</trk>\n";
+    }
+    out << "</gpx>\n";
+}
+
+// 环形坐标串，近似圆形加噪声
+void writeRing(ChunkWriter& out, double centerLon, double centerLat, double radius, int vertices,
+               std::mt19937& random, bool kmlStyle)
+{
+    std::uniform_real_distribution<double> jitter(0.9, 1.1);
+    double firstLon = 0.0;
+    double firstLat = 0.0;
+    for (int i = 0; i < vertices; ++i) {
+        const double angle = 2.0 * M_PI * i / vertices;
+        const double r = radius * jitter(random);
+        const double lon = centerLon + r * std::cos(angle);
+        const double lat = centerLat + r * std::sin(angle);
+        if (i == 0) {
+            firstLon = lon;
+            firstLat = lat;
+        }
+        if (kmlStyle) {
+            out << lon << "," << lat << ",0 ";
+        } else {
+            out << (i == 0 ? "[" : ",[") << lon << "," << lat << "]";
+        }
+    }
+    if (kmlStyle) {
+        out << firstLon << "," << firstLat << ",0";
+    } else {
+        out << ",[" << firstLon << "," << firstLat << "]";
+    }
+}
+
+// 多层嵌套文件夹，每个地标是带一个洞的大多边形
+void generateKml(const QString& path, qint64 targetBytes, std::mt19937& random)
+{
+    constexpr int kFolderDepth = 8;
+    constexpr int kPlacemarksPerFolder = 20;
+    constexpr int kPolygonVertices = 2000;
+
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    ChunkWriter out(file);
+    std::uniform_real_distribution<double> lonDist(-170.0, 170.0);
+    std::uniform_real_distribution<double> latDist(-70.0, 70.0);
+
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<kml xmlns=\"http://www.opengis.net/kml/2.2\"><Document><name>Benchmark</name>\n";
+
+    int placemark = 0;
+    while (out.written() < targetBytes) {
+        for (int depth = 0; depth < kFolderDepth; ++depth) {
+            out << "<Folder><name>Level " << qint64(depth) << "</name>\n";
+        }
+        for (int i = 0; i < kPlacemarksPerFolder && out.written() < targetBytes; ++i) {
+            const double lon = lonDist(random);
+            const double lat = latDist(random);
+            out << "<Placemark><name>Area " << qint64(placemark++) << "</name>"
+                << "<description>Synthetic polygon</description><Polygon>"
+                << "<outerBoundaryIs><LinearRing><coordinates>";
+            writeRing(out, lon, lat, 0.5, kPolygonVertices, random, true);
+            out << "</coordinates></LinearRing></outerBoundaryIs>"
+                << "<innerBoundaryIs><LinearRing><coordinates>";
+            writeRing(out, lon, lat, 0.1, kPolygonVertices / 10, random, true);
+            out << "</coordinates></LinearRing></innerBoundaryIs></Polygon></Placemark>\n";
+        }
+        for (int depth = 0; depth < kFolderDepth; ++depth) {
+            out << "</Folder>\n";
+        }
+    }
+    out << "</Document></kml>\n";
+}
+
+// 点、线、面混合的 FeatureCollection，带字符串/数值/布尔属性
+void generateGeoJson(const QString& path, qint64 targetBytes, std::mt19937& random)
+{
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    ChunkWriter out(file);
+    std::uniform_real_distribution<double> lonDist(-170.0, 170.0);
+    std::uniform_real_distribution<double> latDist(-70.0, 70.0);
+    std::normal_distribution<double> step(0.0, 0.001);
+
+    out << "{\"type\":\"FeatureCollection\",\"features\":[\n";
+    qint64 feature = 0;
+    while (out.written() < targetBytes) {
+        if (feature > 0) {
+            out << ",\n";
+        }
+        const double lon = lonDist(random);
+        const double lat = latDist(random);
+        out << "{\"type\":\"Feature\",\"properties\":{\"name\":\"Feature " << feature
+            << "\",\"category\":\"" << QByteArray(1, char('A' + feature % 8))
+            << "\",\"value\":" << double(feature % 1000) * 0.5
+            << ",\"active\":" << (feature % 2 ? "true" : "false") << "},\"geometry\":";
+
+        switch (feature % 3) {
+        case 0:
+            out << "{\"type\":\"Point\",\"coordinates\":[" << lon << "," << lat << "]}";
+            break;
+        case 1: {
+            out << "{\"type\":\"LineString\",\"coordinates\":[";
+            double x = lon;
+            double y = lat;
+            for (int i = 0; i < 200; ++i) {
+                x += step(random);
+                y += step(random);
+                out << (i == 0 ? "[" : ",[") << x << "," << y << "]";
+            }
+            out << "]}";
+            break;
+        }
+        default:
+            out << "{\"type\":\"Polygon\",\"coordinates\":[";
+            writeRing(out, lon, lat, 0.05, 100, random, false);
+            out << "]}";
+            break;
+        }
+        out << "}";
+        ++feature;
+    }
+    out << "\n]}\n";
+}
+
+// ============================================================================
+// 测量
+// ============================================================================
+
+struct Result {
+    QString format;
+    qint64 fileBytes = 0;
+    int features = 0;
+    qint64 bestNs = 0;
+    quint64 allocations = 0;
+    quint64 allocatedBytes = 0;
+    qint64 peakRss = 0;
+    bool peakIsolated = false;
+};
+
+bool runBenchmark(const QString& format, IMapParser& parser, const QString& path,
+                  int iterations, Result& result)
+{
+    result.format = format;
+    result.fileBytes = QFileInfo(path).size();
+    result.bestNs = std::numeric_limits<qint64>::max();
+
+    for (int i = 0; i < iterations; ++i) {
+        result.peakIsolated = resetPeakRss();
+        const quint64 allocationsBefore = g_allocations.load();
+        const quint64 bytesBefore = g_allocatedBytes.load();
+
+        QElapsedTimer timer;
+        timer.start();
+        std::unique_ptr<IMapSource> source(parser.parse(path));
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        auto* vectorSource = qobject_cast<IVectorMapSource*>(source.get());
+        if (!vectorSource) {
+            std::fprintf(stderr, "%s: parse failed\n", qPrintable(format));
+            return false;
+        }
+
+        // 各轮结果相同，分配与峰值取最后一轮（文件已在页缓存中）
+        result.features = vectorSource->featureCount();
+        result.bestNs = qMin(result.bestNs, elapsed);
+        result.allocations = g_allocations.load() - allocationsBefore;
+        result.allocatedBytes = g_allocatedBytes.load() - bytesBefore;
+        result.peakRss = peakRssBytes();
+    }
+    return true;
+}
+
+void printResult(const Result& result)
+{
+    const double seconds = result.bestNs / 1e9;
+    const double megabytes = result.fileBytes / (1024.0 * 1024.0);
+    std::printf("%-8s %9.1f %10d %10.1f %10.1f %12.0f %12llu %11.1f %10.1f%s\n",
+                qPrintable(result.format),
+                megabytes,
+                result.features,
+                seconds * 1000.0,
+                megabytes / seconds,
+                result.features / seconds,
+                static_cast<unsigned long long>(result.allocations),
+                result.allocatedBytes / (1024.0 * 1024.0),
+                result.peakRss / (1024.0 * 1024.0),
+                result.peakIsolated ? "" : "*");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("YEFSParserBenchmark"));
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription(QStringLiteral("GPX/KML/GeoJSON parser benchmark"));
+    cli.addHelpOption();
+    QCommandLineOption sizeOption(QStringLiteral("size-mb"), QStringLiteral("Synthetic file size per format (MB)."),
+                                  QStringLiteral("mb"), QStringLiteral("64"));
+    QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Parse runs per file."),
+                                        QStringLiteral("n"), QStringLiteral("3"));
+    QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("all, gpx, kml or geojson."),
+                                    QStringLiteral("format"), QStringLiteral("all"));
+    QCommandLineOption dirOption(QStringLiteral("dir"), QStringLiteral("Directory for generated files."),
+                                 QStringLiteral("path"));
+    QCommandLineOption keepOption(QStringLiteral("keep"), QStringLiteral("Keep generated files."));
+    QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Random seed."),
+                                  QStringLiteral("seed"), QStringLiteral("42"));
+    cli.addOptions({sizeOption, iterationsOption, formatOption, dirOption, keepOption, seedOption});
+    cli.process(app);
+
+    const qint64 targetBytes = qMax<qint64>(1, cli.value(sizeOption).toLongLong()) * 1024 * 1024;
+    const int iterations = qMax(1, cli.value(iterationsOption).toInt());
+    const QString format = cli.value(formatOption).toLower();
+    std::mt19937 random(cli.value(seedOption).toUInt());
+
+    QTemporaryDir tempDir;
+    const QString dir = cli.isSet(dirOption) ? cli.value(dirOption) : tempDir.path();
+    QDir().mkpath(dir);
+    tempDir.setAutoRemove(!cli.isSet(keepOption));
+
+    struct Case {
+        QString name;
+        QString fileName;
+        std::function<void(const QString&, qint64, std::mt19937&)> generate;
+        std::unique_ptr<IMapParser> parser;
+    };
+    std::vector<Case> cases;
+    cases.push_back({QStringLiteral("gpx"), QStringLiteral("bench.gpx"), generateGpx,
+                     std::make_unique<GPXParser>()});
+    cases.push_back({QStringLiteral("kml"), QStringLiteral("bench.kml"), generateKml,
+                     std::make_unique<KMLParser>()});
+    cases.push_back({QStringLiteral("geojson"), QStringLiteral("bench.geojson"), generateGeoJson,
+                     std::make_unique<GeoJSONParser>()});
+
+    std::printf("%-8s %9s %10s %10s %10s %12s %12s %11s %10s\n",
+                "format", "size(MB)", "features", "best(ms)", "MB/s", "features/s",
+                "allocs", "alloc(MB)", "peakRSS");
+
+    bool ok = true;
+    for (Case& c : cases) {
+        if (format != QStringLiteral("all") && format != c.name) {
+            continue;
+        }
+        const QString path = QDir(dir).filePath(c.fileName);
+        if (!QFileInfo::exists(path) || QFileInfo(path).size() < targetBytes) {
+            c.generate(path, targetBytes, random);
+        }
+
+        Result result;
+        if (runBenchmark(c.name, *c.parser, path, iterations, result)) {
+            printResult(result);
+        } else {
+            ok = false;
+        }
+        if (!cli.isSet(keepOption)) {
+            QFile::remove(path);
+        }
+    }
+
+    std::printf("\npeakRSS in MB; '*' marks a process-wide peak that could not be reset.\n");
+    return ok ? 0 : 1;
+}
@@ -8,6 +8,9 @@
 #include "parsers/GeoJSONParser.h"
 #include "parsers/GPXParser.h"
 #include "parsers/KMLParser.h"
+#include "parsers/MBTilesParser.h"
+#include "parsers/PMTilesParser.h"
+#include "parsers/TilePackParser.h"
 
 #include <QQuickWindow>
 #include <QMapLibre/Utils>
@@ -127,6 +130,9 @@ void Application::initializeMapParsers()
     factory->registerParser(new GeoJSONParser());
     factory->registerParser(new GPXParser());
     factory->registerParser(new KMLParser());
+    factory->registerParser(new TilePackParser());
+    factory->registerParser(new MBTilesParser());
+    factory->registerParser(new PMTilesParser());
     
     qDebug() << "[Application] Registered parsers:" << factory->supportedExtensions();
     
@@ -0,0 +1,48 @@
+#ifndef YEFS_CAMERASTATE_H
+#define YEFS_CAMERASTATE_H
+
+#include <QGeoRectangle>
+#include <QMetaType>
+#include <QQmlEngine>
+
+namespace YEFS {
+
+/**
+ * @brief 地图相机状态快照
+ *
+ * MapLibreEngine 把一帧内的中心、级别、倾角、方位和可见范围变化合并为一个快照，
+ * 经 cameraChanged 信号和 Topics::MAP_CAMERA_CHANGED 发出。QML 中为值类型 cameraState。
+ */
+struct CameraState
+{
+    Q_GADGET
+    QML_VALUE_TYPE(cameraState)
+
+    Q_PROPERTY(double latitude MEMBER latitude)
+    Q_PROPERTY(double longitude MEMBER longitude)
+    Q_PROPERTY(double zoom MEMBER zoom)
+    Q_PROPERTY(double pitch MEMBER pitch)
+    Q_PROPERTY(double bearing MEMBER bearing)
+    Q_PROPERTY(QGeoRectangle visibleRegion MEMBER visibleRegion)
+
+public:
+    double latitude = 0.0;
+    double longitude = 0.0;
+    double zoom = 0.0;
+    double pitch = 0.0;
+    double bearing = 0.0;
+    QGeoRectangle visibleRegion;
+
+    bool operator==(const CameraState& other) const
+    {
+        return latitude == other.latitude && longitude == other.longitude && zoom == other.zoom
+            && pitch == other.pitch && bearing == other.bearing && visibleRegion == other.visibleRegion;
+    }
+    bool operator!=(const CameraState& other) const { return !(*this == other); }
+};
+
+} // namespace YEFS
+
+Q_DECLARE_METATYPE(YEFS::CameraState)
+
+#endif // YEFS_CAMERASTATE_H
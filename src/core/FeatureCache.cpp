@@ -0,0 +1,441 @@
+#include "FeatureCache.h"
+#include "MappedFile.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace YEFS {
+
+namespace {
+
+constexpr quint32 kMagic = 0x31434659;     // "YFC1"，字节序不同时读出的值不同
+std::atomic<bool> s_enabled{true};
+
+struct SourceStamp {
+    QString path;
+    qint64 size = 0;
+    qint64 modified = 0;
+};
+
+bool sourceStamp(const QString& filePath, SourceStamp& stamp)
+{
+    const QFileInfo info(filePath);
+    if (!info.isFile()) {
+        return false;
+    }
+    stamp.path = info.canonicalFilePath();
+    stamp.size = info.size();
+    stamp.modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+// 按本机字节序写入原始列数据
+class Writer
+{
+public:
+    explicit Writer(QIODevice* device) : m_device(device) {}
+
+    bool ok() const { return m_ok; }
+
+    void raw(const void* data, qint64 size) {
+        if (m_ok && size > 0) {
+            m_ok = m_device->write(static_cast<const char*>(data), size) == size;
+        }
+    }
+    template <typename T>
+    void value(T v) { raw(&v, sizeof(T)); }
+    template <typename T>
+    void column(const QList<T>& list) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        value<quint64>(quint64(list.size()));
+        raw(list.constData(), qint64(list.size()) * qint64(sizeof(T)));
+    }
+    void bytes(const QByteArray& data) {
+        value<quint64>(quint64(data.size()));
+        raw(data.constData(), data.size());
+    }
+
+private:
+    QIODevice* m_device;
+    bool m_ok = true;
+};
+
+// 从映射内存中读取，越界时置为失败
+class Reader
+{
+public:
+    explicit Reader(QByteArrayView data) : m_data(data) {}
+
+    bool ok() const { return m_ok; }
+
+    bool raw(void* out, qint64 size) {
+        if (!m_ok || size < 0 || size > m_data.size() - m_pos) {
+            m_ok = false;
+            return false;
+        }
+        std::memcpy(out, m_data.data() + m_pos, size_t(size));
+        m_pos += size;
+        return true;
+    }
+    template <typename T>
+    T value() {
+        T v{};
+        raw(&v, sizeof(T));
+        return v;
+    }
+    template <typename T>
+    bool column(QList<T>& list) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const quint64 count = value<quint64>();
+        if (!m_ok || count > quint64(m_data.size() - m_pos) / sizeof(T)) {
+            m_ok = false;
+            return false;
+        }
+        list.resize(qsizetype(count));
+        return raw(list.data(), qint64(count * sizeof(T)));
+    }
+    QByteArray bytes() {
+        const quint64 count = value<quint64>();
+        if (!m_ok || count > quint64(m_data.size() - m_pos)) {
+            m_ok = false;
+            return QByteArray();
+        }
+        QByteArray result(m_data.data() + m_pos, qsizetype(count));
+        m_pos += qint64(count);
+        return result;
+    }
+
+private:
+    QByteArrayView m_data;
+    qint64 m_pos = 0;
+    bool m_ok = true;
+};
+
+} // namespace
+
+bool FeatureCache::isEnabled()
+{
+    return s_enabled.load();
+}
+
+void FeatureCache::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled);
+}
+
+QString FeatureCache::cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/features");
+}
+
+QString FeatureCache::cachePath(const QString& filePath)
+{
+    const QString path = QFileInfo(filePath).canonicalFilePath();
+    if (path.isEmpty()) {
+        return QString();
+    }
+    const QByteArray key = QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory() + QLatin1Char('/') + QString::fromLatin1(key) + QStringLiteral(".yfc");
+}
+
+// ============================================================================
+// 读取
+// ============================================================================
+
+bool FeatureCache::load(const QString& filePath, Entry& entry)
+{
+    SourceStamp stamp;
+    if (!isEnabled() || !sourceStamp(filePath, stamp)) {
+        return false;
+    }
+
+    MappedFile mapped(cachePath(filePath));
+    if (!mapped.isMapped()) {
+        return false;
+    }
+
+    Reader reader(mapped.data());
+    if (reader.value<quint32>() != kMagic || reader.value<quint32>() != Version
+        || reader.value<qint64>() != stamp.size || reader.value<qint64>() != stamp.modified
+        || QString::fromUtf8(reader.bytes()) != stamp.path) {
+        return false;
+    }
+    entry.parserName = QString::fromUtf8(reader.bytes());
+    entry.sourceName = QString::fromUtf8(reader.bytes());
+
+    // 几何列
+    FeatureStore& store = entry.store;
+    reader.column(store.m_lon);
+    reader.column(store.m_lat);
+    reader.column(store.m_alt);
+    reader.column(store.m_timestamps);
+    reader.column(store.m_importance);
+    reader.column(store.m_partOffsets);
+    reader.column(store.m_groupOffsets);
+    reader.column(store.m_featureOffsets);
+    reader.column(store.m_types);
+    reader.column(store.m_groupTypes);
+
+    // 属性列：数值和字符串下标为原始数据，其余部分经 QDataStream 序列化
+    const quint32 columnCount = reader.value<quint32>();
+    if (!reader.ok() || columnCount > quint32(store.m_types.size() + 1) * 1024) {
+        return false;
+    }
+    store.m_columns.resize(columnCount);
+    for (PropertyColumn& column : store.m_columns) {
+        reader.column(column.numbers);
+        reader.column(column.strings);
+        reader.column(column.nulls);
+    }
+
+    QByteArray meta = reader.bytes();
+    QDataStream stream(&meta, QIODevice::ReadOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream >> store.m_featureIds;
+    for (PropertyColumn& column : store.m_columns) {
+        quint8 kind = 0;
+        stream >> column.name >> kind >> column.variants;
+        column.kind = PropertyColumn::Kind(kind);
+    }
+    stream >> store.m_stringPool
+           >> store.m_minLon >> store.m_maxLon >> store.m_minLat >> store.m_maxLat
+           >> store.m_hasAltitude;
+
+    // 空间索引
+    SpatialIndex& index = entry.index;
+    index.m_itemCount = int(reader.value<qint64>());
+    reader.column(index.m_boxes);
+    reader.column(index.m_indices);
+    reader.column(index.m_levelBounds);
+
+    const qsizetype features = store.m_types.size();
+    const qsizetype coords = store.m_lon.size();
+    if (!reader.ok() || reader.value<quint32>() != kMagic || stream.status() != QDataStream::Ok
+        || store.m_featureOffsets.size() != features + 1
+        || store.m_featureIds.size() != features
+        || store.m_lat.size() != coords || store.m_alt.size() != coords
+        || store.m_partOffsets.isEmpty() || store.m_groupOffsets.isEmpty()
+        || store.m_partOffsets.last() != quint32(coords)
+        || store.m_groupOffsets.last() != quint32(store.m_partOffsets.size() - 1)
+        || store.m_featureOffsets.last() != quint32(store.m_groupOffsets.size() - 1)
+        || (!store.m_timestamps.isEmpty() && store.m_timestamps.size() != coords)
+        || (!store.m_importance.isEmpty() && store.m_importance.size() != coords)
+        || !isConsistent(store, index)) {
+        qWarning() << "[FeatureCache] Corrupted cache for:" << filePath;
+        entry = Entry();
+        return false;
+    }
+
+    // 查找表由数据重建
+    for (int i = 0; i < store.m_columns.size(); ++i) {
+        store.m_columnIndex.insert(store.m_columns.at(i).name, i);
+    }
+    for (int i = 0; i < store.m_stringPool.size(); ++i) {
+        store.m_stringIndex.insert(store.m_stringPool.at(i), i);
+    }
+
+    qDebug() << "[FeatureCache] Cache hit:" << filePath
+             << "features:" << features << "coordinates:" << coords;
+    return true;
+}
+
+bool FeatureCache::isConsistent(const FeatureStore& store, const SpatialIndex& index)
+{
+    // 偏移数组从 0 开始且单调不减；末项已与下一层的元素数核对，因此全部在范围内
+    const auto monotonic = [](const QList<quint32>& offsets) {
+        return !offsets.isEmpty() && offsets.first() == 0
+            && std::is_sorted(offsets.cbegin(), offsets.cend());
+    };
+    if (!monotonic(store.m_partOffsets) || !monotonic(store.m_groupOffsets)
+        || !monotonic(store.m_featureOffsets)) {
+        return false;
+    }
+
+    for (quint8 type : store.m_types) {
+        if (type > quint8(GeometryType::GeometryCollection)) {
+            return false;
+        }
+    }
+
+    // 组类型列只在有 GeometryCollection 时存在，成员本身不能是集合
+    const qsizetype groups = store.m_groupOffsets.size() - 1;
+    if (!store.m_groupTypes.isEmpty() && store.m_groupTypes.size() != groups) {
+        return false;
+    }
+    for (quint8 type : store.m_groupTypes) {
+        if ((type & ~FeatureStore::ContinuesMember) > quint8(GeometryType::MultiPolygon)) {
+            return false;
+        }
+    }
+    for (qsizetype i = 0; i < store.m_types.size(); ++i) {
+        if (store.m_types.at(i) == quint8(GeometryType::GeometryCollection)
+            && store.m_featureOffsets.at(i) < store.m_featureOffsets.at(i + 1)
+            && store.m_groupTypes.isEmpty()) {
+            return false;
+        }
+    }
+
+    for (const QVariant& id : store.m_featureIds) {
+        if (id.isValid() && id.typeId() != QMetaType::QString && id.typeId() != QMetaType::Double) {
+            return false;
+        }
+    }
+
+    const qint32 poolSize = qint32(store.m_stringPool.size());
+    for (const PropertyColumn& column : store.m_columns) {
+        if (column.kind > PropertyColumn::Variant) {
+            return false;
+        }
+        for (qint32 string : column.strings) {
+            if (string < -1 || string >= poolSize) {
+                return false;
+            }
+        }
+        // isNull() 依赖升序做二分查找
+        for (qsizetype i = 0; i < column.nulls.size(); ++i) {
+            const qint32 row = column.nulls.at(i);
+            if (row < 0 || row >= store.m_types.size() || (i > 0 && row <= column.nulls.at(i - 1))) {
+                return false;
+            }
+        }
+    }
+
+    // 空间索引：叶子层为各要素，每层节点指向上一层的子节点，最上层只有根节点
+    const qsizetype features = store.m_types.size();
+    const qsizetype nodes = index.m_indices.size();
+    if (index.m_itemCount != features || index.m_boxes.size() != nodes * 4) {
+        return false;
+    }
+    if (features == 0) {
+        return nodes == 0 && index.m_levelBounds.isEmpty();
+    }
+    const QList<int>& bounds = index.m_levelBounds;
+    if (bounds.size() < 2 || bounds.first() != features || bounds.last() != nodes
+        || bounds.last() - bounds.at(bounds.size() - 2) != 1) {
+        return false;
+    }
+    for (qsizetype level = 1; level < bounds.size(); ++level) {
+        if (bounds.at(level) <= bounds.at(level - 1)) {
+            return false;
+        }
+    }
+    for (qsizetype pos = 0; pos < features; ++pos) {
+        if (index.m_indices.at(pos) >= quint32(features)) {
+            return false;
+        }
+    }
+    for (qsizetype level = 1; level < bounds.size(); ++level) {
+        const quint32 childBegin = level == 1 ? 0 : quint32(bounds.at(level - 2));
+        const quint32 childEnd = quint32(bounds.at(level - 1));
+        for (qsizetype pos = bounds.at(level - 1); pos < bounds.at(level); ++pos) {
+            const quint32 child = index.m_indices.at(pos);
+            if (child < childBegin || child >= childEnd) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// 写入
+// ============================================================================
+
+bool FeatureCache::save(const QString& filePath, const QString& parserName, const QString& sourceName,
+                        const FeatureStore& store, const SpatialIndex& index)
+{
+    SourceStamp stamp;
+    if (!isEnabled() || !sourceStamp(filePath, stamp)) {
+        return false;
+    }
+
+    const QString path = cachePath(filePath);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+
+    // QSaveFile 先写临时文件再原子替换，读取方不会看到写了一半的缓存
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[FeatureCache] Cannot write cache:" << path << file.errorString();
+        return false;
+    }
+
+    Writer writer(&file);
+    writer.value<quint32>(kMagic);
+    writer.value<quint32>(Version);
+    writer.value<qint64>(stamp.size);
+    writer.value<qint64>(stamp.modified);
+    writer.bytes(stamp.path.toUtf8());
+    writer.bytes(parserName.toUtf8());
+    writer.bytes(sourceName.toUtf8());
+
+    writer.column(store.m_lon);
+    writer.column(store.m_lat);
+    writer.column(store.m_alt);
+    writer.column(store.m_timestamps);
+    writer.column(store.m_importance);
+    writer.column(store.m_partOffsets);
+    writer.column(store.m_groupOffsets);
+    writer.column(store.m_featureOffsets);
+    writer.column(store.m_types);
+    writer.column(store.m_groupTypes);
+
+    writer.value<quint32>(quint32(store.m_columns.size()));
+    for (const PropertyColumn& column : store.m_columns) {
+        writer.column(column.numbers);
+        writer.column(column.strings);
+        writer.column(column.nulls);
+    }
+
+    QByteArray meta;
+    QDataStream stream(&meta, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << store.m_featureIds;
+    for (const PropertyColumn& column : store.m_columns) {
+        stream << column.name << quint8(column.kind) << column.variants;
+    }
+    stream << store.m_stringPool
+           << store.m_minLon << store.m_maxLon << store.m_minLat << store.m_maxLat
+           << store.m_hasAltitude;
+    writer.bytes(meta);
+
+    writer.value<qint64>(index.m_itemCount);
+    writer.column(index.m_boxes);
+    writer.column(index.m_indices);
+    writer.column(index.m_levelBounds);
+
+    writer.value<quint32>(kMagic);
+
+    if (!writer.ok() || !file.commit()) {
+        qWarning() << "[FeatureCache] Failed to write cache:" << path << file.errorString();
+        return false;
+    }
+
+    qDebug() << "[FeatureCache] Cached:" << filePath << "size:" << QFileInfo(path).size();
+    return true;
+}
+
+void FeatureCache::remove(const QString& filePath)
+{
+    const QString path = cachePath(filePath);
+    if (!path.isEmpty()) {
+        QFile::remove(path);
+    }
+}
+
+void FeatureCache::clear()
+{
+    QDir(cacheDirectory()).removeRecursively();
+}
+
+} // namespace YEFS
@@ -0,0 +1,52 @@
+#ifndef YEFS_FEATURECACHE_H
+#define YEFS_FEATURECACHE_H
+
+#include <QString>
+
+#include "FeatureStore.h"
+#include "SpatialIndex.h"
+
+namespace YEFS {
+
+/**
+ * @brief 解析结果的二进制磁盘缓存
+ *
+ * 首次解析后把 FeatureStore 的各列、属性、范围和空间索引按原始字节写入缓存目录，
+ * 以源文件的绝对路径、大小和修改时间作为键；再次加载同一文件时映射缓存文件，
+ * 各列整块复制回内存，不再解析文本格式。
+ * 格式带版本号，版本或字节序不符、源文件已变化时视为未命中。所有函数线程安全。
+ */
+class FeatureCache
+{
+public:
+    static constexpr quint32 Version = 3;
+
+    struct Entry {
+        QString parserName;
+        QString sourceName;
+        FeatureStore store;
+        SpatialIndex index;
+    };
+
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static QString cacheDirectory();
+    static QString cachePath(const QString& filePath);
+
+    // 命中时填充 entry 并返回 true
+    static bool load(const QString& filePath, Entry& entry);
+    static bool save(const QString& filePath, const QString& parserName, const QString& sourceName,
+                     const FeatureStore& store, const SpatialIndex& index);
+
+    static void remove(const QString& filePath);
+    static void clear();
+
+private:
+    // 缓存文件是不可信的磁盘数据：检查偏移、下标、枚举值和索引结构，避免越界访问
+    static bool isConsistent(const FeatureStore& store, const SpatialIndex& index);
+};
+
+} // namespace YEFS
+
+#endif // YEFS_FEATURECACHE_H
@@ -0,0 +1,875 @@
+#include "FeatureStore.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocale>
+#include <QtMath>
+#include <algorithm>
+
+namespace YEFS {
+
+namespace {
+
+// ============================================================================
+// GeoJSON 文本写出
+// ============================================================================
+
+void appendNumber(QByteArray& out, double value)
+{
+    if (!qIsFinite(value)) {
+        out += "null";      // 与 QJsonValue 对非有限数的处理一致
+        return;
+    }
+    out += QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+}
+
+void appendString(QByteArray& out, QStringView text)
+{
+    static const char hex[] = "0123456789abcdef";
+    const QByteArray utf8 = text.toUtf8();
+    out += '"';
+    for (const char c : utf8) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (uchar(c) < 0x20) {
+                out += "\\u00";
+                out += hex[uchar(c) >> 4];
+                out += hex[uchar(c) & 0xf];
+            } else {
+                out += c;
+            }
+            break;
+        }
+    }
+    out += '"';
+}
+
+void appendVariant(QByteArray& out, const QVariant& value)
+{
+    // 混合类型列很少见，借用 QJsonDocument 写出单个值
+    const QByteArray json = QJsonDocument(QJsonArray{ QJsonValue::fromVariant(value) })
+                                .toJson(QJsonDocument::Compact);
+    out.append(json.constData() + 1, json.size() - 2);
+}
+
+} // namespace
+
+// ============================================================================
+// FeatureGeometry 实现
+// ============================================================================
+
+void FeatureGeometry::clear()
+{
+    type = GeometryType::Point;
+    lon.clear();
+    lat.clear();
+    alt.clear();
+    timestamps.clear();
+    partEnds.clear();
+    groupEnds.clear();
+    hasAltitude = false;
+}
+
+// ============================================================================
+// FeatureStore 实现
+// ============================================================================
+
+FeatureStore::FeatureStore()
+{
+    m_partOffsets.append(0);
+    m_groupOffsets.append(0);
+    m_featureOffsets.append(0);
+}
+
+int FeatureStore::append(const FeatureGeometry& geometry,
+                         const QVariantMap& properties,
+                         const QVariant& featureId)
+{
+    appendGeometry(geometry);
+    return finishFeature(geometry.type, properties, featureId);
+}
+
+int FeatureStore::appendCollection(const QList<FeatureGeometry>& members,
+                                   const QVariantMap& properties,
+                                   const QVariant& featureId)
+{
+    for (const FeatureGeometry& member : members) {
+        const int first = m_groupOffsets.size() - 1;
+        appendGeometry(member);
+        const int last = m_groupOffsets.size() - 1;
+
+        // 组类型列在第一个几何集合出现时创建，之前的组补 0
+        m_groupTypes.resize(last, 0);
+        for (int group = first; group < last; ++group) {
+            m_groupTypes[group] = quint8(member.type) | (group > first ? ContinuesMember : 0);
+        }
+    }
+    return finishFeature(GeometryType::GeometryCollection, properties, featureId);
+}
+
+int FeatureStore::appendWithoutGeometry(const QVariantMap& properties, const QVariant& featureId)
+{
+    return finishFeature(GeometryType::Point, properties, featureId);
+}
+
+GeometryType FeatureStore::groupType(int feature, int group) const
+{
+    const GeometryType type = geometryType(feature);
+    if (type != GeometryType::GeometryCollection) {
+        return type;
+    }
+    return GeometryType(m_groupTypes.at(group) & ~ContinuesMember);
+}
+
+bool FeatureStore::startsGeometry(int feature, int group) const
+{
+    if (group == groupBegin(feature)) {
+        return true;
+    }
+    return geometryType(feature) == GeometryType::GeometryCollection
+        && !(m_groupTypes.at(group) & ContinuesMember);
+}
+
+int FeatureStore::geometryEnd(int feature, int group) const
+{
+    const int end = groupEnd(feature);
+    int next = group + 1;
+    while (next < end && !startsGeometry(feature, next)) {
+        ++next;
+    }
+    return next;
+}
+
+void FeatureStore::appendGeometry(const FeatureGeometry& geometry)
+{
+    const quint32 coordBase = quint32(m_lon.size());
+    const quint32 partBase = quint32(m_partOffsets.size() - 1);
+    const int count = geometry.coordinateCount();
+
+    // 坐标
+    m_lon.append(geometry.lon);
+    m_lat.append(geometry.lat);
+    m_alt.append(geometry.alt);
+    m_hasAltitude = m_hasAltitude || geometry.hasAltitude;
+
+    // 时间列按需创建，缺失部分补 NoTimestamp
+    if (!geometry.timestamps.isEmpty() || !m_timestamps.isEmpty()) {
+        m_timestamps.resize(coordBase, FeatureGeometry::NoTimestamp);
+        m_timestamps.append(geometry.timestamps);
+        m_timestamps.resize(coordBase + count, FeatureGeometry::NoTimestamp);
+    }
+
+    // 新坐标尚未计算重要度，全部保留
+    if (!m_importance.isEmpty()) {
+        m_importance.resize(coordBase + count, std::numeric_limits<float>::infinity());
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const double lon = geometry.lon.at(i);
+        const double lat = geometry.lat.at(i);
+        m_minLon = qMin(m_minLon, lon);
+        m_maxLon = qMax(m_maxLon, lon);
+        m_minLat = qMin(m_minLat, lat);
+        m_maxLat = qMax(m_maxLat, lat);
+    }
+
+    // 部件：未显式划分时整体视为一个部件
+    int partCount = geometry.partEnds.size();
+    if (partCount == 0) {
+        m_partOffsets.append(coordBase + quint32(count));
+        partCount = 1;
+    } else {
+        for (quint32 end : geometry.partEnds) {
+            m_partOffsets.append(coordBase + end);
+        }
+    }
+
+    // 组：未显式划分时所有部件属于同一组
+    if (geometry.groupEnds.isEmpty()) {
+        m_groupOffsets.append(partBase + quint32(partCount));
+    } else {
+        for (quint32 end : geometry.groupEnds) {
+            m_groupOffsets.append(partBase + end);
+        }
+    }
+
+    if (!m_groupTypes.isEmpty()) {
+        m_groupTypes.resize(m_groupOffsets.size() - 1, 0);
+    }
+}
+
+int FeatureStore::finishFeature(GeometryType type, const QVariantMap& properties, const QVariant& featureId)
+{
+    appendProperties(properties);
+
+    m_featureOffsets.append(quint32(m_groupOffsets.size() - 1));
+    m_types.append(quint8(type));
+    m_featureIds.append(featureId);
+
+    return m_types.size() - 1;
+}
+
+void FeatureStore::clear()
+{
+    *this = FeatureStore();
+}
+
+void FeatureStore::squeeze()
+{
+    m_lon.squeeze();
+    m_lat.squeeze();
+    m_alt.squeeze();
+    m_timestamps.squeeze();
+    m_importance.squeeze();
+    m_partOffsets.squeeze();
+    m_groupOffsets.squeeze();
+    m_featureOffsets.squeeze();
+    m_types.squeeze();
+    m_groupTypes.squeeze();
+    m_featureIds.squeeze();
+    for (PropertyColumn& column : m_columns) {
+        column.numbers.squeeze();
+        column.strings.squeeze();
+        column.variants.squeeze();
+        column.nulls.squeeze();
+    }
+}
+
+void FeatureStore::appendProperties(const QVariantMap& properties)
+{
+    const int row = featureCount();
+
+    // 先为已确定类型的列追加缺失值
+    for (PropertyColumn& column : m_columns) {
+        switch (column.kind) {
+        case PropertyColumn::Empty:   break;
+        case PropertyColumn::Number:  column.numbers.append(qQNaN()); break;
+        case PropertyColumn::String:  column.strings.append(-1); break;
+        case PropertyColumn::Variant: column.variants.append(QVariant()); break;
+        }
+    }
+
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        int index = m_columnIndex.value(it.key(), -1);
+        if (index < 0) {
+            index = m_columns.size();
+            PropertyColumn column;
+            column.name = it.key();
+            m_columns.append(column);
+            m_columnIndex.insert(it.key(), index);
+        }
+        // 显式的 null 不决定列类型，单元格保持缺失，只记下行号以便原样写回
+        if (it.value().isNull()) {
+            m_columns[index].nulls.append(row);
+            continue;
+        }
+        setProperty(m_columns[index], row, it.value());
+    }
+}
+
+void FeatureStore::setProperty(PropertyColumn& column, int row, const QVariant& value)
+{
+    PropertyColumn::Kind kind = PropertyColumn::Variant;
+    switch (value.typeId()) {
+    case QMetaType::Double:
+    case QMetaType::Float:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        kind = PropertyColumn::Number;
+        break;
+    case QMetaType::QString:
+        kind = PropertyColumn::String;
+        break;
+    default:
+        break;
+    }
+
+    // 首个非空值决定列类型
+    if (column.kind == PropertyColumn::Empty) {
+        column.kind = kind;
+        switch (kind) {
+        case PropertyColumn::Number:  column.numbers.resize(row + 1, qQNaN()); break;
+        case PropertyColumn::String:  column.strings.resize(row + 1, -1); break;
+        default:                      column.variants.resize(row + 1); break;
+        }
+    }
+
+    // 类型冲突时退化为 QVariant 列
+    if (column.kind != kind && column.kind != PropertyColumn::Variant) {
+        QList<QVariant> variants;
+        variants.reserve(row + 1);
+        for (int i = 0; i <= row; ++i) {
+            variants.append(property(i, m_columnIndex.value(column.name)));
+        }
+        column.variants = variants;
+        column.numbers.clear();
+        column.strings.clear();
+        column.kind = PropertyColumn::Variant;
+    }
+
+    switch (column.kind) {
+    case PropertyColumn::Number:
+        column.numbers[row] = value.toDouble();
+        break;
+    case PropertyColumn::String: {
+        const QString text = value.toString();
+        qint32 index = m_stringIndex.value(text, -1);
+        if (index < 0) {
+            index = qint32(m_stringPool.size());
+            m_stringPool.append(text);
+            m_stringIndex.insert(text, index);
+        }
+        column.strings[row] = index;
+        break;
+    }
+    default:
+        column.variants[row] = value;
+        break;
+    }
+}
+
+QVariant FeatureStore::property(int feature, int column) const
+{
+    const PropertyColumn& c = m_columns.at(column);
+    switch (c.kind) {
+    case PropertyColumn::Number: {
+        // 数值列在确定类型之前的行不存在
+        if (feature < c.numbers.size() && !qIsNaN(c.numbers.at(feature))) {
+            return c.numbers.at(feature);
+        }
+        break;
+    }
+    case PropertyColumn::String: {
+        const qint32 index = feature < c.strings.size() ? c.strings.at(feature) : -1;
+        if (index >= 0) {
+            return m_stringPool.at(index);
+        }
+        break;
+    }
+    case PropertyColumn::Variant:
+        if (feature < c.variants.size() && c.variants.at(feature).isValid()) {
+            return c.variants.at(feature);
+        }
+        break;
+    case PropertyColumn::Empty:
+        break;
+    }
+    return c.isNull(feature) ? QVariant::fromValue(nullptr) : QVariant();
+}
+
+QVariant FeatureStore::property(int feature, const QString& name) const
+{
+    const int column = propertyColumnIndex(name);
+    return column < 0 ? QVariant() : property(feature, column);
+}
+
+QVariantMap FeatureStore::properties(int feature) const
+{
+    QVariantMap result;
+    for (int i = 0; i < m_columns.size(); ++i) {
+        QVariant value = property(feature, i);
+        if (value.isValid()) {
+            result.insert(m_columns.at(i).name, value);
+        }
+    }
+    return result;
+}
+
+QGeoRectangle FeatureStore::featureBounds(int feature) const
+{
+    const int begin = featureCoordBegin(feature);
+    const int end = featureCoordEnd(feature);
+    if (begin >= end) {
+        return QGeoRectangle();
+    }
+
+    const double* lon = m_lon.constData();
+    const double* lat = m_lat.constData();
+    double minLon = lon[begin], maxLon = lon[begin];
+    double minLat = lat[begin], maxLat = lat[begin];
+    for (int i = begin + 1; i < end; ++i) {
+        minLon = qMin(minLon, lon[i]);
+        maxLon = qMax(maxLon, lon[i]);
+        minLat = qMin(minLat, lat[i]);
+        maxLat = qMax(maxLat, lat[i]);
+    }
+
+    return QGeoRectangle(QGeoCoordinate(maxLat, minLon),
+                         QGeoCoordinate(minLat, maxLon));
+}
+
+QGeoRectangle FeatureStore::bounds() const
+{
+    if (m_lon.isEmpty()) {
+        return QGeoRectangle();
+    }
+    return QGeoRectangle(QGeoCoordinate(m_maxLat, m_minLon),
+                         QGeoCoordinate(m_minLat, m_maxLon));
+}
+
+void FeatureStore::computeImportance()
+{
+    constexpr float kKeep = std::numeric_limits<float>::infinity();
+    constexpr double kMetersPerDegree = 6371008.8 * M_PI / 180.0;
+
+    m_importance.fill(kKeep, m_lon.size());
+    float* importance = m_importance.data();
+
+    struct Range {
+        int first;
+        int last;
+        float parent;   // 父区间分割点的重要度，子区间不得超过它
+    };
+    QList<Range> stack;
+
+    for (int f = 0; f < featureCount(); ++f) {
+        // GeometryCollection 的成员类型可能不同，按组判断
+        for (int group = groupBegin(f); group < groupEnd(f); ++group) {
+            const GeometryType type = groupType(f, group);
+            if (type == GeometryType::Point || type == GeometryType::MultiPoint) {
+                continue;
+            }
+            const bool ring = type == GeometryType::Polygon || type == GeometryType::MultiPolygon;
+
+            for (int part = partBegin(group); part < partEnd(group); ++part) {
+                const int begin = coordBegin(part);
+                const int end = coordEnd(part);
+                if (end - begin < 3) {
+                    continue;
+                }
+
+                // 部件内使用中间纬度的等距圆柱投影
+                const double lonScale = qCos(qDegreesToRadians(m_lat.at((begin + end) / 2)));
+
+                // 环的首尾重合，再保留离起点最远的顶点，保证抽稀后仍是有效的环
+                stack.append({begin, end - 1, kKeep});
+                if (ring) {
+                    int farthest = begin + 1;
+                    double farthestDistance = -1.0;
+                    for (int i = begin + 1; i < end - 1; ++i) {
+                        const double dx = (m_lon.at(i) - m_lon.at(begin)) * lonScale;
+                        const double dy = m_lat.at(i) - m_lat.at(begin);
+                        const double distance = dx * dx + dy * dy;
+                        if (distance > farthestDistance) {
+                            farthestDistance = distance;
+                            farthest = i;
+                        }
+                    }
+                    stack.last() = {begin, farthest, kKeep};
+                    stack.append({farthest, end - 1, kKeep});
+                }
+
+                while (!stack.isEmpty()) {
+                    const Range range = stack.takeLast();
+                    if (range.last - range.first < 2) {
+                        continue;
+                    }
+
+                    const double ax = m_lon.at(range.first) * lonScale;
+                    const double ay = m_lat.at(range.first);
+                    const double dx = m_lon.at(range.last) * lonScale - ax;
+                    const double dy = m_lat.at(range.last) - ay;
+                    const double lengthSquared = dx * dx + dy * dy;
+
+                    int split = range.first + 1;
+                    double maxDistance = -1.0;
+                    for (int i = range.first + 1; i < range.last; ++i) {
+                        const double px = m_lon.at(i) * lonScale - ax;
+                        const double py = m_lat.at(i) - ay;
+                        double t = lengthSquared > 0.0 ? (px * dx + py * dy) / lengthSquared : 0.0;
+                        t = qBound(0.0, t, 1.0);
+                        const double ex = px - t * dx;
+                        const double ey = py - t * dy;
+                        const double distance = ex * ex + ey * ey;
+                        if (distance > maxDistance) {
+                            maxDistance = distance;
+                            split = i;
+                        }
+                    }
+
+                    const float value = qMin(float(qSqrt(maxDistance) * kMetersPerDegree), range.parent);
+                    importance[split] = value;
+                    stack.append({range.first, split, value});
+                    stack.append({split, range.last, value});
+                }
+            }
+        }
+    }
+}
+
+int FeatureStore::vertexCount(double tolerance) const
+{
+    if (m_importance.isEmpty() || tolerance <= 0.0) {
+        return m_lon.size();
+    }
+    return int(std::count_if(m_importance.cbegin(), m_importance.cend(),
+                             [tolerance](float value) { return value >= tolerance; }));
+}
+
+double FeatureStore::toleranceForVertexBudget(int maxVertices) const
+{
+    if (m_importance.isEmpty() || maxVertices <= 0 || maxVertices >= m_importance.size()) {
+        return 0.0;
+    }
+
+    // 第 maxVertices+1 大的重要度之上的顶点恰好不超过预算（重要度相同的顶点可能被一起剔除）
+    QList<float> values = m_importance;
+    std::nth_element(values.begin(), values.begin() + maxVertices, values.end(), std::greater<float>());
+    return std::nextafter(double(values.at(maxVertices)), std::numeric_limits<double>::infinity());
+}
+
+double FeatureStore::toleranceFor(double zoom, int maxVertices) const
+{
+    if (m_importance.isEmpty()) {
+        return 0.0;
+    }
+    double tolerance = toleranceForZoom(zoom, (m_minLat + m_maxLat) * 0.5);
+    if (maxVertices > 0) {
+        tolerance = qMax(tolerance, toleranceForVertexBudget(maxVertices));
+    }
+    return tolerance;
+}
+
+double FeatureStore::toleranceForZoom(double zoom, double latitude)
+{
+    // 半个像素对应的地面距离（256 像素瓦片的 Web 墨卡托）
+    const double metersPerPixel = 156543.03392 * qCos(qDegreesToRadians(latitude)) / qPow(2.0, zoom);
+    return metersPerPixel * 0.5;
+}
+
+QString FeatureStore::geometryTypeName(GeometryType type)
+{
+    switch (type) {
+    case GeometryType::Point:           return QStringLiteral("Point");
+    case GeometryType::MultiPoint:      return QStringLiteral("MultiPoint");
+    case GeometryType::LineString:      return QStringLiteral("LineString");
+    case GeometryType::MultiLineString: return QStringLiteral("MultiLineString");
+    case GeometryType::Polygon:         return QStringLiteral("Polygon");
+    case GeometryType::MultiPolygon:    return QStringLiteral("MultiPolygon");
+    case GeometryType::GeometryCollection: return QStringLiteral("GeometryCollection");
+    }
+    return QString();
+}
+
+QJsonObject FeatureStore::geometryToGeoJSON(GeometryType type, int firstGroup, int lastGroup,
+                                             double tolerance) const
+{
+    const bool simplify = tolerance > 0.0 && !m_importance.isEmpty();
+
+    auto position = [this](int i) {
+        QJsonArray coord;
+        coord.append(m_lon.at(i));
+        coord.append(m_lat.at(i));
+        if (m_hasAltitude) {
+            coord.append(double(m_alt.at(i)));
+        }
+        return coord;
+    };
+
+    auto partArray = [this, &position, simplify, tolerance](int part) {
+        QJsonArray coords;
+        for (int i = coordBegin(part); i < coordEnd(part); ++i) {
+            if (!simplify || m_importance.at(i) >= tolerance) {
+                coords.append(position(i));
+            }
+        }
+        return coords;
+    };
+
+    QJsonValue coordinates;
+    switch (type) {
+    case GeometryType::Point:
+        if (coordBegin(partBegin(firstGroup)) < coordEnd(partBegin(firstGroup))) {
+            coordinates = position(coordBegin(partBegin(firstGroup)));
+        }
+        break;
+
+    case GeometryType::MultiPoint:
+    case GeometryType::LineString:
+        coordinates = partArray(partBegin(firstGroup));
+        break;
+
+    case GeometryType::MultiLineString: {
+        QJsonArray lines;
+        for (int g = firstGroup; g < lastGroup; ++g) {
+            for (int p = partBegin(g); p < partEnd(g); ++p) {
+                lines.append(partArray(p));
+            }
+        }
+        coordinates = lines;
+        break;
+    }
+
+    case GeometryType::Polygon: {
+        QJsonArray rings;
+        for (int p = partBegin(firstGroup); p < partEnd(firstGroup); ++p) {
+            rings.append(partArray(p));
+        }
+        coordinates = rings;
+        break;
+    }
+
+    case GeometryType::MultiPolygon: {
+        QJsonArray polygons;
+        for (int g = firstGroup; g < lastGroup; ++g) {
+            QJsonArray rings;
+            for (int p = partBegin(g); p < partEnd(g); ++p) {
+                rings.append(partArray(p));
+            }
+            polygons.append(rings);
+        }
+        coordinates = polygons;
+        break;
+    }
+
+    case GeometryType::GeometryCollection:
+        break;
+    }
+
+    QJsonObject geometry;
+    geometry["type"] = geometryTypeName(type);
+    geometry["coordinates"] = coordinates;
+    return geometry;
+}
+
+QJsonObject FeatureStore::featureToGeoJSON(int feature, double tolerance) const
+{
+    const GeometryType type = geometryType(feature);
+    const int firstGroup = groupBegin(feature);
+    const int lastGroup = groupEnd(feature);
+
+    QJsonValue geometry;
+    if (type == GeometryType::GeometryCollection) {
+        QJsonArray geometries;
+        for (int g = firstGroup; g < lastGroup; g = geometryEnd(feature, g)) {
+            geometries.append(geometryToGeoJSON(groupType(feature, g), g, geometryEnd(feature, g), tolerance));
+        }
+        geometry = QJsonObject{ { "type", geometryTypeName(type) }, { "geometries", geometries } };
+    } else if (hasGeometry(feature)) {
+        geometry = geometryToGeoJSON(type, firstGroup, lastGroup, tolerance);
+    }
+
+    QJsonObject result;
+    result["type"] = "Feature";
+    if (m_featureIds.at(feature).isValid()) {
+        result["id"] = QJsonValue::fromVariant(m_featureIds.at(feature));
+    }
+    result["geometry"] = geometry;      // 没有几何时为 null
+    result["properties"] = QJsonObject::fromVariantMap(properties(feature));
+    return result;
+}
+
+QByteArray FeatureStore::toGeoJSONData(double tolerance) const
+{
+    QByteArray out;
+    // 每个坐标约 40 字节，预留后基本不再扩容
+    out.reserve(qsizetype(coordinateCount()) * 40 + qsizetype(featureCount()) * 64 + 64);
+    out += "{\"type\":\"FeatureCollection\",\"features\":[";
+    for (int i = 0; i < featureCount(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        writeFeature(out, i, tolerance);
+    }
+    out += "]}";
+    return out;
+}
+
+void FeatureStore::writeGeometry(QByteArray& out, GeometryType type, int firstGroup, int lastGroup,
+                                 double tolerance) const
+{
+    const bool simplify = tolerance > 0.0 && !m_importance.isEmpty();
+
+    auto position = [this, &out](int i) {
+        out += '[';
+        appendNumber(out, m_lon.at(i));
+        out += ',';
+        appendNumber(out, m_lat.at(i));
+        if (m_hasAltitude) {
+            out += ',';
+            appendNumber(out, double(m_alt.at(i)));
+        }
+        out += ']';
+    };
+
+    auto part = [this, &out, &position, simplify, tolerance](int p) {
+        out += '[';
+        bool first = true;
+        for (int i = coordBegin(p); i < coordEnd(p); ++i) {
+            if (!simplify || m_importance.at(i) >= tolerance) {
+                if (!first) {
+                    out += ',';
+                }
+                position(i);
+                first = false;
+            }
+        }
+        out += ']';
+    };
+
+    auto rings = [this, &out, &part](int group) {
+        out += '[';
+        for (int p = partBegin(group); p < partEnd(group); ++p) {
+            if (p > partBegin(group)) {
+                out += ',';
+            }
+            part(p);
+        }
+        out += ']';
+    };
+
+    out += "{\"type\":";
+    appendString(out, geometryTypeName(type));
+    out += ",\"coordinates\":";
+
+    switch (type) {
+    case GeometryType::Point:
+        if (coordBegin(partBegin(firstGroup)) < coordEnd(partBegin(firstGroup))) {
+            position(coordBegin(partBegin(firstGroup)));
+        } else {
+            out += "null";
+        }
+        break;
+
+    case GeometryType::MultiPoint:
+    case GeometryType::LineString:
+        part(partBegin(firstGroup));
+        break;
+
+    case GeometryType::MultiLineString: {
+        out += '[';
+        bool first = true;
+        for (int g = firstGroup; g < lastGroup; ++g) {
+            for (int p = partBegin(g); p < partEnd(g); ++p) {
+                if (!first) {
+                    out += ',';
+                }
+                part(p);
+                first = false;
+            }
+        }
+        out += ']';
+        break;
+    }
+
+    case GeometryType::Polygon:
+        rings(firstGroup);
+        break;
+
+    case GeometryType::MultiPolygon:
+        out += '[';
+        for (int g = firstGroup; g < lastGroup; ++g) {
+            if (g > firstGroup) {
+                out += ',';
+            }
+            rings(g);
+        }
+        out += ']';
+        break;
+
+    case GeometryType::GeometryCollection:
+        out += "null";
+        break;
+    }
+    out += '}';
+}
+
+void FeatureStore::writeFeature(QByteArray& out, int feature, double tolerance) const
+{
+    const GeometryType type = geometryType(feature);
+    const int firstGroup = groupBegin(feature);
+    const int lastGroup = groupEnd(feature);
+
+    out += "{\"type\":\"Feature\",";
+    // ID 按原来的 JSON 类型写回：MapLibre 只把数值 ID 用于 feature-state
+    const QVariant& id = m_featureIds.at(feature);
+    if (id.typeId() == QMetaType::QString) {
+        out += "\"id\":";
+        appendString(out, id.toString());
+        out += ',';
+    } else if (id.isValid()) {
+        out += "\"id\":";
+        appendNumber(out, id.toDouble());
+        out += ',';
+    }
+
+    out += "\"geometry\":";
+    if (type == GeometryType::GeometryCollection) {
+        out += "{\"type\":\"GeometryCollection\",\"geometries\":[";
+        for (int g = firstGroup; g < lastGroup; g = geometryEnd(feature, g)) {
+            if (g > firstGroup) {
+                out += ',';
+            }
+            writeGeometry(out, groupType(feature, g), g, geometryEnd(feature, g), tolerance);
+        }
+        out += "]}";
+    } else if (hasGeometry(feature)) {
+        writeGeometry(out, type, firstGroup, lastGroup, tolerance);
+    } else {
+        out += "null";
+    }
+
+    out += ",\"properties\":{";
+    bool first = true;
+    for (int column = 0; column < m_columns.size(); ++column) {
+        const PropertyColumn& c = m_columns.at(column);
+        // 数值和字符串列直接读列数据，不经过 QVariant
+        bool missing = true;
+        if (c.kind == PropertyColumn::Number) {
+            missing = feature >= c.numbers.size() || qIsNaN(c.numbers.at(feature));
+        } else if (c.kind == PropertyColumn::String) {
+            missing = feature >= c.strings.size() || c.strings.at(feature) < 0;
+        } else if (c.kind == PropertyColumn::Variant) {
+            missing = feature >= c.variants.size() || !c.variants.at(feature).isValid();
+        }
+        if (missing && !c.isNull(feature)) {
+            continue;
+        }
+
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        appendString(out, c.name);
+        out += ':';
+        if (missing) {
+            out += "null";
+            continue;
+        }
+        switch (c.kind) {
+        case PropertyColumn::Number:
+            appendNumber(out, c.numbers.at(feature));
+            break;
+        case PropertyColumn::String:
+            appendString(out, m_stringPool.at(c.strings.at(feature)));
+            break;
+        default:
+            appendVariant(out, c.variants.at(feature));
+            break;
+        }
+    }
+    out += "}}";
+}
+
+QJsonObject FeatureStore::toGeoJSON(double tolerance) const
+{
+    QJsonArray features;
+    for (int i = 0; i < featureCount(); ++i) {
+        features.append(featureToGeoJSON(i, tolerance));
+    }
+
+    QJsonObject geoJson;
+    geoJson["type"] = "FeatureCollection";
+    geoJson["features"] = features;
+    return geoJson;
+}
+
+} // namespace YEFS
@@ -0,0 +1,239 @@
+#ifndef YEFS_FEATURESTORE_H
+#define YEFS_FEATURESTORE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QJsonObject>
+#include <QGeoRectangle>
+#include <algorithm>
+#include <limits>
+
+namespace YEFS {
+
+/**
+ * @brief 要素几何类型
+ */
+enum class GeometryType : quint8 {
+    Point,
+    MultiPoint,
+    LineString,
+    MultiLineString,
+    Polygon,
+    MultiPolygon,
+    GeometryCollection      // 成员几何依次占用若干组，成员类型见 FeatureStore::groupType()
+};
+
+/**
+ * @brief 单个要素的几何暂存区
+ *
+ * 解析器先把一个要素的坐标写入这里，再整体提交到 FeatureStore。
+ * 层级关系：组（多边形） → 部件（线段/环） → 坐标。
+ */
+struct FeatureGeometry {
+    static constexpr qint64 NoTimestamp = std::numeric_limits<qint64>::min();
+
+    GeometryType type = GeometryType::Point;
+    QList<double> lon;
+    QList<double> lat;
+    QList<float> alt;
+    QList<qint64> timestamps;   // 可选，毫秒时间戳，为空表示无时间信息
+    QList<quint32> partEnds;    // 每个部件结束时的累计坐标数
+    QList<quint32> groupEnds;   // 每个组结束时的累计部件数
+    bool hasAltitude = false;
+
+    void addCoordinate(double longitude, double latitude) {
+        lon.append(longitude);
+        lat.append(latitude);
+        alt.append(0.0f);
+    }
+    void addCoordinate(double longitude, double latitude, double altitude) {
+        lon.append(longitude);
+        lat.append(latitude);
+        alt.append(float(altitude));
+        hasAltitude = true;
+    }
+    void setLastAltitude(double altitude) {
+        alt.last() = float(altitude);
+        hasAltitude = true;
+    }
+    void setLastTimestamp(qint64 msecs) {
+        timestamps.resize(lon.size(), NoTimestamp);
+        timestamps.last() = msecs;
+    }
+    void endPart() { partEnds.append(quint32(lon.size())); }
+    void endGroup() { groupEnds.append(quint32(partEnds.size())); }
+
+    int coordinateCount() const { return lon.size(); }
+    bool isEmpty() const { return lon.isEmpty(); }
+    void clear();
+};
+
+/**
+ * @brief 要素属性列
+ *
+ * 按首个非空值确定列类型：数值列使用 double（NaN 表示缺失），
+ * 字符串列保存字符串池下标（-1 表示缺失），类型混杂时退化为 QVariant 列。
+ */
+struct PropertyColumn {
+    enum Kind : quint8 {
+        Empty,
+        Number,
+        String,
+        Variant
+    };
+
+    QString name;
+    Kind kind = Empty;
+    QList<double> numbers;
+    QList<qint32> strings;
+    QList<QVariant> variants;
+    QList<qint32> nulls;        // 属性值为显式 null 的行（升序），这些行的单元格为缺失值
+
+    bool isNull(int row) const { return std::binary_search(nulls.cbegin(), nulls.cend(), row); }
+};
+
+/**
+ * @brief 紧凑的矢量要素存储（列式）
+ *
+ * 所有矢量数据源（GeoJSON、GPX、KML）共用的存储结构：
+ * 坐标保存在连续的 lon/lat/alt 数组中，通过偏移数组描述
+ * 要素 → 组 → 部件 → 坐标 的层级关系，属性按列存储。
+ * 所有列都是隐式共享的 QList，复制开销很小。
+ *
+ * 几何为 null 的要素没有组；GeometryCollection 是一个要素，每个成员占用至少一个组，
+ * 各组的成员类型记录在按需创建的组类型列中。要素 ID 保留 GeoJSON 中的类型（字符串或数值）。
+ */
+class FeatureStore
+{
+public:
+    FeatureStore();
+
+    // 写入
+    int append(const FeatureGeometry& geometry,
+               const QVariantMap& properties = QVariantMap(),
+               const QVariant& featureId = QVariant());
+    int appendCollection(const QList<FeatureGeometry>& members,
+                         const QVariantMap& properties = QVariantMap(),
+                         const QVariant& featureId = QVariant());
+    // 几何为 null 的要素，只有属性
+    int appendWithoutGeometry(const QVariantMap& properties = QVariantMap(),
+                              const QVariant& featureId = QVariant());
+    void clear();
+    void squeeze();
+
+    // 统计
+    int featureCount() const { return m_types.size(); }
+    int coordinateCount() const { return m_lon.size(); }
+    bool isEmpty() const { return m_types.isEmpty(); }
+    bool hasAltitude() const { return m_hasAltitude; }
+
+    // 要素访问
+    GeometryType geometryType(int feature) const { return GeometryType(m_types.at(feature)); }
+    bool hasGeometry(int feature) const {
+        return groupBegin(feature) < groupEnd(feature) || geometryType(feature) == GeometryType::GeometryCollection;
+    }
+    // 字符串或数值，没有 ID 时无效
+    QVariant featureId(int feature) const { return m_featureIds.at(feature); }
+    // 组所属几何的类型：GeometryCollection 为成员的类型，其他要素为要素本身的类型
+    GeometryType groupType(int feature, int group) const;
+    // 该组是否开始一个新的几何（MultiPolygon 的后续多边形属于同一几何）
+    bool startsGeometry(int feature, int group) const;
+    QGeoRectangle featureBounds(int feature) const;
+
+    // 属性列
+    int propertyColumnCount() const { return m_columns.size(); }
+    const PropertyColumn& propertyColumn(int column) const { return m_columns.at(column); }
+    int propertyColumnIndex(const QString& name) const { return m_columnIndex.value(name, -1); }
+    QVariant property(int feature, int column) const;
+    QVariant property(int feature, const QString& name) const;
+    QVariantMap properties(int feature) const;
+
+    // 层级偏移：[begin, end)
+    int groupBegin(int feature) const { return int(m_featureOffsets.at(feature)); }
+    int groupEnd(int feature) const { return int(m_featureOffsets.at(feature + 1)); }
+    int partBegin(int group) const { return int(m_groupOffsets.at(group)); }
+    int partEnd(int group) const { return int(m_groupOffsets.at(group + 1)); }
+    int coordBegin(int part) const { return int(m_partOffsets.at(part)); }
+    int coordEnd(int part) const { return int(m_partOffsets.at(part + 1)); }
+    int featureCoordBegin(int feature) const { return coordBegin(partBegin(groupBegin(feature))); }
+    int featureCoordEnd(int feature) const { return coordBegin(partBegin(groupEnd(feature))); }
+
+    // 坐标列
+    const double* longitudes() const { return m_lon.constData(); }
+    const double* latitudes() const { return m_lat.constData(); }
+    const float* altitudes() const { return m_alt.constData(); }
+    bool hasTimestamps() const { return !m_timestamps.isEmpty(); }
+    qint64 timestamp(int coord) const {
+        return m_timestamps.isEmpty() ? FeatureGeometry::NoTimestamp : m_timestamps.at(coord);
+    }
+
+    // 范围
+    QGeoRectangle bounds() const;
+
+    // 多分辨率抽稀：为线和环的每个顶点计算 Douglas-Peucker 保留容差（米），
+    // 端点为无穷大。导出时只保留重要度不小于容差的顶点
+    void computeImportance();
+    bool hasImportance() const { return !m_importance.isEmpty(); }
+    float importance(int coord) const {
+        return m_importance.isEmpty() ? std::numeric_limits<float>::infinity() : m_importance.at(coord);
+    }
+    int vertexCount(double tolerance) const;
+    double toleranceForVertexBudget(int maxVertices) const;
+    static double toleranceForZoom(double zoom, double latitude);
+    // 缩放级别（数据范围中心纬度的半像素）与顶点预算两者要求的容差取较大者；没有重要度时为 0
+    double toleranceFor(double zoom, int maxVertices = -1) const;
+
+    // 导出（tolerance 为 0 时输出全部顶点）
+    QJsonObject featureToGeoJSON(int feature, double tolerance = 0.0) const;
+    QJsonObject toGeoJSON(double tolerance = 0.0) const;
+    // 直接从各列写出 UTF-8 GeoJSON 文本，不构建 QJsonObject 树；内容与 toGeoJSON() 相同
+    QByteArray toGeoJSONData(double tolerance = 0.0) const;
+
+    static QString geometryTypeName(GeometryType type);
+
+private:
+    friend class FeatureCache;
+
+    static constexpr quint8 ContinuesMember = 0x80;    // 组类型标记：属于上一组的成员
+
+    void appendGeometry(const FeatureGeometry& geometry);
+    int finishFeature(GeometryType type, const QVariantMap& properties, const QVariant& featureId);
+    void appendProperties(const QVariantMap& properties);
+    void setProperty(PropertyColumn& column, int row, const QVariant& value);
+    int geometryEnd(int feature, int group) const;
+    QJsonObject geometryToGeoJSON(GeometryType type, int firstGroup, int lastGroup, double tolerance) const;
+    void writeFeature(QByteArray& out, int feature, double tolerance) const;
+    void writeGeometry(QByteArray& out, GeometryType type, int firstGroup, int lastGroup,
+                       double tolerance) const;
+
+    QList<double> m_lon;
+    QList<double> m_lat;
+    QList<float> m_alt;
+    QList<qint64> m_timestamps;
+    QList<float> m_importance;
+    QList<quint32> m_partOffsets;       // 部件 → 坐标
+    QList<quint32> m_groupOffsets;      // 组 → 部件
+    QList<quint32> m_featureOffsets;    // 要素 → 组
+    QList<quint8> m_types;
+    QList<quint8> m_groupTypes;         // 组 → 成员类型，仅在有 GeometryCollection 时创建
+    QList<QVariant> m_featureIds;
+
+    QList<PropertyColumn> m_columns;
+    QHash<QString, int> m_columnIndex;
+    QStringList m_stringPool;
+    QHash<QString, qint32> m_stringIndex;
+
+    double m_minLon = 180.0;
+    double m_maxLon = -180.0;
+    double m_minLat = 90.0;
+    double m_maxLat = -90.0;
+    bool m_hasAltitude = false;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_FEATURESTORE_H
@@ -6,13 +6,23 @@
 #include <QStringList>
 #include <QUrl>
 #include <QIODevice>
+#include <QBuffer>
+#include <QByteArrayView>
 #include <QQmlEngine>
 #include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QThreadPool>
+#include <functional>
+#include <utility>
 
 #include "IMapSource.h"
+#include "ParseTask.h"
 
 namespace YEFS {
 
+class ParserLease;
+
 /**
  * @brief 地图格式解析器接口
  * 
@@ -35,6 +45,10 @@ public:
     virtual QStringList supportedExtensions() const = 0;
     virtual QStringList mimeTypes() const { return QStringList(); }
 
+    // 需要随机访问整个文件（瓦片包、数据库）的格式只能通过 parse(filePath) 打开，
+    // 不走内存数据解析和要素缓存
+    virtual bool needsFilePath() const { return false; }
+
     // 格式检测
     virtual bool canParse(const QString& filePath) const = 0;
     virtual bool canParse(QIODevice* device) const = 0;
@@ -43,6 +57,39 @@ public:
     virtual IMapSource* parse(const QString& filePath) = 0;
     virtual IMapSource* parse(QIODevice* device, const QString& sourceName) = 0;
 
+    // 从内存数据（通常是内存映射文件）检测与解析，data 只需在调用期间有效。
+    // control 非空时解析器应定期调用 checkpoint()，被取消后返回 nullptr 且不得泄漏半成品。
+    // 默认实现通过 QBuffer 包装为 QIODevice，不复制数据，只在开始前检查取消
+    virtual bool canParseData(QByteArrayView data) const {
+        QByteArray bytes = QByteArray::fromRawData(data.data(), data.size());
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::ReadOnly);
+        return canParse(&buffer);
+    }
+    virtual IMapSource* parseData(QByteArrayView data, const QString& sourceName,
+                                  ParseControl* control = nullptr) {
+        if (control && control->isCanceled()) {
+            return nullptr;
+        }
+        QByteArray bytes = QByteArray::fromRawData(data.data(), data.size());
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::ReadOnly);
+        return parse(&buffer, sourceName);
+    }
+
+    // 用缓存的要素数据直接重建数据源（不重新解析），不支持时返回 nullptr
+    virtual IMapSource* createSource(const QString& sourceName, FeatureStore store,
+                                     SpatialIndex index) {
+        Q_UNUSED(sourceName)
+        Q_UNUSED(store)
+        Q_UNUSED(index)
+        return nullptr;
+    }
+
+    // 异步解析：在线程池（默认全局线程池）中执行，结果通过 ParseTask 交付。
+    // 任务持有解析器的使用计数，期间注销解析器会推迟到任务结束后删除
+    ParseTask* parseAsync(const QString& filePath, QThreadPool* pool = nullptr);
+
     // 批量解析
     virtual QList<IMapSource*> parseMultiple(const QString& filePath) { 
         auto source = parse(filePath);
@@ -52,12 +99,71 @@ public:
 signals:
     void parseProgress(int current, int total);
     void parseError(const QString& message);
+
+protected:
+    // 发出 parseError，同时记录到异步任务
+    void reportError(ParseControl* control, const QString& message) {
+        if (control) {
+            control->setError(message);
+        }
+        emit parseError(message);
+    }
+
+private:
+    friend class ParserLease;
+    friend class MapParserFactory;
+
+    void acquire();
+    void release();
+    // 注销：没有使用者时立即 deleteLater，否则由最后一个使用者释放时删除
+    void retire();
+
+    QMutex m_leaseMutex;
+    int m_leases = 0;
+    bool m_retired = false;
+};
+
+/**
+ * @brief 解析器使用计数的持有者
+ *
+ * 工作线程使用解析器期间持有，MapParserFactory::unregisterParser 不会在此期间删除解析器。
+ */
+class ParserLease
+{
+public:
+    ParserLease() = default;
+    explicit ParserLease(IMapParser* parser) : m_parser(parser) {
+        if (m_parser) {
+            m_parser->acquire();
+        }
+    }
+    ParserLease(ParserLease&& other) noexcept : m_parser(std::exchange(other.m_parser, nullptr)) {}
+    ParserLease& operator=(ParserLease&& other) noexcept {
+        std::swap(m_parser, other.m_parser);
+        return *this;
+    }
+    ParserLease(const ParserLease&) = delete;
+    ParserLease& operator=(const ParserLease&) = delete;
+    ~ParserLease() {
+        if (m_parser) {
+            m_parser->release();
+        }
+    }
+
+    IMapParser* get() const { return m_parser; }
+    IMapParser* operator->() const { return m_parser; }
+    explicit operator bool() const { return m_parser != nullptr; }
+
+private:
+    IMapParser* m_parser = nullptr;
 };
 
 /**
  * @brief 地图解析器工厂
  * 
  * 管理所有已注册的地图格式解析器
+ *
+ * 注册表由读写锁保护：解析任务在工作线程中查找解析器，插件按需激活时在工厂线程注册解析器。
  */
 class MapParserFactory : public QObject
 {
@@ -73,18 +179,33 @@ public:
     void registerParser(IMapParser* parser);
     void unregisterParser(const QString& name);
 
-    // 查询解析器
+    // 延迟注册：首次在工厂线程发起这些扩展名的解析前调用 activator（通常是加载提供解析器的插件），
+    // 之后按已注册的解析器处理。同一扩展名可以有多个提供者，按 owner 整体注销
+    using ExtensionActivator = std::function<void(const QString& extension)>;
+    void registerLazyExtensions(const QString& owner, const QStringList& extensions, ExtensionActivator activator);
+    void unregisterLazyExtensions(const QString& owner);
+
+    // 查询解析器。parser/allParsers 返回裸指针，只在工厂线程使用（注销发生在工厂线程）；
+    // 按文件/扩展名查找返回持有使用计数的 ParserLease，可在任意线程使用
     IMapParser* parser(const QString& name) const;
-    QList<IMapParser*> allParsers() const { return m_parsers.values(); }
-    IMapParser* parserForFile(const QString& filePath) const;
-    IMapParser* parserForExtension(const QString& extension) const;
+    QList<IMapParser*> allParsers() const;
+    ParserLease parserForFile(const QString& filePath) const;
+    ParserLease parserForExtension(const QString& extension) const;
 
     // 支持的格式
     Q_INVOKABLE QStringList supportedExtensions() const;
     Q_INVOKABLE QStringList supportedMimeTypes() const;
 
-    // 解析文件
+    // 解析文件（优先使用内存映射，零拷贝交给解析器）。
+    // 矢量数据源解析后写入 FeatureCache，源文件未变化时下次直接从缓存恢复
     Q_INVOKABLE IMapSource* parseFile(const QString& filePath);
+    IMapSource* parseFile(const QString& filePath, ParseControl* control);
+
+    // 异步解析文件，可在任意线程调用；任务句柄属于调用线程。
+    // 延迟注册的扩展名只在工厂线程发起时激活。
+    // QML 版本的任务句柄由工厂持有，finished 处理完后自动释放
+    Q_INVOKABLE ParseTask* parseFileAsync(const QString& filePath);
+    ParseTask* parseFileAsync(const QString& filePath, QThreadPool* pool);
 
 signals:
     void parserRegistered(const QString& name);
@@ -94,8 +215,22 @@ private:
     explicit MapParserFactory(QObject* parent = nullptr);
     ~MapParserFactory() override = default;
 
+    // 在读锁内找到第一个匹配的解析器并取得使用计数
+    ParserLease findParser(const std::function<bool(IMapParser*)>& match) const;
+    ParserLease leaseParser(const QString& name) const;
+    void activateExtension(const QString& filePath);
+    IMapSource* loadCached(const QString& filePath) const;
+    void saveCached(const QString& filePath, IMapParser* parser, IMapSource* source) const;
+
+    struct LazyProvider {
+        QString owner;
+        ExtensionActivator activator;
+    };
+
     static MapParserFactory* s_instance;
+    mutable QReadWriteLock m_lock;              // 保护 m_parsers
     QHash<QString, IMapParser*> m_parsers;
+    QHash<QString, QList<LazyProvider>> m_lazyExtensions;  // 小写扩展名 -> 提供者，仅在工厂线程访问
 };
 
 } // namespace YEFS
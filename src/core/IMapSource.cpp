@@ -0,0 +1,88 @@
+#include "IMapSource.h"
+
+namespace YEFS {
+
+// ============================================================================
+// IVectorMapSource 实现
+// ============================================================================
+
+namespace {
+
+QVariantList toVariantList(const QList<SpatialIndex::Neighbor>& neighbors)
+{
+    QVariantList result;
+    result.reserve(neighbors.size());
+    for (const SpatialIndex::Neighbor& neighbor : neighbors) {
+        result.append(QVariantMap{
+            {QStringLiteral("feature"), neighbor.feature},
+            {QStringLiteral("distance"), neighbor.distance}
+        });
+    }
+    return result;
+}
+
+} // namespace
+
+void IVectorMapSource::buildSpatialIndex(SpatialIndex prebuilt)
+{
+    if (!prebuilt.isEmpty() && prebuilt.size() == featureStore().featureCount()) {
+        m_spatialIndex = std::move(prebuilt);
+    } else {
+        m_spatialIndex.build(featureStore());
+    }
+}
+
+QVariantMap IVectorMapSource::toMapLibreLayer() const
+{
+    QVariantMap layer;
+    layer["id"] = id();
+    layer["type"] = "geojson";
+    layer["source"] = geoJSONData();      // 共享的 GeoJSON 文本
+    return layer;
+}
+
+QByteArray IVectorMapSource::geoJSONData() const
+{
+    QMutexLocker locker(&m_geoJSONMutex);
+    if (m_geoJSONData.isNull()) {
+        m_geoJSONData = featureStore().toGeoJSONData();
+    }
+    return m_geoJSONData;
+}
+
+QJsonObject IVectorMapSource::simplifiedGeoJSON(double zoom, int vertexBudget) const
+{
+    const FeatureStore& store = featureStore();
+    return store.toGeoJSON(store.toleranceFor(zoom, vertexBudget));
+}
+
+QList<int> IVectorMapSource::featuresInRect(const QGeoRectangle& rect) const
+{
+    return m_spatialIndex.search(rect);
+}
+
+QVariantList IVectorMapSource::featuresNear(const QGeoCoordinate& center, double radiusMeters) const
+{
+    return toVariantList(m_spatialIndex.withinRadius(featureStore(), center, radiusMeters));
+}
+
+QVariantList IVectorMapSource::nearestFeatures(const QGeoCoordinate& center, int count,
+                                               double maxDistanceMeters) const
+{
+    // 负数表示不限距离
+    if (maxDistanceMeters < 0) {
+        return toVariantList(m_spatialIndex.nearest(featureStore(), center, count));
+    }
+    return toVariantList(m_spatialIndex.nearest(featureStore(), center, count, maxDistanceMeters));
+}
+
+QVariantMap IVectorMapSource::featureProperties(int feature) const
+{
+    const FeatureStore& store = featureStore();
+    if (feature < 0 || feature >= store.featureCount()) {
+        return QVariantMap();
+    }
+    return store.properties(feature);
+}
+
+} // namespace YEFS
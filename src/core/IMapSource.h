@@ -9,6 +9,11 @@
 #include <QJsonObject>
 #include <QVariantMap>
 #include <QImage>
+#include <QMutex>
+#include <QUuid>
+
+#include "FeatureStore.h"
+#include "SpatialIndex.h"
 
 namespace YEFS {
 
@@ -69,23 +74,68 @@ signals:
 
 /**
  * @brief 矢量数据源接口
+ *
+ * 所有矢量数据源都通过列式的 FeatureStore 提供几何与属性，
+ * 范围计算、命中测试、抽稀和导出都直接基于它完成。
+ * 实现类在构造时（位于解析线程）调用 buildSpatialIndex() 建立空间索引，
+ * 从磁盘缓存恢复时直接采用缓存中的索引。
  */
 class IVectorMapSource : public IMapSource
 {
     Q_OBJECT
+    Q_PROPERTY(int featureCount READ featureCount NOTIFY dataChanged)
 
 public:
     explicit IVectorMapSource(QObject* parent = nullptr) : IMapSource(parent) {}
     virtual ~IVectorMapSource() = default;
 
     MapSourceType type() const override { return MapSourceType::Vector; }
+    QGeoRectangle bounds() const override { return featureStore().bounds(); }
+    QJsonObject toGeoJSON() const override { return featureStore().toGeoJSON(); }
+    // GeoJSON 图层，数据为 geoJSONData() 的共享文本
+    QVariantMap toMapLibreLayer() const override;
+
+    // 解析器创建数据源（解析完成或从缓存恢复），生成新的数据源 ID
+    template <typename Source>
+    static Source* create(const QString& name, FeatureStore store, SpatialIndex index = SpatialIndex()) {
+        return new Source(QUuid::createUuid().toString(QUuid::WithoutBraces), name,
+                          std::move(store), std::move(index));
+    }
+
+    // 列式要素存储
+    virtual const FeatureStore& featureStore() const = 0;
 
     // 矢量数据特有功能
-    virtual QJsonObject features() const = 0;
-    virtual int featureCount() const = 0;
+    virtual QJsonObject features() const { return featureStore().toGeoJSON(); }
+    virtual int featureCount() const { return featureStore().featureCount(); }
+
+    // 整个数据源的 GeoJSON 文本，首次调用时从 FeatureStore 直接写出并缓存。
+    // 缓冲区只读、隐式共享，交给地图时不经过 QJsonObject/QVariant 树，也不再复制
+    QByteArray geoJSONData() const;
     
-    // 样式
+    // 样式，各数据源只需提供默认样式
     virtual QVariantMap defaultStyle() const { return QVariantMap(); }
+
+    // 按缩放级别抽稀后的 GeoJSON：容差取半个像素的地面距离，vertexBudget > 0 时再限制总顶点数。
+    // 数据源未计算顶点重要度时输出全部顶点
+    Q_INVOKABLE QJsonObject simplifiedGeoJSON(double zoom, int vertexBudget = -1) const;
+
+    // 空间查询（返回要素下标；近邻查询返回 {feature, distance} 列表，距离单位为米）
+    const SpatialIndex& spatialIndex() const { return m_spatialIndex; }
+    Q_INVOKABLE QList<int> featuresInRect(const QGeoRectangle& rect) const;
+    Q_INVOKABLE QVariantList featuresNear(const QGeoCoordinate& center, double radiusMeters) const;
+    Q_INVOKABLE QVariantList nearestFeatures(const QGeoCoordinate& center, int count,
+                                             double maxDistanceMeters = -1) const;
+    Q_INVOKABLE QVariantMap featureProperties(int feature) const;
+
+protected:
+    // prebuilt 与要素数一致时直接采用，否则重新构建
+    void buildSpatialIndex(SpatialIndex prebuilt = SpatialIndex());
+
+private:
+    SpatialIndex m_spatialIndex;
+    mutable QMutex m_geoJSONMutex;
+    mutable QByteArray m_geoJSONData;
 };
 
 /**
@@ -0,0 +1,168 @@
+#include "LayerFeatureTable.h"
+#include <QJsonValue>
+#include <QSet>
+
+namespace YEFS {
+
+namespace {
+
+const QString kType = QStringLiteral("type");
+const QString kFeature = QStringLiteral("Feature");
+const QString kFeatures = QStringLiteral("features");
+const QString kId = QStringLiteral("id");
+
+} // namespace
+
+QString LayerFeatureTable::featureId(const QJsonObject& feature)
+{
+    const QJsonValue id = feature.value(kId);
+    if (id.isString()) {
+        return id.toString();
+    }
+    if (id.isDouble()) {
+        return QString::number(id.toDouble(), 'g', 17);
+    }
+    return QString();
+}
+
+QJsonArray LayerFeatureTable::normalize(const QJsonObject& geoJson)
+{
+    const QString type = geoJson.value(kType).toString();
+    if (type == QLatin1String("FeatureCollection")) {
+        return geoJson.value(kFeatures).toArray();
+    }
+    if (type == kFeature) {
+        return QJsonArray{ geoJson };
+    }
+    if (type.isEmpty()) {
+        return QJsonArray();
+    }
+    // 单个几何包装为要素
+    return QJsonArray{ QJsonObject{
+        { kType, kFeature },
+        { QStringLiteral("geometry"), geoJson },
+        { QStringLiteral("properties"), QJsonObject() }
+    } };
+}
+
+QJsonObject LayerFeatureTable::withId(QJsonObject feature, QString& id)
+{
+    id = featureId(feature);
+    if (id.isEmpty()) {
+        id = QStringLiteral("_auto_") + QString::number(m_nextAutoId++);
+        feature.insert(kId, id);
+    }
+    return feature;
+}
+
+bool LayerFeatureTable::store(const QString& id, const QJsonObject& feature)
+{
+    const auto it = m_index.constFind(id);
+    if (it == m_index.cend()) {
+        m_index.insert(id, m_features.size());
+        m_features.append(feature);
+        m_ids.append(id);
+        return true;
+    }
+    QJsonObject& existing = m_features[*it];
+    if (existing == feature) {
+        return false;
+    }
+    existing = feature;
+    return true;
+}
+
+bool LayerFeatureTable::take(const QString& id)
+{
+    const auto it = m_index.constFind(id);
+    if (it == m_index.cend()) {
+        return false;
+    }
+    // 与末尾交换后删除，保持 O(1)
+    const qsizetype index = *it;
+    const qsizetype last = m_features.size() - 1;
+    m_index.erase(it);
+    if (index != last) {
+        m_features[index] = std::move(m_features[last]);
+        m_ids[index] = std::move(m_ids[last]);
+        m_index[m_ids[index]] = index;
+    }
+    m_features.removeLast();
+    m_ids.removeLast();
+    return true;
+}
+
+LayerFeatureTable::Delta LayerFeatureTable::replace(const QJsonObject& geoJson)
+{
+    const QJsonArray features = normalize(geoJson);
+
+    QList<QPair<QString, QJsonObject>> incoming;
+    incoming.reserve(features.size());
+    QSet<QString> incomingIds;
+    incomingIds.reserve(features.size());
+    for (const QJsonValue& value : features) {
+        QString id;
+        const QJsonObject feature = withId(value.toObject(), id);
+        incoming.append({ id, feature });
+        incomingIds.insert(id);
+    }
+
+    Delta delta;
+    const QStringList previous = m_ids;
+    for (const QString& id : previous) {
+        if (!incomingIds.contains(id)) {
+            take(id);
+            delta.removed.append(id);
+        }
+    }
+    for (const auto& [id, feature] : std::as_const(incoming)) {
+        if (store(id, feature)) {
+            delta.upserted.append(feature);
+        }
+    }
+    return delta;
+}
+
+LayerFeatureTable::Delta LayerFeatureTable::upsert(const QJsonArray& features)
+{
+    Delta delta;
+    for (const QJsonValue& value : features) {
+        QString id;
+        const QJsonObject feature = withId(value.toObject(), id);
+        if (store(id, feature)) {
+            delta.upserted.append(feature);
+        }
+    }
+    return delta;
+}
+
+LayerFeatureTable::Delta LayerFeatureTable::remove(const QStringList& featureIds)
+{
+    Delta delta;
+    for (const QString& id : featureIds) {
+        if (take(id)) {
+            delta.removed.append(id);
+        }
+    }
+    return delta;
+}
+
+QJsonObject LayerFeatureTable::feature(const QString& featureId) const
+{
+    const auto it = m_index.constFind(featureId);
+    return it == m_index.cend() ? QJsonObject() : m_features.at(*it);
+}
+
+QJsonObject LayerFeatureTable::toGeoJSON() const
+{
+    QJsonArray features;
+    for (const QJsonObject& feature : m_features) {
+        features.append(feature);
+    }
+    return QJsonObject{
+        { kType, QStringLiteral("FeatureCollection") },
+        { kFeatures, features }
+    };
+}
+
+} // namespace YEFS
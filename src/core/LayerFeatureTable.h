@@ -0,0 +1,66 @@
+#ifndef YEFS_LAYERFEATURETABLE_H
+#define YEFS_LAYERFEATURETABLE_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+namespace YEFS {
+
+/**
+ * @brief GeoJSON 图层的要素表
+ *
+ * MapLibreEngine 为每个 GeoJSON 图层保留的副本：按要素 ID 索引的要素列表，
+ * 不保存整份 FeatureCollection。各要素与调用方传入的 JSON 隐式共享，不会复制。
+ * 要素 ID 取 GeoJSON Feature 的 "id" 成员；没有 ID 的要素分配 "_auto_<n>" 并写回要素，
+ * 这类要素每次整体替换时都会视为新要素。
+ * 修改操作返回相对于修改前的差量，只包含内容确实变化的要素。
+ */
+class LayerFeatureTable
+{
+public:
+    struct Delta {
+        QJsonArray upserted;        // 新增或内容变化的要素
+        QStringList removed;        // 删除的要素 ID
+
+        bool isEmpty() const { return upserted.isEmpty() && removed.isEmpty(); }
+        qsizetype size() const { return upserted.size() + removed.size(); }
+    };
+
+    // 用 FeatureCollection、Feature 或单个几何替换全部内容
+    Delta replace(const QJsonObject& geoJson);
+    // 按 ID 新增或替换要素
+    Delta upsert(const QJsonArray& features);
+    Delta remove(const QStringList& featureIds);
+
+    qsizetype size() const { return m_features.size(); }
+    bool contains(const QString& featureId) const { return m_index.contains(featureId); }
+    QJsonObject feature(const QString& featureId) const;
+
+    // 重新组装为 FeatureCollection，供不支持差量更新的地图项整体替换
+    QJsonObject toGeoJSON() const;
+
+    // 已分配的 "_auto_<n>" ID 数量；前后不同说明有要素被写入了 ID
+    quint64 generatedIdCount() const { return m_nextAutoId; }
+
+    static QString featureId(const QJsonObject& feature);
+
+private:
+    static QJsonArray normalize(const QJsonObject& geoJson);
+    QJsonObject withId(QJsonObject feature, QString& id);
+    // 返回 true 表示新增或内容变化
+    bool store(const QString& id, const QJsonObject& feature);
+    bool take(const QString& id);
+
+    QList<QJsonObject> m_features;
+    QList<QString> m_ids;                   // 与 m_features 一一对应
+    QHash<QString, qsizetype> m_index;      // ID -> 下标
+    quint64 m_nextAutoId = 0;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_LAYERFEATURETABLE_H
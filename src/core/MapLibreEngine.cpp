@@ -1,10 +1,27 @@
 #include "MapLibreEngine.h"
 #include "MessageBus.h"
+#include "MapSourceManager.h"
+#include "tiles/TileFetcher.h"
+#include "tiles/TilePrefetcher.h"
+#include "tiles/LocalTileServer.h"
+#include "tiles/TileMath.h"
+#include "tiles/VectorTileSlicer.h"
 #include <QDebug>
+#include <QMetaMethod>
 #include <QMetaObject>
+#include <QPointer>
+#include <QThreadPool>
+#include <QtMath>
 
 namespace YEFS {
 
+namespace {
+
+constexpr int kDefaultCameraUpdateIntervalMs = 16;
+constexpr int kSimplifiedVertexBudget = 200000;     // 按级别抽稀的图层每次最多发送的顶点数
+
+} // namespace
+
 MapLibreEngine* MapLibreEngine::s_instance = nullptr;
 
 MapLibreEngine::MapLibreEngine(QObject* parent)
@@ -16,6 +33,16 @@ MapLibreEngine::MapLibreEngine(QObject* parent)
     m_styles["MapTiler Satellite"] = "https://api.maptiler.com/maps/satellite/style.json";
 
     m_currentStyle = m_styles["OSM Demo"];
+
+    m_cameraTimer.setSingleShot(true);
+    m_cameraTimer.setInterval(kDefaultCameraUpdateIntervalMs);
+    connect(&m_cameraTimer, &QTimer::timeout, this, &MapLibreEngine::flushCameraUpdate);
+
+    // 相机主题在手势期间高频发布，预先登记为 TopicId
+    MessageBus* bus = MessageBus::instance();
+    m_cameraTopic = bus->topic(Topics::MAP_CAMERA_CHANGED);
+    m_centerTopic = bus->topic(Topics::MAP_CENTER_CHANGED);
+    m_zoomTopic = bus->topic(Topics::MAP_ZOOM_CHANGED);
 }
 
 MapLibreEngine* MapLibreEngine::instance()
@@ -41,7 +68,15 @@ QUrl MapLibreEngine::qmlComponent() const
 void MapLibreEngine::setMapItem(QObject* mapItem)
 {
     m_mapItem = mapItem;
+    m_mapItemSupportsDelta = false;
     if (m_mapItem) {
+        const QMetaObject* meta = m_mapItem->metaObject();
+        for (int i = 0; i < meta->methodCount(); ++i) {
+            if (meta->method(i).name() == "updateLayerFeatures") {
+                m_mapItemSupportsDelta = true;
+                break;
+            }
+        }
         qDebug() << "[MapLibreEngine] Map item connected";
     }
 }
@@ -93,18 +128,92 @@ void MapLibreEngine::flyTo(double latitude, double longitude, double zoom, int d
                                   Q_ARG(double, zoom),
                                   Q_ARG(int, durationMs));
     }
+    // 动画开始前预取目标位置的瓦片
+    TilePrefetcher::instance()->setFlyToTarget(latitude, longitude, zoom, durationMs);
 }
 
 void MapLibreEngine::addGeoJSONLayer(const QString& layerId, 
                                       const QJsonObject& geoJson,
                                       const QVariantMap& style)
 {
-    m_layers[layerId] = geoJson;
+    m_pendingTileLayers.remove(layerId);
+    m_simplifiedLayers.remove(layerId);
+    LayerFeatureTable table;
+    table.replace(geoJson);
+    m_featureTables.insert(layerId, table);
+    m_layers[layerId] = QJsonObject{ { QStringLiteral("type"), QStringLiteral("geojson") } };
 
     if (m_mapItem) {
+        // 为没有 ID 的要素分配了 ID 时发送要素表的内容，之后的差量才能按 ID 对应
         QMetaObject::invokeMethod(m_mapItem, "addGeoJSONLayer",
                                   Q_ARG(QString, layerId),
-                                  Q_ARG(QJsonObject, geoJson),
+                                  Q_ARG(QJsonObject, table.generatedIdCount() > 0 ? table.toGeoJSON() : geoJson),
+                                  Q_ARG(QVariantMap, style));
+    }
+
+    emit layerAdded(layerId);
+    MessageBus::instance()->publish(Topics::MAP_LAYER_ADDED, layerId);
+}
+
+bool MapLibreEngine::addVectorTileLayer(const QString& layerId, const QString& sourceId,
+                                        const QVariantMap& style)
+{
+    auto* source = qobject_cast<IVectorMapSource*>(MapSourceManager::instance()->source(sourceId));
+    if (!source) {
+        qWarning() << "[MapLibreEngine] Vector source not found:" << sourceId;
+        return false;
+    }
+
+    // 要素存储和空间索引隐式共享给切片器，不复制数据；投影坐标等准备工作放到线程池，
+    // 完成后回到主线程注册瓦片集。期间图层被移除或重新添加时丢弃这次结果
+    auto store = std::make_shared<const FeatureStore>(source->featureStore());
+    SpatialIndex index = source->spatialIndex();
+    const quint64 generation = ++m_tileLayerGeneration;
+    m_pendingTileLayers.insert(layerId, generation);
+
+    QPointer<MapLibreEngine> self(this);
+    QThreadPool::globalInstance()->start([self, layerId, sourceId, style, generation,
+                                          store = std::move(store), index = std::move(index)]() mutable {
+        auto slicer = std::make_shared<VectorTileSlicer>(std::move(store), std::move(index));
+        QMetaObject::invokeMethod(self, [self, layerId, sourceId, style, generation, slicer]() {
+            if (self) {
+                self->finishVectorTileLayer(layerId, sourceId, style, generation, slicer);
+            }
+        }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void MapLibreEngine::finishVectorTileLayer(const QString& layerId, const QString& sourceId,
+                                           const QVariantMap& style, quint64 generation,
+                                           const std::shared_ptr<VectorTileSlicer>& slicer)
+{
+    const auto pending = m_pendingTileLayers.constFind(layerId);
+    if (pending == m_pendingTileLayers.cend() || *pending != generation) {
+        return;
+    }
+    m_pendingTileLayers.erase(pending);
+    m_simplifiedLayers.remove(layerId);
+
+    const VectorTileSlicer::Options options = slicer->options();
+    const QString tileUrl = LocalTileServer::instance()->addTileset(layerId, slicer);
+    if (tileUrl.isEmpty()) {
+        qWarning() << "[MapLibreEngine] Cannot register tileset for layer:" << layerId;
+        return;
+    }
+
+    m_layers[layerId] = QJsonObject{
+        { QStringLiteral("type"), QStringLiteral("vector") },
+        { QStringLiteral("sourceId"), sourceId },
+        { QStringLiteral("tiles"), tileUrl }
+    };
+
+    if (m_mapItem) {
+        QMetaObject::invokeMethod(m_mapItem, "addVectorTileLayer",
+                                  Q_ARG(QString, layerId),
+                                  Q_ARG(QString, tileUrl),
+                                  Q_ARG(QString, options.layerName),
+                                  Q_ARG(int, options.maxZoom),
                                   Q_ARG(QVariantMap, style));
     }
 
@@ -112,9 +221,51 @@ void MapLibreEngine::addGeoJSONLayer(const QString& layerId,
     MessageBus::instance()->publish(Topics::MAP_LAYER_ADDED, layerId);
 }
 
+bool MapLibreEngine::addVectorSourceLayer(const QString& layerId, const QString& sourceId,
+                                          const QVariantMap& style)
+{
+    auto* source = qobject_cast<IVectorMapSource*>(MapSourceManager::instance()->source(sourceId));
+    if (!source) {
+        qWarning() << "[MapLibreEngine] Vector source not found:" << sourceId;
+        return false;
+    }
+
+    // 带顶点重要度的数据源（GPX 轨迹）按当前整数缩放级别抽稀后发送，级别变化时再更新
+    const FeatureStore& store = source->featureStore();
+    QByteArray data;
+    if (store.hasImportance()) {
+        const int level = qFloor(m_zoom);
+        data = store.toGeoJSONData(store.toleranceFor(level, kSimplifiedVertexBudget));
+        m_simplifiedLayers.insert(layerId, level);
+    } else {
+        data = source->geoJSONData();
+        m_simplifiedLayers.remove(layerId);
+    }
+    m_pendingTileLayers.remove(layerId);
+    m_layers[layerId] = QJsonObject{
+        { QStringLiteral("type"), QStringLiteral("geojson") },
+        { QStringLiteral("sourceId"), sourceId }
+    };
+
+    if (m_mapItem) {
+        QMetaObject::invokeMethod(m_mapItem, "addGeoJSONDataLayer",
+                                  Q_ARG(QString, layerId),
+                                  Q_ARG(QByteArray, data),
+                                  Q_ARG(QVariantMap, style));
+    }
+
+    emit layerAdded(layerId);
+    MessageBus::instance()->publish(Topics::MAP_LAYER_ADDED, layerId);
+    return true;
+}
+
 void MapLibreEngine::removeLayer(const QString& layerId)
 {
     m_layers.remove(layerId);
+    m_featureTables.remove(layerId);
+    m_pendingTileLayers.remove(layerId);
+    m_simplifiedLayers.remove(layerId);
+    LocalTileServer::instance()->removeTileset(layerId);
 
     if (m_mapItem) {
         QMetaObject::invokeMethod(m_mapItem, "removeLayer",
@@ -136,13 +287,57 @@ void MapLibreEngine::setLayerVisibility(const QString& layerId, bool visible)
 
 void MapLibreEngine::updateLayerData(const QString& layerId, const QJsonObject& geoJson)
 {
-    m_layers[layerId] = geoJson;
+    auto it = m_featureTables.find(layerId);
+    if (it == m_featureTables.end()) {
+        // 没有要素表的图层（如 addVectorSourceLayer 创建的）整体转发
+        if (m_mapItem) {
+            QMetaObject::invokeMethod(m_mapItem, "updateLayerData",
+                                      Q_ARG(QString, layerId),
+                                      Q_ARG(QJsonObject, geoJson));
+        }
+        return;
+    }
+    sendLayerDelta(layerId, *it, it->replace(geoJson));
+}
 
-    if (m_mapItem) {
-        QMetaObject::invokeMethod(m_mapItem, "updateLayerData",
+void MapLibreEngine::upsertFeatures(const QString& layerId, const QJsonArray& features)
+{
+    auto it = m_featureTables.find(layerId);
+    if (it == m_featureTables.end()) {
+        qWarning() << "[MapLibreEngine] GeoJSON layer not found:" << layerId;
+        return;
+    }
+    sendLayerDelta(layerId, *it, it->upsert(features));
+}
+
+void MapLibreEngine::removeFeatures(const QString& layerId, const QStringList& featureIds)
+{
+    auto it = m_featureTables.find(layerId);
+    if (it == m_featureTables.end()) {
+        qWarning() << "[MapLibreEngine] GeoJSON layer not found:" << layerId;
+        return;
+    }
+    sendLayerDelta(layerId, *it, it->remove(featureIds));
+}
+
+void MapLibreEngine::sendLayerDelta(const QString& layerId, const LayerFeatureTable& table,
+                                    const LayerFeatureTable::Delta& delta)
+{
+    if (!m_mapItem || delta.isEmpty()) {
+        return;
+    }
+
+    // 变化超过一半时整体替换比逐个打补丁更省
+    if (m_mapItemSupportsDelta && delta.size() * 2 <= table.size()) {
+        QMetaObject::invokeMethod(m_mapItem, "updateLayerFeatures",
                                   Q_ARG(QString, layerId),
-                                  Q_ARG(QJsonObject, geoJson));
+                                  Q_ARG(QJsonArray, delta.upserted),
+                                  Q_ARG(QStringList, delta.removed));
+        return;
     }
+    QMetaObject::invokeMethod(m_mapItem, "updateLayerData",
+                              Q_ARG(QString, layerId),
+                              Q_ARG(QJsonObject, table.toGeoJSON()));
 }
 
 void MapLibreEngine::setStyle(const QString& styleUrl)
@@ -206,40 +401,192 @@ void MapLibreEngine::onCenterChanged(double latitude, double longitude)
 {
     m_latitude = latitude;
     m_longitude = longitude;
-    emit centerChanged(latitude, longitude);
-    
-    QVariantMap data;
-    data["latitude"] = latitude;
-    data["longitude"] = longitude;
-    MessageBus::instance()->publish(Topics::MAP_CENTER_CHANGED, data);
+    scheduleCameraUpdate();
 }
 
 void MapLibreEngine::onZoomChanged(double zoom)
 {
     m_zoom = zoom;
-    emit zoomChanged(zoom);
-    MessageBus::instance()->publish(Topics::MAP_ZOOM_CHANGED, zoom);
+    scheduleCameraUpdate();
+}
+
+void MapLibreEngine::onVisibleRegionChanged(const QGeoRectangle& region)
+{
+    m_visibleRegion = region;
+    scheduleCameraUpdate();
+}
+
+void MapLibreEngine::onViewportSizeChanged(double width, double height)
+{
+    m_viewportSize = QSizeF(width, height);
+    scheduleCameraUpdate();
 }
 
 void MapLibreEngine::onPitchChanged(double pitch)
 {
     m_pitch = pitch;
-    emit pitchChanged(pitch);
+    scheduleCameraUpdate();
 }
 
 void MapLibreEngine::onBearingChanged(double bearing)
 {
     m_bearing = bearing;
-    emit bearingChanged(bearing);
+    scheduleCameraUpdate();
+}
+
+// ============================================================================
+// 相机状态合并
+// ============================================================================
+
+CameraState MapLibreEngine::camera() const
+{
+    CameraState state;
+    state.latitude = m_latitude;
+    state.longitude = m_longitude;
+    state.zoom = m_zoom;
+    state.pitch = m_pitch;
+    state.bearing = m_bearing;
+    state.visibleRegion = m_visibleRegion.isValid() ? m_visibleRegion : estimatedVisibleRegion();
+    return state;
+}
+
+QGeoRectangle MapLibreEngine::estimatedVisibleRegion() const
+{
+    if (m_viewportSize.isEmpty()) {
+        return QGeoRectangle();
+    }
+    // MapLibre 的世界宽度为 512·2^zoom 像素；旋转后取视图的外接矩形，倾斜视图的远端不计入
+    const double worldSize = 512.0 * std::pow(2.0, m_zoom);
+    const double angle = qDegreesToRadians(m_bearing);
+    const double c = qAbs(std::cos(angle));
+    const double s = qAbs(std::sin(angle));
+    const double halfWidth = (m_viewportSize.width() * c + m_viewportSize.height() * s) / (2.0 * worldSize);
+    const double halfHeight = (m_viewportSize.width() * s + m_viewportSize.height() * c) / (2.0 * worldSize);
+
+    const double x = TileMath::lonToX(m_longitude);
+    const double y = TileMath::latToY(m_latitude);
+    const double left = qMax(0.0, x - halfWidth);
+    const double right = qMin(1.0, x + halfWidth);
+    const double top = qMax(0.0, y - halfHeight);
+    const double bottom = qMin(1.0, y + halfHeight);
+    return QGeoRectangle(QGeoCoordinate(TileMath::yToLat(top), TileMath::xToLon(left)),
+                         QGeoCoordinate(TileMath::yToLat(bottom), TileMath::xToLon(right)));
+}
+
+void MapLibreEngine::setCameraUpdateInterval(int milliseconds)
+{
+    milliseconds = qMax(0, milliseconds);
+    if (m_cameraTimer.interval() == milliseconds) {
+        return;
+    }
+    m_cameraTimer.setInterval(milliseconds);
+    emit cameraUpdateIntervalChanged();
+}
+
+void MapLibreEngine::scheduleCameraUpdate()
+{
+    // 计时器运行期间的回调只更新成员，到期时一并发出
+    if (!m_cameraTimer.isActive()) {
+        m_cameraTimer.start();
+    }
+}
+
+void MapLibreEngine::flushCameraUpdate()
+{
+    const CameraState state = camera();
+    if (state == m_publishedCamera) {
+        return;
+    }
+    const CameraState previous = m_publishedCamera;
+    m_publishedCamera = state;
+
+    const bool centerMoved = state.latitude != previous.latitude || state.longitude != previous.longitude;
+    const bool zoomed = state.zoom != previous.zoom;
+    const bool viewMoved = centerMoved || zoomed || state.visibleRegion != previous.visibleRegion;
+
+    // 在线瓦片：按视图中心排队，取消视口外请求，沿运动方向预取
+    if (viewMoved) {
+        if (state.visibleRegion.isValid()) {
+            TileFetcher::instance()->setViewport(state.visibleRegion, state.zoom);
+            TilePrefetcher::instance()->updateCamera(state.visibleRegion, state.zoom);
+        } else {
+            TileFetcher::instance()->setViewCenter(state.latitude, state.longitude);
+        }
+    }
+
+    if (centerMoved) {
+        emit centerChanged(state.latitude, state.longitude);
+    }
+    if (zoomed) {
+        emit zoomChanged(state.zoom);
+    }
+    if (state.pitch != previous.pitch) {
+        emit pitchChanged(state.pitch);
+    }
+    if (state.bearing != previous.bearing) {
+        emit bearingChanged(state.bearing);
+    }
+    emit cameraChanged(state);
+
+    MessageBus* bus = MessageBus::instance();
+    bus->publish(m_cameraTopic, QVariant::fromValue(state));
+    if (centerMoved) {
+        QVariantMap data;
+        data["latitude"] = state.latitude;
+        data["longitude"] = state.longitude;
+        bus->publish(m_centerTopic, data);
+    }
+    if (zoomed) {
+        bus->publish(m_zoomTopic, state.zoom);
+        refreshSimplifiedLayers();
+    }
+}
+
+void MapLibreEngine::refreshSimplifiedLayers()
+{
+    const int level = qFloor(m_zoom);
+    for (auto it = m_simplifiedLayers.begin(); it != m_simplifiedLayers.end(); ++it) {
+        if (it.value() == level) {
+            continue;
+        }
+        const QString sourceId = m_layers.value(it.key()).value(QStringLiteral("sourceId")).toString();
+        auto* source = qobject_cast<IVectorMapSource*>(MapSourceManager::instance()->source(sourceId));
+        if (!source) {
+            continue;
+        }
+        it.value() = level;
+
+        // 导出在线程池中进行；结果回到主线程时级别已变化或图层已移除则丢弃
+        const QString layerId = it.key();
+        auto store = std::make_shared<const FeatureStore>(source->featureStore());
+        QPointer<MapLibreEngine> self(this);
+        QThreadPool::globalInstance()->start([self, layerId, level, store]() {
+            const QByteArray data = store->toGeoJSONData(store->toleranceFor(level, kSimplifiedVertexBudget));
+            QMetaObject::invokeMethod(self, [self, layerId, level, data]() {
+                if (!self || self->m_simplifiedLayers.value(layerId, -1) != level || !self->m_mapItem) {
+                    return;
+                }
+                QMetaObject::invokeMethod(self->m_mapItem, "updateLayerGeoJSONData",
+                                          Q_ARG(QString, layerId),
+                                          Q_ARG(QByteArray, data));
+            }, Qt::QueuedConnection);
+        });
+    }
 }
 
 void MapLibreEngine::onMapClicked(double latitude, double longitude)
 {
     emit mapClicked(latitude, longitude);
 
+    // 点选容差约 10 像素，按当前缩放级别换算为米（Web 墨卡托）
+    const double metersPerPixel = 156543.03392 * qCos(qDegreesToRadians(latitude)) / qPow(2.0, m_zoom);
+    const QVariantList features = MapSourceManager::instance()->identify(
+        QGeoCoordinate(latitude, longitude), metersPerPixel * 10.0);
+
     QVariantMap data;
     data["latitude"] = latitude;
     data["longitude"] = longitude;
+    data["features"] = features;
     MessageBus::instance()->publish(Topics::MAP_CLICKED, data);
 }
 
@@ -2,16 +2,29 @@
 #define YEFS_MAPLIBREENGINE_H
 
 #include "IMapEngine.h"
+#include "CameraState.h"
+#include "LayerFeatureTable.h"
+#include "MessageBus.h"
 #include <QQmlEngine>
+#include <QGeoRectangle>
 #include <QHash>
 #include <QPointF>
+#include <QSizeF>
+#include <QTimer>
+#include <memory>
 
 namespace YEFS {
 
+class VectorTileSlicer;
+
 /**
  * @brief MapLibre 地图引擎实现
  * 
  * 封装 MapLibre Native Qt，提供统一的地图引擎接口
+ *
+ * 地图项在手势期间每帧回调 onCenterChanged/onZoomChanged 等，
+ * 引擎只记录最新值，按 cameraUpdateInterval 合并后一次性发出信号、
+ * 发布 MessageBus 消息并更新在线瓦片加载的视口。
  */
 class MapLibreEngine : public IMapEngine
 {
@@ -54,6 +67,23 @@ public:
     Q_INVOKABLE QPointF coordinateToScreen(double latitude, double longitude) const override;
     Q_INVOKABLE QGeoCoordinate screenToCoordinate(double x, double y) const override;
 
+    // 矢量瓦片图层：把矢量数据源交给本地瓦片服务按需切片（MVT），
+    // 地图只请求当前视野和级别的瓦片，适合大数据集。切片器在线程池中准备，
+    // 完成后才注册瓦片集并发出 layerAdded；数据源不存在时返回 false
+    Q_INVOKABLE bool addVectorTileLayer(const QString& layerId, const QString& sourceId,
+                                        const QVariantMap& style = {});
+
+    // 矢量数据源整体作为 GeoJSON 图层：直接把数据源缓存的 GeoJSON 文本（共享缓冲区）
+    // 交给地图项，不构建 QJsonObject/QVariantMap。适合中小数据集，失败时返回 false。
+    // 带顶点重要度的数据源（GPX）按整数缩放级别抽稀，级别变化时经 updateLayerGeoJSONData 更新
+    Q_INVOKABLE bool addVectorSourceLayer(const QString& layerId, const QString& sourceId,
+                                          const QVariantMap& style = {});
+
+    // GeoJSON 图层的增量更新：按要素 "id" 新增/替换或删除，只把变化的要素发给地图。
+    // updateLayerData() 也先与已有要素比较，只发送差量
+    Q_INVOKABLE void upsertFeatures(const QString& layerId, const QJsonArray& features);
+    Q_INVOKABLE void removeFeatures(const QString& layerId, const QStringList& featureIds);
+
     // MapLibre 特有功能
     Q_INVOKABLE void setMapItem(QObject* mapItem);
     Q_INVOKABLE QStringList availableStyles() const;
@@ -65,24 +95,37 @@ public:
     Q_PROPERTY(double zoom READ zoom NOTIFY zoomChanged)
     Q_PROPERTY(double pitch READ pitch NOTIFY pitchChanged)
     Q_PROPERTY(double bearing READ bearing NOTIFY bearingChanged)
+    Q_PROPERTY(YEFS::CameraState camera READ camera NOTIFY cameraChanged)
+    Q_PROPERTY(int cameraUpdateInterval READ cameraUpdateInterval WRITE setCameraUpdateInterval
+               NOTIFY cameraUpdateIntervalChanged)
 
     double latitude() const { return m_latitude; }
     double longitude() const { return m_longitude; }
     double zoom() const { return m_zoom; }
     double pitch() const { return m_pitch; }
     double bearing() const { return m_bearing; }
+    CameraState camera() const;
+
+    // 相机更新的最小间隔（毫秒），默认约一帧；0 表示在下一次事件循环合并
+    int cameraUpdateInterval() const { return m_cameraTimer.interval(); }
+    void setCameraUpdateInterval(int milliseconds);
 
 signals:
     void centerChanged(double latitude, double longitude);
     void zoomChanged(double zoom);
     void pitchChanged(double pitch);
     void bearingChanged(double bearing);
+    void cameraChanged(const YEFS::CameraState& camera);
+    void cameraUpdateIntervalChanged();
 
 public slots:
     // 由 QML 调用，同步状态
     void onMapReady();
     void onCenterChanged(double latitude, double longitude);
     void onZoomChanged(double zoom);
+    void onVisibleRegionChanged(const QGeoRectangle& region);
+    // 地图项不报告可见范围时，按视图尺寸（像素）和相机估算
+    void onViewportSizeChanged(double width, double height);
     void onPitchChanged(double pitch);
     void onBearingChanged(double bearing);
     void onMapClicked(double latitude, double longitude);
@@ -91,12 +134,24 @@ private:
     explicit MapLibreEngine(QObject* parent = nullptr);
     ~MapLibreEngine() override = default;
 
+    void finishVectorTileLayer(const QString& layerId, const QString& sourceId,
+                               const QVariantMap& style, quint64 generation,
+                               const std::shared_ptr<VectorTileSlicer>& slicer);
+    void sendLayerDelta(const QString& layerId, const LayerFeatureTable& table,
+                        const LayerFeatureTable::Delta& delta);
+
+    QGeoRectangle estimatedVisibleRegion() const;
+    void scheduleCameraUpdate();
+    void flushCameraUpdate();
+    void refreshSimplifiedLayers();
+
     static MapLibreEngine* s_instance;
 
     bool m_ready = false;
     QString m_currentStyle;
     QHash<QString, QString> m_styles;  // name -> url
     QObject* m_mapItem = nullptr;
+    bool m_mapItemSupportsDelta = false;    // 地图项实现了 updateLayerFeatures
 
     // 当前相机状态
     double m_latitude = 39.9042;
@@ -104,9 +159,24 @@ private:
     double m_zoom = 2.0;
     double m_pitch = 0.0;
     double m_bearing = 0.0;
+    QGeoRectangle m_visibleRegion;
+    QSizeF m_viewportSize;
+
+    // 最近一次发出的相机状态，用于判断哪些分量变化
+    CameraState m_publishedCamera;
+    QTimer m_cameraTimer;
+    MessageBus::TopicId m_cameraTopic = MessageBus::InvalidTopic;   // 预先登记的主题
+    MessageBus::TopicId m_centerTopic = MessageBus::InvalidTopic;
+    MessageBus::TopicId m_zoomTopic = MessageBus::InvalidTopic;
 
-    // 图层跟踪
+    // 图层跟踪：图层描述；GeoJSON 图层的要素另存于按 ID 索引的要素表
     QHash<QString, QJsonObject> m_layers;
+    QHash<QString, LayerFeatureTable> m_featureTables;
+    // 正在线程池中准备切片器的矢量瓦片图层 -> 代次，代次不符的结果作废
+    QHash<QString, quint64> m_pendingTileLayers;
+    quint64 m_tileLayerGeneration = 0;
+    // 按缩放级别抽稀的 GeoJSON 图层 -> 最近请求的整数级别
+    QHash<QString, int> m_simplifiedLayers;
 };
 
 } // namespace YEFS
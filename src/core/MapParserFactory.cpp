@@ -1,10 +1,65 @@
 #include "IMapParser.h"
 #include "IMapSource.h"
+#include "MappedFile.h"
+#include "FeatureCache.h"
 #include <QFileInfo>
+#include <QThread>
+#include <iterator>
+#include <memory>
 #include <QDebug>
 
 namespace YEFS {
 
+// ============================================================================
+// IMapParser 实现
+// ============================================================================
+
+ParseTask* IMapParser::parseAsync(const QString& filePath, QThreadPool* pool)
+{
+    // 任务函数需可复制，使用计数通过共享指针随任务释放
+    const auto lease = std::make_shared<ParserLease>(this);
+    return ParseTask::start(filePath, [lease, filePath](ParseControl* control) -> IMapSource* {
+        IMapParser* parser = lease->get();
+        if (parser->needsFilePath()) {
+            return parser->parse(filePath);
+        }
+        MappedFile mapped(filePath);
+        if (mapped.isMapped()) {
+            return parser->parseData(mapped.data(), QFileInfo(filePath).fileName(), control);
+        }
+        return parser->parse(filePath);
+    }, pool);
+}
+
+void IMapParser::acquire()
+{
+    QMutexLocker locker(&m_leaseMutex);
+    ++m_leases;
+}
+
+void IMapParser::release()
+{
+    QMutexLocker locker(&m_leaseMutex);
+    if (--m_leases == 0 && m_retired) {
+        locker.unlock();
+        deleteLater();
+    }
+}
+
+void IMapParser::retire()
+{
+    QMutexLocker locker(&m_leaseMutex);
+    m_retired = true;
+    if (m_leases == 0) {
+        locker.unlock();
+        deleteLater();
+    }
+}
+
+// ============================================================================
+// MapParserFactory 实现
+// ============================================================================
+
 MapParserFactory* MapParserFactory::s_instance = nullptr;
 
 MapParserFactory* MapParserFactory::instance()
@@ -36,13 +91,16 @@ void MapParserFactory::registerParser(IMapParser* parser)
     }
 
     QString name = parser->name();
-    if (m_parsers.contains(name)) {
-        qWarning() << "[MapParserFactory] Parser already registered:" << name;
-        return;
+    {
+        QWriteLocker locker(&m_lock);
+        if (m_parsers.contains(name)) {
+            qWarning() << "[MapParserFactory] Parser already registered:" << name;
+            return;
+        }
+        m_parsers.insert(name, parser);
     }
 
     parser->setParent(this);
-    m_parsers.insert(name, parser);
     qDebug() << "[MapParserFactory] Registered parser:" << name 
              << "for extensions:" << parser->supportedExtensions();
     
@@ -51,60 +109,110 @@ void MapParserFactory::registerParser(IMapParser* parser)
 
 void MapParserFactory::unregisterParser(const QString& name)
 {
-    if (!m_parsers.contains(name)) {
+    IMapParser* parser = nullptr;
+    {
+        QWriteLocker locker(&m_lock);
+        parser = m_parsers.take(name);
+    }
+    if (!parser) {
         qWarning() << "[MapParserFactory] Parser not found:" << name;
         return;
     }
-
-    auto parser = m_parsers.take(name);
-    if (parser) {
-        parser->deleteLater();
-    }
+    // 仍有解析任务在使用时，等最后一个任务结束再删除
+    parser->retire();
 
     qDebug() << "[MapParserFactory] Unregistered parser:" << name;
     emit parserUnregistered(name);
 }
 
-IMapParser* MapParserFactory::parser(const QString& name) const
+void MapParserFactory::registerLazyExtensions(const QString& owner, const QStringList& extensions,
+                                              ExtensionActivator activator)
 {
-    return m_parsers.value(name, nullptr);
+    Q_ASSERT(QThread::currentThread() == thread());
+    for (const QString& extension : extensions) {
+        m_lazyExtensions[extension.toLower()].append(LazyProvider{owner, activator});
+    }
 }
 
-IMapParser* MapParserFactory::parserForFile(const QString& filePath) const
+void MapParserFactory::unregisterLazyExtensions(const QString& owner)
 {
-    QFileInfo fileInfo(filePath);
-    QString extension = fileInfo.suffix().toLower();
+    Q_ASSERT(QThread::currentThread() == thread());
+    for (auto it = m_lazyExtensions.begin(); it != m_lazyExtensions.end();) {
+        it->removeIf([&owner](const LazyProvider& provider) { return provider.owner == owner; });
+        it = it->isEmpty() ? m_lazyExtensions.erase(it) : std::next(it);
+    }
+}
+
+void MapParserFactory::activateExtension(const QString& filePath)
+{
+    // 激活会加载插件、注册解析器，只在工厂线程进行。工作线程不能阻塞等待工厂线程：
+    // 工厂线程可能正在等待同一个线程池（如 MapSourceManager 析构时 waitForDone）
+    if (QThread::currentThread() != thread()) {
+        return;
+    }
+
+    const QString extension = QFileInfo(filePath).suffix().toLower();
+    const QList<LazyProvider> providers = m_lazyExtensions.take(extension);
+    for (const LazyProvider& provider : providers) {
+        qDebug() << "[MapParserFactory] Activating" << provider.owner << "for extension:" << extension;
+        provider.activator(extension);
+    }
+}
 
+ParserLease MapParserFactory::findParser(const std::function<bool(IMapParser*)>& match) const
+{
+    // 在读锁内取得使用计数，之后注销的解析器也要等本次使用结束才删除
+    QReadLocker locker(&m_lock);
     for (IMapParser* parser : m_parsers) {
-        if (parser->supportedExtensions().contains(extension, Qt::CaseInsensitive)) {
-            if (parser->canParse(filePath)) {
-                return parser;
-            }
+        if (match(parser)) {
+            return ParserLease(parser);
         }
     }
+    return ParserLease();
+}
 
-    return nullptr;
+ParserLease MapParserFactory::leaseParser(const QString& name) const
+{
+    QReadLocker locker(&m_lock);
+    return ParserLease(m_parsers.value(name, nullptr));
+}
+
+IMapParser* MapParserFactory::parser(const QString& name) const
+{
+    QReadLocker locker(&m_lock);
+    return m_parsers.value(name, nullptr);
 }
 
-IMapParser* MapParserFactory::parserForExtension(const QString& extension) const
+QList<IMapParser*> MapParserFactory::allParsers() const
+{
+    QReadLocker locker(&m_lock);
+    return m_parsers.values();
+}
+
+ParserLease MapParserFactory::parserForFile(const QString& filePath) const
+{
+    const QString extension = QFileInfo(filePath).suffix().toLower();
+    return findParser([&](IMapParser* parser) {
+        return parser->supportedExtensions().contains(extension, Qt::CaseInsensitive)
+            && parser->canParse(filePath);
+    });
+}
+
+ParserLease MapParserFactory::parserForExtension(const QString& extension) const
 {
     QString ext = extension.toLower();
     if (ext.startsWith('.')) {
         ext = ext.mid(1);
     }
-
-    for (IMapParser* parser : m_parsers) {
-        if (parser->supportedExtensions().contains(ext, Qt::CaseInsensitive)) {
-            return parser;
-        }
-    }
-
-    return nullptr;
+    return findParser([&ext](IMapParser* parser) {
+        return parser->supportedExtensions().contains(ext, Qt::CaseInsensitive);
+    });
 }
 
 QStringList MapParserFactory::supportedExtensions() const
 {
-    QStringList extensions;
+    QStringList extensions = m_lazyExtensions.keys();
+    QReadLocker locker(&m_lock);
     for (IMapParser* parser : m_parsers) {
         extensions << parser->supportedExtensions();
     }
@@ -116,6 +224,7 @@ QStringList MapParserFactory::supportedExtensions() const
 QStringList MapParserFactory::supportedMimeTypes() const
 {
     QStringList mimeTypes;
+    QReadLocker locker(&m_lock);
     for (IMapParser* parser : m_parsers) {
         mimeTypes << parser->mimeTypes();
     }
@@ -126,14 +235,113 @@ QStringList MapParserFactory::supportedMimeTypes() const
 
 IMapSource* MapParserFactory::parseFile(const QString& filePath)
 {
-    IMapParser* parser = parserForFile(filePath);
+    activateExtension(filePath);
+    return parseFile(filePath, nullptr);
+}
+
+IMapSource* MapParserFactory::parseFile(const QString& filePath, ParseControl* control)
+{
+    const QString extension = QFileInfo(filePath).suffix().toLower();
+    const auto handles = [&extension](IMapParser* parser) {
+        return parser->supportedExtensions().contains(extension, Qt::CaseInsensitive);
+    };
+
+    // 瓦片包等格式由解析器自行打开文件
+    const ParserLease fileParser = findParser(handles);
+    if (fileParser && fileParser->needsFilePath() && fileParser->canParse(filePath)) {
+        qDebug() << "[MapParserFactory] Opening file:" << filePath << "with parser:" << fileParser->name();
+        IMapSource* source = fileParser->parse(filePath);
+        if (!source && control) {
+            control->setError(QStringLiteral("无法打开文件"));
+        }
+        return source;
+    }
+
+    // 命中磁盘缓存时直接重建数据源，跳过文本解析
+    if (IMapSource* cached = loadCached(filePath)) {
+        return cached;
+    }
+
+    MappedFile mapped(filePath);
+    if (mapped.isMapped()) {
+        const ParserLease parser = findParser([&](IMapParser* candidate) {
+            return handles(candidate) && candidate->canParseData(mapped.data());
+        });
+        if (!parser) {
+            qWarning() << "[MapParserFactory] No parser found for file:" << filePath;
+            if (control) {
+                control->setError(QStringLiteral("不支持的文件格式"));
+            }
+            return nullptr;
+        }
+
+        qDebug() << "[MapParserFactory] Parsing mapped file:" << filePath
+                 << "size:" << mapped.size() << "with parser:" << parser->name();
+        IMapSource* source = parser->parseData(mapped.data(), QFileInfo(filePath).fileName(), control);
+        saveCached(filePath, parser.get(), source);
+        return source;
+    }
+
+    // 无法映射时回退到 QIODevice 读取（不支持中途取消）
+    const ParserLease parser = findParser([&](IMapParser* candidate) {
+        return handles(candidate) && candidate->canParse(filePath);
+    });
     if (!parser) {
         qWarning() << "[MapParserFactory] No parser found for file:" << filePath;
+        if (control) {
+            control->setError(QStringLiteral("不支持的文件格式"));
+        }
         return nullptr;
     }
 
     qDebug() << "[MapParserFactory] Parsing file:" << filePath << "with parser:" << parser->name();
-    return parser->parse(filePath);
+    IMapSource* source = parser->parse(filePath);
+    saveCached(filePath, parser.get(), source);
+    return source;
+}
+
+IMapSource* MapParserFactory::loadCached(const QString& filePath) const
+{
+    FeatureCache::Entry entry;
+    if (!FeatureCache::load(filePath, entry)) {
+        return nullptr;
+    }
+    const ParserLease cachedParser = leaseParser(entry.parserName);
+    if (!cachedParser) {
+        return nullptr;
+    }
+    return cachedParser->createSource(entry.sourceName, std::move(entry.store), std::move(entry.index));
+}
+
+void MapParserFactory::saveCached(const QString& filePath, IMapParser* parser, IMapSource* source) const
+{
+    auto* vectorSource = qobject_cast<IVectorMapSource*>(source);
+    if (!vectorSource || !vectorSource->isValid()) {
+        return;
+    }
+    FeatureCache::save(filePath, parser->name(), vectorSource->name(),
+                       vectorSource->featureStore(), vectorSource->spatialIndex());
+}
+
+ParseTask* MapParserFactory::parseFileAsync(const QString& filePath)
+{
+    // QML 调用：没有父对象的返回值归 JS 引擎所有，GC 回收句柄会取消解析。
+    // 由工厂持有并保持 C++ 所有权，完成信号处理完后释放
+    ParseTask* task = parseFileAsync(filePath, nullptr);
+    task->setParent(this);
+    QJSEngine::setObjectOwnership(task, QJSEngine::CppOwnership);
+    connect(task, &ParseTask::finished, task, &QObject::deleteLater);
+    return task;
+}
+
+ParseTask* MapParserFactory::parseFileAsync(const QString& filePath, QThreadPool* pool)
+{
+    // 解析器无状态，可在工作线程中直接使用；注册表查找加读锁。
+    // 延迟注册的解析器在任务开始前于工厂线程激活
+    activateExtension(filePath);
+    return ParseTask::start(filePath, [this, filePath](ParseControl* control) {
+        return parseFile(filePath, control);
+    }, pool);
 }
 
 } // namespace YEFS
@@ -2,6 +2,9 @@
 #include "IMapParser.h"
 #include <QDebug>
 #include <QFileInfo>
+#include <QThread>
+#include <algorithm>
+#include "ParseTask.h"
 
 namespace YEFS {
 
@@ -25,11 +28,16 @@ MapSourceManager* MapSourceManager::create(QQmlEngine* qmlEngine, QJSEngine* jsE
 MapSourceManager::MapSourceManager(QObject* parent)
     : QObject(parent)
 {
-    qDebug() << "[MapSourceManager] Initialized";
+    m_importPool.setMaxThreadCount(QThread::idealThreadCount());
+    qDebug() << "[MapSourceManager] Initialized, import threads:" << m_importPool.maxThreadCount();
 }
 
 MapSourceManager::~MapSourceManager()
 {
+    // 销毁任务即请求取消，未交付的结果由任务的控制块释放
+    qDeleteAll(m_importTasks.keys());
+    m_importTasks.clear();
+    m_importPool.waitForDone();
     removeAllSources();
 }
 
@@ -124,6 +132,44 @@ bool MapSourceManager::hasSource(const QString& sourceId) const
     return m_sources.contains(sourceId);
 }
 
+QVariantList MapSourceManager::identify(const QGeoCoordinate& coordinate, double radiusMeters,
+                                       int limit) const
+{
+    struct Hit {
+        IVectorMapSource* source;
+        SpatialIndex::Neighbor neighbor;
+    };
+
+    QList<Hit> hits;
+    for (IMapSource* source : m_sources) {
+        auto vector = qobject_cast<IVectorMapSource*>(source);
+        if (!vector) {
+            continue;
+        }
+        const auto neighbors = vector->spatialIndex().nearest(vector->featureStore(), coordinate,
+                                                              limit, radiusMeters);
+        for (const SpatialIndex::Neighbor& neighbor : neighbors) {
+            hits.append({vector, neighbor});
+        }
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        return a.neighbor.distance < b.neighbor.distance;
+    });
+
+    QVariantList result;
+    for (int i = 0; i < hits.size() && i < limit; ++i) {
+        const Hit& hit = hits.at(i);
+        result.append(QVariantMap{
+            {QStringLiteral("sourceId"), hit.source->id()},
+            {QStringLiteral("feature"), hit.neighbor.feature},
+            {QStringLiteral("distance"), hit.neighbor.distance},
+            {QStringLiteral("properties"), hit.source->featureStore().properties(hit.neighbor.feature)}
+        });
+    }
+    return result;
+}
+
 bool MapSourceManager::loadFile(const QString& filePath)
 {
     QFileInfo fileInfo(filePath);
@@ -148,13 +194,110 @@ bool MapSourceManager::loadFile(const QString& filePath)
 
 bool MapSourceManager::loadFiles(const QStringList& filePaths)
 {
-    bool allSuccess = true;
+    if (filePaths.isEmpty()) {
+        return false;
+    }
+
+    // 导入过程中再次调用时追加到当前批次
+    if (!m_importing) {
+        m_importTotal = 0;
+        m_importCompleted = 0;
+        m_importLoaded = 0;
+        m_importBytesTotal = 0;
+        m_importBytesDone = 0;
+        m_importFailed.clear();
+        m_importing = true;
+        emit importingChanged();
+    }
+
+    MapParserFactory* factory = MapParserFactory::instance();
+
     for (const QString& path : filePaths) {
-        if (!loadFile(path)) {
-            allSuccess = false;
-        }
+        // 按文件大小加权进度，空文件或不存在的文件也算 1 字节
+        const qint64 bytes = qMax<qint64>(QFileInfo(path).size(), 1);
+        m_importBytesTotal += bytes;
+        ++m_importTotal;
+
+        ParseTask* task = factory->parseFileAsync(path, &m_importPool);
+        task->setParent(this);
+        m_importTasks.insert(task, bytes);
+
+        connect(task, &ParseTask::progressChanged, this, &MapSourceManager::importProgressChanged);
+        connect(task, &ParseTask::finished, this, [this, task]() {
+            finishImportTask(task);
+        });
+    }
+
+    qDebug() << "[MapSourceManager] Importing" << filePaths.size() << "files, pending:"
+             << m_importTasks.size();
+    emit importProgressChanged();
+    return true;
+}
+
+void MapSourceManager::cancelImport()
+{
+    if (!m_importing) {
+        return;
+    }
+
+    // 销毁任务即请求取消：未开始的任务直接跳过，正在解析的任务在下一个检查点中止
+    for (ParseTask* task : m_importTasks.keys()) {
+        task->disconnect(this);
+        task->deleteLater();
+    }
+    m_importTasks.clear();
+
+    qDebug() << "[MapSourceManager] Import canceled, completed:" << m_importCompleted
+             << "of" << m_importTotal;
+    endImport(true);
+}
+
+double MapSourceManager::importProgress() const
+{
+    if (m_importBytesTotal <= 0) {
+        return 0.0;
+    }
+
+    // 已完成的文件 + 进行中文件的部分进度
+    double done = double(m_importBytesDone);
+    for (auto it = m_importTasks.constBegin(); it != m_importTasks.constEnd(); ++it) {
+        done += it.key()->progress() * double(it.value());
     }
-    return allSuccess;
+    return qMin(done / double(m_importBytesTotal), 1.0);
+}
+
+void MapSourceManager::finishImportTask(ParseTask* task)
+{
+    const qint64 bytes = m_importTasks.take(task);
+    task->deleteLater();
+
+    ++m_importCompleted;
+    m_importBytesDone += bytes;
+
+    IMapSource* source = task->takeResult();
+    if (source) {
+        addSource(source);
+        ++m_importLoaded;
+        qDebug() << "[MapSourceManager] Loaded file:" << task->filePath() << "as source:" << source->id();
+    } else {
+        qWarning() << "[MapSourceManager] Failed to parse file:" << task->filePath()
+                   << task->errorString();
+        m_importFailed.append(task->filePath());
+    }
+
+    emit importProgressChanged();
+
+    if (m_importTasks.isEmpty()) {
+        endImport(false);
+    }
+}
+
+void MapSourceManager::endImport(bool canceled)
+{
+    m_importing = false;
+    emit importingChanged();
+    emit importProgressChanged();
+    emit importFinished(m_importLoaded, m_importFailed, canceled);
 }
 
 bool MapSourceManager::addOnlineMap(const QString& name, const QString& urlTemplate, 
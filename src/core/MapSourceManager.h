@@ -5,14 +5,18 @@
 #include <QList>
 #include <QHash>
 #include <QQmlEngine>
+#include <QThreadPool>
 #include "IMapSource.h"
 
 namespace YEFS {
 
+class ParseTask;
+
 /**
  * @brief 地图数据源管理器
  * 
- * 管理所有已加载的地图数据源
+ * 管理所有已加载的地图数据源。
+ * 批量导入时在后台线程池中并行解析文件，解析完成的数据源回到 GUI 线程后再加入管理。
  */
 class MapSourceManager : public QObject
 {
@@ -23,6 +27,12 @@ class MapSourceManager : public QObject
     Q_PROPERTY(QList<QObject*> sources READ sourceObjects NOTIFY sourcesChanged)
     Q_PROPERTY(int sourceCount READ sourceCount NOTIFY sourcesChanged)
 
+    // 批量导入状态
+    Q_PROPERTY(bool importing READ isImporting NOTIFY importingChanged)
+    Q_PROPERTY(int importTotal READ importTotal NOTIFY importProgressChanged)
+    Q_PROPERTY(int importCompleted READ importCompleted NOTIFY importProgressChanged)
+    Q_PROPERTY(double importProgress READ importProgress NOTIFY importProgressChanged)
+
 public:
     static MapSourceManager* instance();
     static MapSourceManager* create(QQmlEngine* qmlEngine, QJSEngine* jsEngine);
@@ -44,9 +54,20 @@ public:
     Q_INVOKABLE QStringList sourceIds() const;
     Q_INVOKABLE bool hasSource(const QString& sourceId) const;
 
-    // 文件加载
+    // 点选识别：所有矢量数据源中距离 coordinate 不超过 radiusMeters 的要素，按距离升序。
+    // 每项包含 sourceId、feature、distance（米）和 properties
+    Q_INVOKABLE QVariantList identify(const QGeoCoordinate& coordinate, double radiusMeters,
+                                      int limit = 10) const;
+
+    // 文件加载：loadFile 同步解析；loadFiles 在后台并行导入，结果通过 importFinished 通知
     Q_INVOKABLE bool loadFile(const QString& filePath);
     Q_INVOKABLE bool loadFiles(const QStringList& filePaths);
+    Q_INVOKABLE void cancelImport();
+
+    bool isImporting() const { return m_importing; }
+    int importTotal() const { return m_importTotal; }
+    int importCompleted() const { return m_importCompleted; }
+    double importProgress() const;
 
     // 在线地图
     Q_INVOKABLE bool addOnlineMap(const QString& name, const QString& urlTemplate, 
@@ -58,12 +79,30 @@ signals:
     void sourceRemoved(const QString& sourceId);
     void sourceError(const QString& sourceId, const QString& error);
 
+    void importingChanged();
+    void importProgressChanged();
+    void importFinished(int loadedCount, const QStringList& failedFiles, bool canceled);
+
 private:
     explicit MapSourceManager(QObject* parent = nullptr);
     ~MapSourceManager() override;
 
+    void finishImportTask(ParseTask* task);
+    void endImport(bool canceled);
+
     static MapSourceManager* s_instance;
     QHash<QString, IMapSource*> m_sources;
+
+    // 批量导入
+    QThreadPool m_importPool;
+    QHash<ParseTask*, qint64> m_importTasks;    // 进行中的任务 → 文件大小（进度权重）
+    bool m_importing = false;
+    int m_importTotal = 0;
+    int m_importCompleted = 0;
+    int m_importLoaded = 0;
+    qint64 m_importBytesTotal = 0;
+    qint64 m_importBytesDone = 0;
+    QStringList m_importFailed;
 };
 
 } // namespace YEFS
@@ -0,0 +1,44 @@
+#include "MappedFile.h"
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace YEFS {
+
+MappedFile::MappedFile(const QString& filePath)
+    : m_file(filePath)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return;
+    }
+
+    m_size = m_file.size();
+    if (m_size <= 0) {
+        m_errorString = QStringLiteral("文件为空");
+        return;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        m_errorString = m_file.errorString();
+        qDebug() << "[MappedFile] Cannot map file:" << filePath << m_errorString;
+        return;
+    }
+
+#ifdef Q_OS_UNIX
+    // 解析器从头到尾顺序扫描，提示内核积极预读
+    madvise(m_data, size_t(m_size), MADV_SEQUENTIAL);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+} // namespace YEFS
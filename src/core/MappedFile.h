@@ -0,0 +1,47 @@
+#ifndef YEFS_MAPPEDFILE_H
+#define YEFS_MAPPEDFILE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace YEFS {
+
+/**
+ * @brief 只读内存映射文件
+ *
+ * 通过 QFile::map 映射整个文件，由内核按需调页，重复加载同一文件时直接命中页缓存。
+ * 映射失败（文件不存在、空文件、非普通文件等）时 isMapped() 返回 false，调用方应回退到 QIODevice 读取。
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const QString& filePath);
+    ~MappedFile();
+
+    bool isMapped() const { return m_data != nullptr; }
+    qint64 size() const { return m_size; }
+    QString filePath() const { return m_file.fileName(); }
+    QString errorString() const { return m_errorString; }
+
+    // 零拷贝视图，仅在 MappedFile 存活期间有效
+    QByteArrayView data() const {
+        return QByteArrayView(reinterpret_cast<const char*>(m_data), m_size);
+    }
+    QByteArray bytes() const {
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(m_data), m_size);
+    }
+
+private:
+    Q_DISABLE_COPY(MappedFile)
+
+    QFile m_file;
+    uchar* m_data = nullptr;
+    qint64 m_size = 0;
+    QString m_errorString;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_MAPPEDFILE_H
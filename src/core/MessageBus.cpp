@@ -1,15 +1,61 @@
 #include "MessageBus.h"
 #include <QDebug>
+#include <QJSEngine>
+#include <QSet>
+#include <QStringTokenizer>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
 
 namespace YEFS {
 
 MessageBus* MessageBus::s_instance = nullptr;
 
+namespace {
+
+// QML 订阅的句柄，作为订阅者的接收者。JS 回调只保存在这里（引擎线程），
+// 订阅者快照可能在发布线程中释放，不持有 QJSValue
+class QmlSubscription : public QObject
+{
+public:
+    QmlSubscription(QJSEngine* engine, const QJSValue& callback)
+        : QObject(engine)
+        , m_engine(engine)
+        , m_callback(callback)
+    {
+    }
+
+    // 在引擎线程中调用
+    void call(const QString& topic, const QVariant& data)
+    {
+        if (!m_engine) {
+            return;
+        }
+        const QJSValue result = m_callback.call({ QJSValue(topic), m_engine->toScriptValue(data) });
+        if (result.isError()) {
+            qWarning() << "[MessageBus] Subscription callback failed:" << topic << result.toString();
+        }
+    }
+
+private:
+    QPointer<QJSEngine> m_engine;
+    QJSValue m_callback;
+};
+
+} // namespace
+
 MessageBus::MessageBus(QObject* parent)
     : QObject(parent)
+    , m_registry(new Registry)
+    , m_messageSignal(QMetaMethod::fromSignal(&MessageBus::message))
 {
 }
 
+MessageBus::~MessageBus()
+{
+    release(m_registry.load());
+}
+
 MessageBus* MessageBus::instance()
 {
     if (!s_instance) {
@@ -21,61 +67,649 @@ MessageBus* MessageBus::instance()
 MessageBus* MessageBus::create(QQmlEngine* qmlEngine, QJSEngine* jsEngine)
 {
     Q_UNUSED(qmlEngine)
-    Q_UNUSED(jsEngine)
-    return instance();
+    MessageBus* bus = instance();
+    bus->m_jsEngine = jsEngine;
+    return bus;
 }
 
-void MessageBus::publish(const QString& topic, const QVariant& data)
+// ============================================================================
+// 快照（RCU）
+// ============================================================================
+
+MessageBus::Snapshot::Snapshot(const MessageBus* bus)
+{
+    // 进入当前纪元后取指针并加引用；期间纪元被切换则重试，保证写端等待得到本读者。
+    // 临界区内不执行任何回调，写端的等待很短
+    for (;;) {
+        const int epoch = bus->m_epoch.load();
+        bus->m_readers[epoch].fetch_add(1);
+        if (bus->m_epoch.load() == epoch) {
+            m_registry = bus->m_registry.load();
+            m_registry->ref.ref();
+            bus->m_readers[epoch].fetch_sub(1);
+            return;
+        }
+        bus->m_readers[epoch].fetch_sub(1);
+    }
+}
+
+MessageBus::Snapshot::~Snapshot()
+{
+    release(m_registry);
+}
+
+void MessageBus::release(const Registry* registry)
+{
+    if (!registry->ref.deref()) {
+        delete registry;
+    }
+}
+
+void MessageBus::update(const std::function<void(Registry&)>& modify)
+{
+    // 调用方持有 m_writeMutex
+    const Registry* old = m_registry.load();
+    auto* next = new Registry;
+    next->topics = old->topics;         // 隐式共享，只复制引用
+    next->topicIds = old->topicIds;
+    next->patterns = old->patterns;
+    modify(*next);
+    m_registry.store(next);
+
+    // 切换纪元，等待旧纪元中可能读到旧指针、尚未加引用的读者退出
+    const int epoch = m_epoch.load();
+    m_epoch.store(epoch ^ 1);
+    while (m_readers[epoch].load() != 0) {
+        QThread::yieldCurrentThread();
+    }
+    release(old);
+}
+
+// ============================================================================
+// 主题登记
+// ============================================================================
+
+MessageBus::TopicId MessageBus::topic(const QString& name)
+{
+    if (isPattern(name)) {
+        qWarning() << "[MessageBus] Wildcard pattern is not a topic:" << name;
+        return InvalidTopic;
+    }
+    {
+        const Snapshot snapshot(this);
+        const auto it = snapshot->topicIds.constFind(name);
+        if (it != snapshot->topicIds.cend()) {
+            return *it;
+        }
+    }
+    QMutexLocker locker(&m_writeMutex);
+    return registerTopic(name);
+}
+
+MessageBus::TopicId MessageBus::registerTopic(const QString& name)
+{
+    // 调用方持有 m_writeMutex；加锁前可能已被其他线程登记
+    const Registry* current = m_registry.load();
+    const TopicId existing = current->topicIds.value(name, InvalidTopic);
+    if (existing != InvalidTopic) {
+        return existing;
+    }
+    const TopicId id = TopicId(current->topics.size());
+    update([&name, id](Registry& registry) {
+        // 新主题登记时并入已有的匹配通配订阅
+        Topic entry{name, {}};
+        collectPatternSubscribers(registry, 0, name.split(QLatin1Char('/')), 0, entry.subscribers);
+        registry.topics.append(std::move(entry));
+        registry.topicIds.insert(name, id);
+    });
+    return id;
+}
+
+// ============================================================================
+// 通配模式
+// ============================================================================
+
+bool MessageBus::isPattern(const QString& topic)
+{
+    for (const QStringView level : QStringTokenizer(topic, QLatin1Char('/'))) {
+        if (level == QLatin1String("*") || level == QLatin1String("#")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MessageBus::isValidPattern(const QStringList& levels)
+{
+    // '#' 只能是最后一层
+    const qsizetype multi = levels.indexOf(QStringLiteral("#"));
+    return multi < 0 || multi == levels.size() - 1;
+}
+
+bool MessageBus::patternMatches(const QStringList& pattern, const QStringList& levels)
+{
+    qsizetype i = 0;
+    for (; i < pattern.size(); ++i) {
+        const QString& level = pattern.at(i);
+        if (level == QLatin1String("#")) {
+            return true;
+        }
+        if (i >= levels.size() || (level != QLatin1String("*") && level != levels.at(i))) {
+            return false;
+        }
+    }
+    return i == levels.size();
+}
+
+void MessageBus::collectPatternSubscribers(const Registry& registry, int node, const QStringList& levels,
+                                           qsizetype level, QList<Subscriber>& out)
+{
+    const PatternNode& current = registry.patterns.at(node);
+    const int multi = current.children.value(QStringLiteral("#"), -1);
+    if (multi >= 0) {
+        out.append(registry.patterns.at(multi).subscribers);
+    }
+    if (level == levels.size()) {
+        out.append(current.subscribers);
+        return;
+    }
+    const int exact = current.children.value(levels.at(level), -1);
+    if (exact >= 0) {
+        collectPatternSubscribers(registry, exact, levels, level + 1, out);
+    }
+    const int single = current.children.value(QStringLiteral("*"), -1);
+    if (single >= 0) {
+        collectPatternSubscribers(registry, single, levels, level + 1, out);
+    }
+}
+
+QString MessageBus::topicName(TopicId topic) const
 {
-    // 发送全局信号
-    emit message(topic, data);
+    const Snapshot snapshot(this);
+    return topic >= 0 && topic < snapshot->topics.size() ? snapshot->topics.at(topic).name : QString();
+}
+
+// ============================================================================
+// 发布
+// ============================================================================
+
+void MessageBus::publish(TopicId topic, const QVariant& data)
+{
+    // 持有快照期间订阅变化只影响之后的发布
+    const Snapshot snapshot(this);
+    if (topic < 0 || topic >= snapshot->topics.size()) {
+        qWarning() << "[MessageBus] Unknown topic id:" << topic;
+        return;
+    }
+    const Topic& entry = snapshot->topics.at(topic);
+
+    // 发送全局信号（没有连接时跳过参数打包）
+    if (isSignalConnected(m_messageSignal)) {
+        emit message(entry.name, data);
+    }
 
     // 通知所有订阅者
-    auto subscribers = m_subscribers.values(topic);
-    for (const auto& subscriber : subscribers) {
-        if (subscriber.first) {
-            QMetaObject::invokeMethod(subscriber.first, subscriber.second,
-                                      Qt::AutoConnection,
-                                      Q_ARG(QString, topic),
-                                      Q_ARG(QVariant, data));
+    for (const Subscriber& subscriber : entry.subscribers) {
+        deliver(subscriber, entry.name, data);
+    }
+}
+
+void MessageBus::publish(const QString& topic, const QVariant& data)
+{
+    if (isPattern(topic)) {
+        qWarning() << "[MessageBus] Cannot publish to a wildcard pattern:" << topic;
+        return;
+    }
+
+    TopicId id = InvalidTopic;
+    {
+        const Snapshot snapshot(this);
+        id = snapshot->topicIds.value(topic, InvalidTopic);
+        if (id == InvalidTopic) {
+            // 未登记的主题没有精确订阅者，不为它登记（动态主题名不会让主题表无限增长）；
+            // 只投递给匹配的通配订阅者和全局信号
+            if (isSignalConnected(m_messageSignal)) {
+                emit message(topic, data);
+            }
+            QList<Subscriber> subscribers;
+            collectPatternSubscribers(*snapshot, 0, topic.split(QLatin1Char('/')), 0, subscribers);
+            for (const Subscriber& subscriber : std::as_const(subscribers)) {
+                deliver(subscriber, topic, data);
+            }
+            return;
         }
     }
+    publish(id, data);
 }
 
-void MessageBus::subscribe(const QString& topic, QObject* receiver, const char* slot)
+void MessageBus::deliver(const Subscriber& subscriber, const QString& topic, const QVariant& data)
 {
-    if (!receiver || !slot) return;
+    // 接收者可能正在自己的线程中销毁：这里只读存活标记，不访问接收者本身
+    const ReceiverState& state = *subscriber.state;
+    if (!state.alive.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (subscriber.mailbox) {
+        enqueue(subscriber, topic, data);
+        return;
+    }
+    if (state.courier->thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(state.courier.get(), [subscriber, topic, data]() {
+            if (subscriber.state->alive.load(std::memory_order_acquire)) {
+                invoke(subscriber, topic, data);
+            }
+        }, Qt::QueuedConnection);
+        return;
+    }
 
-    m_subscribers.insert(topic, qMakePair(receiver, slot));
+    // 同线程直接调用，回调中可以再发布、订阅或销毁接收者
+    invoke(subscriber, topic, data);
+}
 
-    // 当接收者销毁时自动取消订阅
-    connect(receiver, &QObject::destroyed, this, [this, receiver]() {
-        unsubscribeAll(receiver);
-    });
+void MessageBus::invoke(const Subscriber& subscriber, const QString& topic, const QVariant& data)
+{
+    if (subscriber.handler) {
+        subscriber.handler(topic, data);
+    } else if (subscriber.methodTakesTopic) {
+        subscriber.method.invoke(subscriber.receiver, Qt::DirectConnection,
+                                 Q_ARG(QString, topic), Q_ARG(QVariant, data));
+    } else {
+        subscriber.method.invoke(subscriber.receiver, Qt::DirectConnection, Q_ARG(QVariant, data));
+    }
 }
 
-void MessageBus::unsubscribe(const QString& topic, QObject* receiver)
+// ============================================================================
+// 投递策略
+// ============================================================================
+
+void MessageBus::enqueue(const Subscriber& subscriber, const QString& topic, const QVariant& data)
 {
-    auto it = m_subscribers.find(topic);
-    while (it != m_subscribers.end() && it.key() == topic) {
-        if (it.value().first == receiver) {
-            it = m_subscribers.erase(it);
+    Mailbox& mailbox = *subscriber.mailbox;
+    QMutexLocker locker(&mailbox.mutex);
+
+    if (mailbox.policy.mode == DeliveryPolicy::Latest) {
+        auto it = std::find_if(mailbox.pending.begin(), mailbox.pending.end(),
+                               [&topic](const QPair<QString, QVariant>& message) { return message.first == topic; });
+        if (it != mailbox.pending.end()) {
+            it->second = data;
+            ++mailbox.stats.conflated;
         } else {
-            ++it;
+            mailbox.pending.append({topic, data});
         }
+    } else {
+        if (mailbox.pending.size() >= mailbox.policy.maxQueued) {
+            mailbox.pending.removeFirst();
+            ++mailbox.stats.dropped;
+        }
+        mailbox.pending.append({topic, data});
+    }
+
+    if (mailbox.scheduled) {
+        return;
+    }
+    mailbox.scheduled = true;
+
+    // 限速：距上次投递不足最小间隔时，在接收者线程中延迟取出
+    int delay = 0;
+    if (mailbox.policy.minIntervalMs > 0 && mailbox.sinceDelivery.isValid()) {
+        delay = int(qMax<qint64>(0, mailbox.policy.minIntervalMs - mailbox.sinceDelivery.elapsed()));
     }
+    QObject* courier = subscriber.state->courier.get();
+    QMetaObject::invokeMethod(courier, [subscriber, courier, delay]() {
+        if (delay > 0) {
+            QTimer::singleShot(delay, courier, [subscriber]() { drain(subscriber); });
+        } else {
+            drain(subscriber);
+        }
+    }, Qt::QueuedConnection);
 }
 
-void MessageBus::unsubscribeAll(QObject* receiver)
+void MessageBus::drain(const Subscriber& subscriber)
 {
-    auto it = m_subscribers.begin();
-    while (it != m_subscribers.end()) {
-        if (it.value().first == receiver) {
-            it = m_subscribers.erase(it);
-        } else {
-            ++it;
+    // 在接收者线程中执行；接收者已销毁时丢弃
+    if (!subscriber.state->alive.load(std::memory_order_acquire)) {
+        return;
+    }
+    QList<QPair<QString, QVariant>> messages;
+    {
+        Mailbox& mailbox = *subscriber.mailbox;
+        QMutexLocker locker(&mailbox.mutex);
+        messages.swap(mailbox.pending);
+        mailbox.scheduled = false;
+        mailbox.sinceDelivery.start();
+        mailbox.stats.delivered += quint64(messages.size());
+    }
+    for (const auto& [topic, data] : std::as_const(messages)) {
+        // 回调中可能销毁接收者
+        if (!subscriber.state->alive.load(std::memory_order_acquire)) {
+            break;
+        }
+        invoke(subscriber, topic, data);
+    }
+}
+
+MessageBus::DeliveryStatistics MessageBus::deliveryStatistics() const
+{
+    const Snapshot snapshot(this);
+    DeliveryStatistics total;
+    QSet<const Mailbox*> seen;
+    for (const Topic& entry : snapshot->topics) {
+        for (const Subscriber& subscriber : entry.subscribers) {
+            Mailbox* mailbox = subscriber.mailbox.get();
+            if (!mailbox || seen.contains(mailbox)) {
+                continue;
+            }
+            seen.insert(mailbox);
+
+            QMutexLocker locker(&mailbox->mutex);
+            total.delivered += mailbox->stats.delivered;
+            total.conflated += mailbox->stats.conflated;
+            total.dropped += mailbox->stats.dropped;
+        }
+    }
+    return total;
+}
+
+QVariantList MessageBus::deliveryDiagnostics() const
+{
+    const Snapshot snapshot(this);
+    QVariantList result;
+    QSet<const Mailbox*> seen;      // 通配订阅者出现在多个主题中，共用一个 Mailbox
+    for (const Topic& entry : snapshot->topics) {
+        for (const Subscriber& subscriber : entry.subscribers) {
+            Mailbox* mailbox = subscriber.mailbox.get();
+            if (!mailbox || seen.contains(mailbox)) {
+                continue;
+            }
+            seen.insert(mailbox);
+
+            QMutexLocker locker(&mailbox->mutex);
+            QVariantMap item;
+            item[QStringLiteral("topic")] = subscriber.pattern.isEmpty() ? entry.name : subscriber.pattern;
+            item[QStringLiteral("receiver")] = QString::fromLatin1(subscriber.receiver->metaObject()->className());
+            item[QStringLiteral("mode")] = mailbox->policy.mode == DeliveryPolicy::Latest
+                                               ? QStringLiteral("latest") : QStringLiteral("queue");
+            item[QStringLiteral("minIntervalMs")] = mailbox->policy.minIntervalMs;
+            item[QStringLiteral("pending")] = int(mailbox->pending.size());
+            item[QStringLiteral("delivered")] = mailbox->stats.delivered;
+            item[QStringLiteral("conflated")] = mailbox->stats.conflated;
+            item[QStringLiteral("dropped")] = mailbox->stats.dropped;
+            result.append(item);
+        }
+    }
+    return result;
+}
+
+// ============================================================================
+// 订阅
+// ============================================================================
+
+QMetaMethod MessageBus::findSlot(const QObject* receiver, const char* slot, bool& takesTopic)
+{
+    // 兼容 SLOT() 宏带的方法类型前缀
+    QByteArray name(slot);
+    if (!name.isEmpty() && name.at(0) >= '0' && name.at(0) <= '9') {
+        name.remove(0, 1);
+    }
+
+    const QMetaObject* meta = receiver->metaObject();
+    const int parenthesis = name.indexOf('(');
+    if (parenthesis >= 0) {
+        const int index = meta->indexOfMethod(QMetaObject::normalizedSignature(name.constData()).constData());
+        if (index < 0) {
+            return QMetaMethod();
+        }
+        const QMetaMethod method = meta->method(index);
+        if (method.parameterCount() == 2 && method.parameterMetaType(0) == QMetaType::fromType<QString>()
+            && method.parameterMetaType(1) == QMetaType::fromType<QVariant>()) {
+            takesTopic = true;
+            return method;
+        }
+        if (method.parameterCount() == 1 && method.parameterMetaType(0) == QMetaType::fromType<QVariant>()) {
+            takesTopic = false;
+            return method;
+        }
+        return QMetaMethod();
+    }
+
+    QMetaMethod dataOnly;
+    for (int i = 0; i < meta->methodCount(); ++i) {
+        const QMetaMethod method = meta->method(i);
+        if (method.name() != name) {
+            continue;
+        }
+        if (method.parameterCount() == 2 && method.parameterMetaType(0) == QMetaType::fromType<QString>()
+            && method.parameterMetaType(1) == QMetaType::fromType<QVariant>()) {
+            takesTopic = true;
+            return method;
+        }
+        if (method.parameterCount() == 1 && method.parameterMetaType(0) == QMetaType::fromType<QVariant>()) {
+            dataOnly = method;
+        }
+    }
+    takesTopic = false;
+    return dataOnly;
+}
+
+bool MessageBus::prepare(Subscriber& subscriber, const char* slot)
+{
+    subscriber.method = findSlot(subscriber.receiver, slot, subscriber.methodTakesTopic);
+    if (!subscriber.method.isValid()) {
+        qWarning() << "[MessageBus] No slot" << slot << "taking (QString, QVariant) or (QVariant) on"
+                   << subscriber.receiver->metaObject()->className();
+        return false;
+    }
+    return true;
+}
+
+void MessageBus::setPolicy(Subscriber& subscriber, const DeliveryPolicy& policy)
+{
+    if (policy.mode == DeliveryPolicy::Immediate) {
+        return;
+    }
+    subscriber.mailbox = std::make_shared<Mailbox>();
+    subscriber.mailbox->policy = policy;
+    subscriber.mailbox->policy.minIntervalMs = qMax(0, policy.minIntervalMs);
+    if (policy.mode == DeliveryPolicy::Queue) {
+        subscriber.mailbox->policy.maxQueued = qMax(1, policy.maxQueued);
+    }
+}
+
+bool MessageBus::subscribe(TopicId topic, QObject* receiver, const char* slot, const DeliveryPolicy& policy)
+{
+    if (!receiver || !slot || topic < 0) return false;
+
+    Subscriber subscriber;
+    subscriber.receiver = receiver;
+    if (!prepare(subscriber, slot)) {
+        return false;
+    }
+    setPolicy(subscriber, policy);
+    addSubscriber(topic, std::move(subscriber));
+    return true;
+}
+
+bool MessageBus::subscribe(const QString& topic, QObject* receiver, const char* slot, const DeliveryPolicy& policy)
+{
+    if (!isPattern(topic)) {
+        return subscribe(this->topic(topic), receiver, slot, policy);
+    }
+    if (!receiver || !slot) return false;
+
+    Subscriber subscriber;
+    subscriber.receiver = receiver;
+    if (!prepare(subscriber, slot)) {
+        return false;
+    }
+    setPolicy(subscriber, policy);
+    addPatternSubscriber(topic, std::move(subscriber));
+    return true;
+}
+
+void MessageBus::subscribe(TopicId topic, QObject* context, Handler handler, const DeliveryPolicy& policy)
+{
+    if (!context || !handler || topic < 0) return;
+
+    Subscriber subscriber;
+    subscriber.receiver = context;
+    subscriber.handler = std::move(handler);
+    setPolicy(subscriber, policy);
+    addSubscriber(topic, std::move(subscriber));
+}
+
+void MessageBus::subscribe(const QString& topic, QObject* context, Handler handler, const DeliveryPolicy& policy)
+{
+    if (!isPattern(topic)) {
+        subscribe(this->topic(topic), context, std::move(handler), policy);
+        return;
+    }
+    if (!context || !handler) return;
+
+    Subscriber subscriber;
+    subscriber.receiver = context;
+    subscriber.handler = std::move(handler);
+    setPolicy(subscriber, policy);
+    addPatternSubscriber(topic, std::move(subscriber));
+}
+
+void MessageBus::attachReceiver(Subscriber& subscriber)
+{
+    // 调用方持有 m_writeMutex
+    QObject* receiver = subscriber.receiver;
+    std::shared_ptr<ReceiverState>& state = m_receivers[receiver];
+    if (!state) {
+        state = std::make_shared<ReceiverState>();
+        state->courier.reset(new QObject);
+        state->courier->moveToThread(receiver->thread());
+        // 当接收者销毁时自动取消订阅；直接连接，在接收者线程中同步完成
+        connect(receiver, &QObject::destroyed, this, &MessageBus::onReceiverDestroyed, Qt::DirectConnection);
+    }
+    subscriber.state = state;
+}
+
+void MessageBus::addSubscriber(TopicId topic, Subscriber subscriber)
+{
+    QMutexLocker locker(&m_writeMutex);
+    if (topic >= m_registry.load()->topics.size()) {
+        qWarning() << "[MessageBus] Unknown topic id:" << topic;
+        return;
+    }
+    attachReceiver(subscriber);
+    update([topic, &subscriber](Registry& registry) {
+        registry.topics[topic].subscribers.append(std::move(subscriber));
+    });
+}
+
+void MessageBus::addPatternSubscriber(const QString& pattern, Subscriber subscriber)
+{
+    const QStringList levels = pattern.split(QLatin1Char('/'));
+    if (!isValidPattern(levels)) {
+        qWarning() << "[MessageBus] Invalid wildcard pattern, '#' must be the last level:" << pattern;
+        return;
+    }
+
+    QMutexLocker locker(&m_writeMutex);
+    attachReceiver(subscriber);
+    subscriber.pattern = pattern;
+    update([&levels, &subscriber](Registry& registry) {
+        // 插入前缀树
+        int node = 0;
+        for (const QString& level : levels) {
+            int child = registry.patterns.at(node).children.value(level, -1);
+            if (child < 0) {
+                child = int(registry.patterns.size());
+                registry.patterns.append(PatternNode());
+                registry.patterns[node].children.insert(level, child);
+            }
+            node = child;
         }
+        registry.patterns[node].subscribers.append(subscriber);
+
+        // 并入已登记的匹配主题
+        for (Topic& entry : registry.topics) {
+            if (patternMatches(levels, entry.name.split(QLatin1Char('/')))) {
+                entry.subscribers.append(subscriber);
+            }
+        }
+    });
+}
+
+void MessageBus::removeSubscribers(const std::function<bool(const Subscriber&)>& predicate, TopicId topic)
+{
+    // 调用方持有 m_writeMutex
+    // topic 为 InvalidTopic 时同时清理所有主题和前缀树
+    const Registry* current = m_registry.load();
+    const auto matches = [&predicate](const QList<Subscriber>& subscribers) {
+        return std::any_of(subscribers.cbegin(), subscribers.cend(), predicate);
+    };
+    bool found = false;
+    for (qsizetype i = 0; i < current->topics.size() && !found; ++i) {
+        if (topic == InvalidTopic || topic == i) {
+            found = matches(current->topics.at(i).subscribers);
+        }
+    }
+    for (qsizetype i = 0; i < current->patterns.size() && !found && topic == InvalidTopic; ++i) {
+        found = matches(current->patterns.at(i).subscribers);
+    }
+    if (!found) {
+        return;
+    }
+    update([&predicate, &matches, topic](Registry& registry) {
+        for (qsizetype i = 0; i < registry.topics.size(); ++i) {
+            if ((topic == InvalidTopic || topic == i) && matches(registry.topics.at(i).subscribers)) {
+                registry.topics[i].subscribers.removeIf(predicate);
+            }
+        }
+        if (topic != InvalidTopic) {
+            return;
+        }
+        // 空节点保留，通配模式通常很少
+        for (qsizetype i = 0; i < registry.patterns.size(); ++i) {
+            if (matches(registry.patterns.at(i).subscribers)) {
+                registry.patterns[i].subscribers.removeIf(predicate);
+            }
+        }
+    });
+}
+
+void MessageBus::onReceiverDestroyed(QObject* receiver)
+{
+    QMutexLocker locker(&m_writeMutex);
+    const std::shared_ptr<ReceiverState> state = m_receivers.take(receiver);
+    if (state) {
+        // 在接收者线程中清除：之后发布端不再排队，已排队到 courier 的消息执行时丢弃
+        state->alive.store(false, std::memory_order_release);
+    }
+    removeSubscribers([receiver](const Subscriber& subscriber) {
+        return subscriber.receiver == receiver;
+    }, InvalidTopic);
+}
+
+void MessageBus::unsubscribe(const QString& topic, QObject* receiver)
+{
+    QMutexLocker locker(&m_writeMutex);
+    if (isPattern(topic)) {
+        removeSubscribers([receiver, &topic](const Subscriber& subscriber) {
+            return subscriber.receiver == receiver && subscriber.pattern == topic;
+        }, InvalidTopic);
+        return;
+    }
+    const TopicId id = m_registry.load()->topicIds.value(topic, InvalidTopic);
+    if (id == InvalidTopic) {
+        return;
     }
+    // 只取消精确订阅，经由通配模式的订阅保留
+    removeSubscribers([receiver](const Subscriber& subscriber) {
+        return subscriber.receiver == receiver && subscriber.pattern.isEmpty();
+    }, id);
+}
+
+void MessageBus::unsubscribeAll(QObject* receiver)
+{
+    QMutexLocker locker(&m_writeMutex);
+    removeSubscribers([receiver](const Subscriber& subscriber) {
+        return subscriber.receiver == receiver;
+    }, InvalidTopic);
 }
 
 void MessageBus::send(const QString& topic, const QVariant& data)
@@ -83,4 +717,60 @@ void MessageBus::send(const QString& topic, const QVariant& data)
     publish(topic, data);
 }
 
+bool MessageBus::parsePolicy(const QVariantMap& options, DeliveryPolicy& policy)
+{
+    const QString mode = options.value(QStringLiteral("mode"), QStringLiteral("immediate")).toString();
+    if (mode == QLatin1String("immediate")) {
+        policy.mode = DeliveryPolicy::Immediate;
+    } else if (mode == QLatin1String("latest")) {
+        policy.mode = DeliveryPolicy::Latest;
+    } else if (mode == QLatin1String("queue")) {
+        policy.mode = DeliveryPolicy::Queue;
+    } else {
+        qWarning() << "[MessageBus] Unknown delivery mode:" << mode;
+        return false;
+    }
+    policy.maxQueued = options.value(QStringLiteral("maxQueued")).toInt();
+    policy.minIntervalMs = options.value(QStringLiteral("minIntervalMs")).toInt();
+    return true;
+}
+
+QObject* MessageBus::subscribe(const QString& topic, const QJSValue& callback, const QVariantMap& policy)
+{
+    if (!m_jsEngine || !callback.isCallable()) {
+        qWarning() << "[MessageBus] subscribe() needs a QML engine and a callable callback:" << topic;
+        return nullptr;
+    }
+    if (isPattern(topic) && !isValidPattern(topic.split(QLatin1Char('/')))) {
+        qWarning() << "[MessageBus] Invalid wildcard pattern, '#' must be the last level:" << topic;
+        return nullptr;
+    }
+    DeliveryPolicy deliveryPolicy;
+    if (!parsePolicy(policy, deliveryPolicy)) {
+        return nullptr;
+    }
+
+    // 句柄作为订阅的接收者：在引擎线程中投递，随引擎销毁而取消订阅
+    QJSEngine* engine = m_jsEngine;
+    auto* subscription = new QmlSubscription(engine, callback);
+    subscription->setObjectName(topic);
+    QJSEngine::setObjectOwnership(subscription, QJSEngine::CppOwnership);
+
+    // 处理函数只在句柄存活时于引擎线程中调用（见 deliver/drain 的存活检查）
+    subscribe(topic, subscription, [subscription](const QString& name, const QVariant& data) {
+        subscription->call(name, data);
+    }, deliveryPolicy);
+    return subscription;
+}
+
+void MessageBus::unsubscribe(QObject* subscription)
+{
+    if (!dynamic_cast<QmlSubscription*>(subscription)) {
+        return;
+    }
+    // 立即停止投递；句柄可能正处于自己的回调中，延后销毁
+    unsubscribeAll(subscription);
+    subscription->deleteLater();
+}
+
 } // namespace YEFS
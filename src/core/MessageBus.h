@@ -4,17 +4,44 @@
 #include <QObject>
 #include <QVariant>
 #include <QHash>
+#include <QElapsedTimer>
 #include <QList>
-#include <QPair>
+#include <QMetaMethod>
+#include <QMutex>
 #include <QJSValue>
+#include <QPointer>
 #include <QQmlEngine>
+#include <atomic>
+#include <functional>
+#include <memory>
 
 namespace YEFS {
 
 /**
  * @brief 消息总线 - 用于模块间通信
- * 
+ *
  * 支持发布/订阅模式，C++ 和 QML 都可以使用
+ *
+ * 主题名在首次使用时登记为整数 TopicId。高频发布方预先调用 topic() 取得 TopicId，
+ * 之后按 TopicId 发布，不再做字符串哈希；订阅时即解析出槽函数的 QMetaMethod，
+ * 或直接注册函数对象，发布时不再按名字查找方法。字符串接口保留，内部转换为 TopicId。
+ *
+ * 所有接口都可在任意线程调用。主题表和订阅者列表是不可变快照：订阅、取消订阅时
+ * 在写锁下复制并替换快照，旧快照等正在读取的发布者退出后释放（RCU）；
+ * 发布只在很短的临界区内取得当前快照的引用，不加锁。
+ * 消息按接收者所在线程投递：同线程直接调用，其他线程排队到接收者的事件循环。
+ * 跨线程投递不加锁：发布端只读原子的存活标记，并向与接收者同线程的投递代理排队，
+ * 事件执行时（接收者线程中）再检查一次标记。接收者订阅后不应再移动到其他线程。
+ *
+ * 主题按 '/' 分层。订阅时可以使用通配：'*' 匹配恰好一层（"map/*" 匹配 "map/ready"），
+ * '#' 只能作为最后一层，匹配零或多层（"map/#" 匹配 "map"、"map/layer/added"）。
+ * 通配订阅存放在按层级组织的前缀树中；新主题登记或新增通配订阅时即把匹配的订阅者
+ * 并入各主题的订阅者列表，发布时不再做模式匹配。通配主题不能用于发布。
+ *
+ * 高频主题的慢订阅者可以在订阅时指定投递策略（DeliveryPolicy）：只保留每个主题的最新值、
+ * 有界队列丢弃最旧消息，以及两次投递之间的最小间隔。带策略的订阅者总是在自己的线程中
+ * 批量取出待投递消息；被合并、丢弃的数量通过 deliveryStatistics() 查询。
+ * QML 通过 subscribe(topic, callback, policy) 使用同样的投递策略，不必监听全局 message 信号。
  */
 class MessageBus : public QObject
 {
@@ -23,17 +50,78 @@ class MessageBus : public QObject
     QML_SINGLETON
 
 public:
+    using TopicId = int;
+    static constexpr TopicId InvalidTopic = -1;
+
+    // 函数对象订阅者：参数为主题名和消息数据
+    using Handler = std::function<void(const QString& topic, const QVariant& data)>;
+
+    // 订阅者的投递策略
+    struct DeliveryPolicy {
+        enum Mode {
+            Immediate,      // 每条消息都投递（默认）
+            Latest,         // 待投递期间每个主题只保留最新值
+            Queue           // 有界队列，满时丢弃最旧的消息
+        };
+        Mode mode = Immediate;
+        int maxQueued = 0;          // Queue 模式的队列上限
+        int minIntervalMs = 0;      // 两次投递的最小间隔（限速），Immediate 模式忽略
+
+        static DeliveryPolicy latest(int minIntervalMs = 0) { return {Latest, 0, minIntervalMs}; }
+        static DeliveryPolicy queue(int maxQueued, int minIntervalMs = 0) { return {Queue, maxQueued, minIntervalMs}; }
+        static DeliveryPolicy rateLimited(int minIntervalMs) { return latest(minIntervalMs); }
+    };
+
+    struct DeliveryStatistics {
+        quint64 delivered = 0;      // 带策略订阅者实际收到的消息
+        quint64 conflated = 0;      // 被同主题更新的值覆盖
+        quint64 dropped = 0;        // 队列满时丢弃
+    };
+
     static MessageBus* instance();
     static MessageBus* create(QQmlEngine* qmlEngine, QJSEngine* jsEngine);
 
+    // 主题登记：同名主题始终返回同一个 TopicId；通配模式返回 InvalidTopic
+    TopicId topic(const QString& name);
+    QString topicName(TopicId topic) const;
+
     // C++ API
+    void publish(TopicId topic, const QVariant& data = QVariant());
+    // 按名称发布只查快照，不登记未知主题（登记只发生在 subscribe/topic()）
     void publish(const QString& topic, const QVariant& data = QVariant());
-    void subscribe(const QString& topic, QObject* receiver, const char* slot);
+
+    // slot 为槽函数名（"onMessage"）或签名（"onMessage(QString,QVariant)"），
+    // 参数为 (QString, QVariant) 或 (QVariant)。找不到匹配的槽时返回 false。
+    // 字符串主题可以是通配模式
+    bool subscribe(TopicId topic, QObject* receiver, const char* slot,
+                   const DeliveryPolicy& policy = DeliveryPolicy());
+    bool subscribe(const QString& topic, QObject* receiver, const char* slot,
+                   const DeliveryPolicy& policy = DeliveryPolicy());
+    // 函数对象在 context 所在线程调用，context 销毁时自动取消
+    void subscribe(TopicId topic, QObject* context, Handler handler,
+                   const DeliveryPolicy& policy = DeliveryPolicy());
+    void subscribe(const QString& topic, QObject* context, Handler handler,
+                   const DeliveryPolicy& policy = DeliveryPolicy());
+
+    // topic 为通配模式时只取消该模式的订阅
     void unsubscribe(const QString& topic, QObject* receiver);
     void unsubscribeAll(QObject* receiver);
 
+    static bool isPattern(const QString& topic);
+
+    // 当前所有带策略订阅者的计数合计
+    DeliveryStatistics deliveryStatistics() const;
+
     // QML API
     Q_INVOKABLE void send(const QString& topic, const QVariant& data = QVariant());
+    // callback(topic, data) 在 QML 引擎线程中调用；topic 可以是通配模式。
+    // policy 为 { mode: "immediate" | "latest" | "queue", maxQueued, minIntervalMs }。
+    // 返回订阅句柄，传给 unsubscribe() 取消；QML 引擎销毁时自动取消。失败时返回 null
+    Q_INVOKABLE QObject* subscribe(const QString& topic, const QJSValue& callback,
+                                   const QVariantMap& policy = QVariantMap());
+    Q_INVOKABLE void unsubscribe(QObject* subscription);
+    // 诊断：每个带策略订阅者一项（topic、receiver、mode、pending、delivered、conflated、dropped）
+    Q_INVOKABLE QVariantList deliveryDiagnostics() const;
 
 signals:
     /**
@@ -42,11 +130,109 @@ signals:
     void message(const QString& topic, const QVariant& data);
 
 private:
+    // 在对象所属线程中删除，可在任意线程释放
+    struct LaterDeleter {
+        void operator()(QObject* object) const { object->deleteLater(); }
+    };
+
+    // 接收者存活标记：销毁时在接收者线程中清除。跨线程的消息排队到 courier
+    // （与接收者同线程、随最后一个引用释放），执行时再检查标记，
+    // 因此发布端从不向可能已销毁的接收者排队
+    struct ReceiverState {
+        std::atomic<bool> alive{true};
+        std::unique_ptr<QObject, LaterDeleter> courier;
+    };
+
+    // 带策略订阅者的待投递消息，在接收者线程中批量取出
+    struct Mailbox {
+        QMutex mutex;
+        DeliveryPolicy policy;
+        QList<QPair<QString, QVariant>> pending;
+        bool scheduled = false;             // 已排队取出
+        QElapsedTimer sinceDelivery;        // 上次取出后经过的时间
+        DeliveryStatistics stats;
+    };
+
+    struct Subscriber {
+        QObject* receiver = nullptr;
+        std::shared_ptr<ReceiverState> state;
+        std::shared_ptr<Mailbox> mailbox;   // 为空表示 Immediate
+        QMetaMethod method;         // 槽函数订阅
+        bool methodTakesTopic = false;
+        Handler handler;            // 函数对象订阅
+        QString pattern;            // 来自通配订阅时为其模式
+    };
+
+    struct Topic {
+        QString name;
+        QList<Subscriber> subscribers;
+    };
+
+    // 通配订阅前缀树的节点，每层一个节点
+    struct PatternNode {
+        QHash<QString, int> children;           // 层级（含 "*"、"#"）-> 节点下标
+        QList<Subscriber> subscribers;          // 模式在此节点结束的订阅者
+    };
+
+    // 不可变快照，引用计数归零时释放
+    struct Registry {
+        QList<Topic> topics;                    // 下标即 TopicId，订阅者已含匹配的通配订阅
+        QHash<QString, TopicId> topicIds;
+        QList<PatternNode> patterns{PatternNode()};     // 0 为根节点
+        mutable QAtomicInt ref = 1;
+    };
+
+    // 持有快照引用的读端句柄
+    class Snapshot
+    {
+    public:
+        explicit Snapshot(const MessageBus* bus);
+        ~Snapshot();
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        const Registry* operator->() const { return m_registry; }
+        const Registry& operator*() const { return *m_registry; }
+
+    private:
+        const Registry* m_registry;
+    };
+
     explicit MessageBus(QObject* parent = nullptr);
-    ~MessageBus() override = default;
+    ~MessageBus() override;
+
+    static QMetaMethod findSlot(const QObject* receiver, const char* slot, bool& takesTopic);
+    static bool isValidPattern(const QStringList& levels);
+    static bool patternMatches(const QStringList& pattern, const QStringList& levels);
+    static void collectPatternSubscribers(const Registry& registry, int node, const QStringList& levels,
+                                          qsizetype level, QList<Subscriber>& out);
+    static void release(const Registry* registry);
+    // 在写锁下复制当前快照、修改后替换
+    void update(const std::function<void(Registry&)>& modify);
+    TopicId registerTopic(const QString& name);
+    static bool prepare(Subscriber& subscriber, const char* slot);
+    static void setPolicy(Subscriber& subscriber, const DeliveryPolicy& policy);
+    static bool parsePolicy(const QVariantMap& options, DeliveryPolicy& policy);
+    void attachReceiver(Subscriber& subscriber);
+    void addSubscriber(TopicId topic, Subscriber subscriber);
+    void addPatternSubscriber(const QString& pattern, Subscriber subscriber);
+    void removeSubscribers(const std::function<bool(const Subscriber&)>& predicate, TopicId topic);
+    void deliver(const Subscriber& subscriber, const QString& topic, const QVariant& data);
+    static void invoke(const Subscriber& subscriber, const QString& topic, const QVariant& data);
+    static void enqueue(const Subscriber& subscriber, const QString& topic, const QVariant& data);
+    static void drain(const Subscriber& subscriber);
+    void onReceiverDestroyed(QObject* receiver);
 
     static MessageBus* s_instance;
-    QMultiHash<QString, QPair<QObject*, const char*>> m_subscribers;
+
+    std::atomic<const Registry*> m_registry;
+    // 读端纪元：两个计数器轮换，写端切换纪元后等待旧纪元的读者退出
+    mutable std::atomic<int> m_epoch{0};
+    mutable std::atomic<int> m_readers[2] = {{0}, {0}};
+
+    QMutex m_writeMutex;
+    QHash<QObject*, std::shared_ptr<ReceiverState>> m_receivers;    // 受写锁保护
+    QMetaMethod m_messageSignal;
+    QPointer<QJSEngine> m_jsEngine;         // QML 订阅回调所属的引擎，只在主线程访问
 };
 
 // 预定义消息主题
@@ -55,6 +241,7 @@ namespace Topics {
     constexpr const char* MAP_READY = "map/ready";
     constexpr const char* MAP_CENTER_CHANGED = "map/center/changed";
     constexpr const char* MAP_ZOOM_CHANGED = "map/zoom/changed";
+    constexpr const char* MAP_CAMERA_CHANGED = "map/camera/changed";   // CameraState，每帧至多一次
     constexpr const char* MAP_CLICKED = "map/clicked";
     constexpr const char* MAP_LAYER_ADDED = "map/layer/added";
     constexpr const char* MAP_LAYER_REMOVED = "map/layer/removed";
@@ -1,11 +1,56 @@
 #include "OnlineMapProvider.h"
 #include <QDebug>
 #include <QUuid>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QPointer>
+#include <memory>
+#include "tiles/TileFetcher.h"
+#include "tiles/ITileProvider.h"
+#include "tiles/LocalTileServer.h"
 
 namespace YEFS {
 
+namespace {
+
+/**
+ * @brief 在线瓦片的本地代理
+ *
+ * MapLibre 经 LocalTileServer 请求在线瓦片，由 TileFetcher 下载（共享磁盘缓存、
+ * 视口优先级和预取），不再走 MapLibre 自己的 HTTP 栈。
+ */
+class OnlineTileProxy : public ITileProvider
+{
+public:
+    explicit OnlineTileProxy(const OnlineTileSource* source)
+        : m_source(source)
+        , m_contentType(contentTypeForFormat(source->format()))
+        , m_extension(source->format())
+    {
+    }
+
+    // 只走异步路径
+    QByteArray tileData(int, int, int) override { return QByteArray(); }
+
+    bool requestTileData(int z, int x, int y, const DataCallback& done) override
+    {
+        if (!m_source) {
+            done(QByteArray());
+        } else {
+            TileFetcher::instance()->requestTileData(m_source.data(), z, x, y, done);
+        }
+        return true;
+    }
+
+    QByteArray contentType() const override { return m_contentType; }
+    QString fileExtension() const override { return m_extension; }
+
+private:
+    QPointer<const OnlineTileSource> m_source;
+    QByteArray m_contentType;
+    QString m_extension;
+};
+
+} // namespace
+
 // ============================================================================
 // OnlineTileSource 实现
 // ============================================================================
@@ -23,6 +68,41 @@ OnlineTileSource::OnlineTileSource(const QString& id, const QString& name,
     , m_maxZoom(maxZoom)
     , m_attribution(attribution)
 {
+    TileFetcher* fetcher = TileFetcher::instance();
+    connect(fetcher, &TileFetcher::tileReady, this,
+            [this](const QString& sourceId, int z, int x, int y, const QImage& image) {
+        if (sourceId == m_id) {
+            emit tileLoaded(z, x, y, image);
+        }
+    });
+    connect(fetcher, &TileFetcher::tileFailed, this,
+            [this](const QString& sourceId, int z, int x, int y, const QString& error) {
+        if (sourceId == m_id) {
+            emit tileLoadFailed(z, x, y, error);
+        }
+    });
+}
+
+OnlineTileSource::~OnlineTileSource()
+{
+    if (!m_proxyUrlTemplate.isEmpty()) {
+        LocalTileServer::instance()->removeTileset(proxyName());
+    }
+    TileFetcher::instance()->cancelSource(m_id);
+}
+
+QString OnlineTileSource::proxyName() const
+{
+    return QStringLiteral("online-") + m_id;
+}
+
+QString OnlineTileSource::ensureProxyUrlTemplate() const
+{
+    if (m_proxyUrlTemplate.isEmpty()) {
+        m_proxyUrlTemplate = LocalTileServer::instance()->addTileset(
+            proxyName(), std::make_shared<OnlineTileProxy>(this));
+    }
+    return m_proxyUrlTemplate;
 }
 
 QGeoRectangle OnlineTileSource::bounds() const
@@ -34,11 +114,7 @@ QGeoRectangle OnlineTileSource::bounds() const
 
 QImage OnlineTileSource::tile(int z, int x, int y) const
 {
-    // TODO: 实现异步瓦片下载
-    Q_UNUSED(z)
-    Q_UNUSED(x)
-    Q_UNUSED(y)
-    return QImage();
+    return TileFetcher::instance()->requestTile(this, z, x, y);
 }
 
 QString OnlineTileSource::tileUrl(int z, int x, int y) const
@@ -72,9 +148,12 @@ QVariantMap OnlineTileSource::toMapLibreLayer() const
     layer["id"] = m_id;
     layer["type"] = "raster";
     
+    // 瓦片经本地代理由 TileFetcher 下载；本地服务不可用时退回直接访问
+    const QString proxy = ensureProxyUrlTemplate();
+
     QVariantMap source;
     source["type"] = "raster";
-    source["tiles"] = QStringList{m_urlTemplate};
+    source["tiles"] = QStringList{proxy.isEmpty() ? m_urlTemplate : proxy};
     source["tileSize"] = m_tileSize;
     source["minzoom"] = m_minZoom;
     source["maxzoom"] = m_maxZoom;
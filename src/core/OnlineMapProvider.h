@@ -12,6 +12,11 @@ namespace YEFS {
 
 /**
  * @brief 在线地图瓦片源
+ *
+ * tile() 通过共享的 TileFetcher 异步下载：内存缓存命中时直接返回，
+ * 否则返回空图像，下载解码完成后发出 tileLoaded。
+ * toMapLibreLayer() 的瓦片 URL 指向 LocalTileServer 上的代理（首次调用时注册，须在 GUI 线程），
+ * MapLibre 的请求同样经 TileFetcher 下载，可直接使用预取进磁盘缓存的瓦片。
  */
 class OnlineTileSource : public IOnlineMapSource
 {
@@ -23,7 +28,7 @@ public:
                              int minZoom = 0, int maxZoom = 18,
                              const QString& attribution = QString(),
                              QObject* parent = nullptr);
-    ~OnlineTileSource() override = default;
+    ~OnlineTileSource() override;
 
     // IMapSource 接口实现
     QString id() const override { return m_id; }
@@ -59,7 +64,14 @@ public:
     void setAttribution(const QString& attribution) { m_attribution = attribution; }
     void setTermsOfServiceUrl(const QUrl& url) { m_tosUrl = url; }
 
+signals:
+    void tileLoaded(int z, int x, int y, const QImage& image);
+    void tileLoadFailed(int z, int x, int y, const QString& error);
+
 private:
+    QString proxyName() const;
+    QString ensureProxyUrlTemplate() const;
+
     QString m_id;
     QString m_name;
     QString m_urlTemplate;
@@ -71,6 +83,7 @@ private:
     int m_tileSize = 256;
     bool m_requiresApiKey = false;
     QString m_apiKey;
+    mutable QString m_proxyUrlTemplate;
 };
 
 /**
@@ -0,0 +1,169 @@
+#include "ParseTask.h"
+#include "IMapSource.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <QDebug>
+
+namespace YEFS {
+
+// ============================================================================
+// ParseControl 实现
+// ============================================================================
+
+ParseControl::~ParseControl()
+{
+    // 结果已脱离线程归属，可在任意线程释放
+    delete m_result;
+}
+
+QString ParseControl::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+void ParseControl::setProgress(qint64 bytesDone, qint64 bytesTotal)
+{
+    m_bytesDone.store(bytesDone, std::memory_order_relaxed);
+    m_bytesTotal.store(bytesTotal, std::memory_order_relaxed);
+
+    const int permille = bytesTotal > 0 ? int(qMin<qint64>(bytesDone * 1000 / bytesTotal, 1000)) : 0;
+    if (m_permille.exchange(permille, std::memory_order_relaxed) != permille) {
+        emit progressChanged();
+    }
+}
+
+bool ParseControl::checkpoint(qint64 bytesDone, qint64 bytesTotal)
+{
+    setProgress(bytesDone, bytesTotal);
+    return !isCanceled();
+}
+
+void ParseControl::setError(const QString& message)
+{
+    QMutexLocker locker(&m_mutex);
+    m_errorString = message;
+}
+
+void ParseControl::finish(IMapSource* source)
+{
+    if (source) {
+        if (isCanceled()) {
+            // 已取消：半成品直接在工作线程释放
+            delete source;
+            source = nullptr;
+        } else {
+            // 解除线程归属，交给 ParseTask 拉回自己的线程
+            source->moveToThread(nullptr);
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        delete m_result;
+        m_result = source;
+    }
+    emit finished();
+}
+
+IMapSource* ParseControl::takeResult()
+{
+    QMutexLocker locker(&m_mutex);
+    IMapSource* source = m_result;
+    m_result = nullptr;
+    return source;
+}
+
+// ============================================================================
+// ParseTask 实现
+// ============================================================================
+
+ParseTask::ParseTask(const QString& filePath, std::shared_ptr<ParseControl> control, QObject* parent)
+    : QObject(parent)
+    , m_filePath(filePath)
+    , m_control(std::move(control))
+{
+    // 信号在工作线程发出，排队回到任务所在线程
+    connect(m_control.get(), &ParseControl::progressChanged,
+            this, &ParseTask::progressChanged, Qt::QueuedConnection);
+    connect(m_control.get(), &ParseControl::finished,
+            this, &ParseTask::onControlFinished, Qt::QueuedConnection);
+}
+
+ParseTask* ParseTask::start(const QString& filePath, Job job, QThreadPool* pool)
+{
+    auto control = std::make_shared<ParseControl>();
+    auto task = new ParseTask(filePath, control);
+
+    if (!pool) {
+        pool = QThreadPool::globalInstance();
+    }
+    pool->start([control, job = std::move(job)]() {
+        IMapSource* source = control->isCanceled() ? nullptr : job(control.get());
+        if (!source && !control->isCanceled() && control->errorString().isEmpty()) {
+            control->setError(QStringLiteral("解析失败"));
+        }
+        control->finish(source);
+    });
+
+    return task;
+}
+
+ParseTask::~ParseTask()
+{
+    // 仍在运行时请求中止，结果由 ParseControl 释放
+    m_control->cancel();
+    m_control->disconnect(this);
+    delete m_result;
+}
+
+double ParseTask::progress() const
+{
+    if (!m_running) {
+        return 1.0;
+    }
+    const qint64 total = m_control->bytesTotal();
+    return total > 0 ? double(m_control->bytesDone()) / double(total) : 0.0;
+}
+
+void ParseTask::cancel()
+{
+    if (m_running) {
+        m_control->cancel();
+    }
+}
+
+IMapSource* ParseTask::takeResult()
+{
+    IMapSource* source = m_result;
+    m_result = nullptr;
+    return source;
+}
+
+void ParseTask::onControlFinished()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+
+    IMapSource* source = m_control->takeResult();
+    if (source) {
+        if (m_control->isCanceled()) {
+            delete source;
+            source = nullptr;
+        } else {
+            source->moveToThread(thread());
+        }
+    }
+    m_result = source;
+
+    if (!source && !m_control->isCanceled()) {
+        qWarning() << "[ParseTask] Failed:" << m_filePath << m_control->errorString();
+    }
+
+    emit progressChanged();
+    emit finished(source != nullptr);
+}
+
+} // namespace YEFS
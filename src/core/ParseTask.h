@@ -0,0 +1,120 @@
+#ifndef YEFS_PARSETASK_H
+#define YEFS_PARSETASK_H
+
+#include <QObject>
+#include <QString>
+#include <QMutex>
+#include <QQmlEngine>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace YEFS {
+
+class IMapSource;
+
+/**
+ * @brief 解析控制块
+ *
+ * 工作线程中的解析器通过它检查取消请求、上报进度和错误，并在结束时交出结果。
+ * 由 ParseTask 与工作线程共同持有（std::shared_ptr），任何一方先销毁都不会泄漏未取走的数据源。
+ */
+class ParseControl : public QObject
+{
+    Q_OBJECT
+
+public:
+    ParseControl() = default;
+    ~ParseControl() override;
+
+    // 线程安全
+    void cancel() { m_canceled.store(true); }
+    bool isCanceled() const { return m_canceled.load(std::memory_order_relaxed); }
+    qint64 bytesDone() const { return m_bytesDone.load(std::memory_order_relaxed); }
+    qint64 bytesTotal() const { return m_bytesTotal.load(std::memory_order_relaxed); }
+    QString errorString() const;
+
+    // 工作线程调用
+    void setProgress(qint64 bytesDone, qint64 bytesTotal);
+    bool checkpoint(qint64 bytesDone, qint64 bytesTotal);    // 上报进度，返回 false 表示应中止
+    void setError(const QString& message);
+    void finish(IMapSource* source);
+
+    // 取走结果，取走后由调用方负责释放
+    IMapSource* takeResult();
+
+signals:
+    void progressChanged();
+    void finished();
+
+private:
+    Q_DISABLE_COPY(ParseControl)
+
+    std::atomic_bool m_canceled{false};
+    std::atomic<qint64> m_bytesDone{0};
+    std::atomic<qint64> m_bytesTotal{0};
+    std::atomic_int m_permille{-1};      // 按千分比节流进度信号
+
+    mutable QMutex m_mutex;
+    QString m_errorString;
+    IMapSource* m_result = nullptr;      // 无线程归属，由取走方拉回自己的线程
+};
+
+/**
+ * @brief 异步解析任务句柄
+ *
+ * 由 MapParserFactory::parseFileAsync 创建，在创建它的线程中通知进度和完成。
+ * 取消或销毁任务时，后台尚未交付的数据源会被自动释放。
+ */
+class ParseTask : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("ParseTask 由 MapParserFactory.parseFileAsync 创建")
+
+    Q_PROPERTY(QString filePath READ filePath CONSTANT)
+    Q_PROPERTY(bool running READ isRunning NOTIFY finished)
+    Q_PROPERTY(bool canceled READ isCanceled NOTIFY finished)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
+
+public:
+    using Job = std::function<IMapSource*(ParseControl* control)>;
+
+    ParseTask(const QString& filePath, std::shared_ptr<ParseControl> control, QObject* parent = nullptr);
+    ~ParseTask() override;
+
+    // 在线程池（为空时使用全局线程池）中执行 job，返回属于调用线程的任务句柄
+    static ParseTask* start(const QString& filePath, Job job, QThreadPool* pool = nullptr);
+
+    QString filePath() const { return m_filePath; }
+    bool isRunning() const { return m_running; }
+    bool isCanceled() const { return m_control->isCanceled(); }
+    double progress() const;
+    qint64 bytesDone() const { return m_control->bytesDone(); }
+    qint64 bytesTotal() const { return m_control->bytesTotal(); }
+    QString errorString() const { return m_control->errorString(); }
+
+    Q_INVOKABLE void cancel();
+
+    // 解析结果，成功完成后有效；takeResult 转移所有权
+    IMapSource* result() const { return m_result; }
+    IMapSource* takeResult();
+
+signals:
+    void progressChanged();
+    void finished(bool success);
+
+private:
+    void onControlFinished();
+
+    QString m_filePath;
+    std::shared_ptr<ParseControl> m_control;
+    IMapSource* m_result = nullptr;
+    bool m_running = true;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_PARSETASK_H
@@ -1,8 +1,13 @@
 #include "PluginManager.h"
 #include "MessageBus.h"
+#include "IMapParser.h"
 #include <QCoreApplication>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QPluginLoader>
+#include <QSet>
+#include <QThreadPool>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDebug>
@@ -23,6 +28,9 @@ public:
         if (serviceName == "MessageBus") {
             return MessageBus::instance();
         }
+        if (serviceName == "MapParserFactory") {
+            return MapParserFactory::instance();
+        }
         // 可以添加更多服务
         return nullptr;
     }
@@ -103,38 +111,89 @@ void PluginManager::scanPlugins()
 {
     qDebug() << "[PluginManager] Scanning plugins in paths:" << m_pluginPaths;
 
-    for (const QString& path : m_pluginPaths) {
-        QDir dir(path);
-        if (!dir.exists()) continue;
+    QElapsedTimer timer;
+    timer.start();
 
-        // 扫描插件文件
+    // 扫描插件文件
 #ifdef Q_OS_WIN
-        QStringList filters = {"*.dll"};
+    const QStringList filters = {"*.dll"};
 #elif defined(Q_OS_MACOS)
-        QStringList filters = {"*.dylib", "*.bundle"};
+    const QStringList filters = {"*.dylib", "*.bundle"};
 #else
-        QStringList filters = {"*.so"};
+    const QStringList filters = {"*.so"};
 #endif
 
-        for (const QString& fileName : dir.entryList(filters, QDir::Files)) {
-            QString filePath = dir.absoluteFilePath(fileName);
-            
-            QPluginLoader loader(filePath);
-            QJsonObject metaData = loader.metaData().value("MetaData").toObject();
-            
-            if (!metaData.isEmpty()) {
-                QString pluginId = metaData.value("id").toString();
-                if (!pluginId.isEmpty()) {
-                    m_pluginFiles[pluginId] = filePath;
-                    qDebug() << "[PluginManager] Found plugin:" << pluginId << "at" << filePath;
-                }
-            }
+    QList<QFileInfo> files;
+    for (const QString& path : m_pluginPaths) {
+        QDir dir(path);
+        if (!dir.exists()) continue;
+        files.append(dir.entryInfoList(filters, QDir::Files));
+    }
+
+    // 未变化的文件直接取缓存的元数据
+    m_metadataCache.load();
+    QList<QJsonObject> metaData(files.size());
+    QList<qsizetype> misses;
+    QSet<QString> filePaths;
+    for (qsizetype i = 0; i < files.size(); ++i) {
+        filePaths.insert(files.at(i).absoluteFilePath());
+        if (!m_metadataCache.lookup(files.at(i), metaData[i])) {
+            misses.append(i);
+        }
+    }
+
+    // 其余文件并行读取元数据（只读取，不加载库）
+    QJsonObject* results = metaData.data();
+    if (misses.size() == 1) {
+        results[misses.first()] = readMetaData(files.at(misses.first()).absoluteFilePath());
+    } else if (!misses.isEmpty()) {
+        QThreadPool pool;       // 独立线程池，等待时不受其他后台任务影响
+        for (qsizetype index : std::as_const(misses)) {
+            const QString filePath = files.at(index).absoluteFilePath();
+            pool.start([results, index, filePath]() {
+                results[index] = readMetaData(filePath);
+            });
         }
+        pool.waitForDone();
     }
+    for (qsizetype index : std::as_const(misses)) {
+        m_metadataCache.insert(files.at(index), metaData.at(index));
+    }
+    m_metadataCache.retain(filePaths);
+    m_metadataCache.save();
+
+    int found = 0;
+    for (qsizetype i = 0; i < files.size(); ++i) {
+        const QString pluginId = metaData.at(i).value("id").toString();
+        if (!pluginId.isEmpty()) {
+            const QString filePath = files.at(i).absoluteFilePath();
+            m_pluginFiles[pluginId] = filePath;
+            m_pluginMetaData[pluginId] = metaData.at(i);
+            ++found;
+            qDebug() << "[PluginManager] Found plugin:" << pluginId << "at" << filePath;
+        }
+    }
+
+    qDebug() << "[PluginManager] Scanned" << files.size() << "files," << found << "plugins,"
+             << misses.size() << "metadata reads in" << timer.elapsed() << "ms";
+}
+
+QJsonObject PluginManager::readMetaData(const QString& filePath)
+{
+    QPluginLoader loader(filePath);
+    return loader.metaData().value("MetaData").toObject();
+}
+
+QJsonObject PluginManager::pluginMetaData(const QString& pluginId) const
+{
+    return m_pluginMetaData.value(pluginId);
 }
 
 bool PluginManager::loadPlugin(const QString& pluginId)
 {
+    // 直接加载（含作为依赖加载）时不再需要激活条件
+    clearActivationTriggers(pluginId);
+
     if (m_plugins.contains(pluginId)) {
         qDebug() << "[PluginManager] Plugin already loaded:" << pluginId;
         return true;
@@ -223,13 +282,106 @@ void PluginManager::loadAllPlugins()
 {
     scanPlugins();
 
-    for (const QString& pluginId : m_pluginFiles.keys()) {
-        if (!m_plugins.contains(pluginId)) {
+    const QStringList pluginIds = m_pluginFiles.keys();
+    for (const QString& pluginId : pluginIds) {
+        if (m_plugins.contains(pluginId) || isActivationPending(pluginId)) {
+            continue;
+        }
+        const QJsonValue activation = m_pluginMetaData.value(pluginId).value("activation");
+        if (activation.isObject()) {
+            registerActivationTriggers(pluginId, activation.toObject());
+        } else {
             loadPlugin(pluginId);
         }
     }
 }
 
+// ============================================================================
+// 延迟激活
+// ============================================================================
+
+void PluginManager::registerActivationTriggers(const QString& pluginId, const QJsonObject& activation)
+{
+    auto toStringList = [](const QJsonValue& value) {
+        QStringList result;
+        for (const QJsonValue& item : value.toArray()) {
+            if (!item.toString().isEmpty()) {
+                result.append(item.toString());
+            }
+        }
+        return result;
+    };
+
+    // 主题：上下文对象销毁时订阅随之取消
+    QObject* guard = new QObject(this);
+    m_activationGuards.insert(pluginId, guard);
+    for (const QString& topic : toStringList(activation.value("topics"))) {
+        MessageBus::instance()->subscribe(topic, guard, [this, pluginId](const QString& topic, const QVariant& data) {
+            if (m_plugins.contains(pluginId)) {
+                return;
+            }
+            // 插件初始化时的订阅收不到本条消息，直接转交
+            if (activatePlugin(pluginId, QStringLiteral("topic ") + topic)) {
+                if (IPlugin* plugin = m_plugins.value(pluginId)) {
+                    plugin->onMessageFromHost(topic, data);
+                }
+            }
+        });
+    }
+
+    // 文件扩展名
+    const QStringList extensions = toStringList(activation.value("fileExtensions"));
+    if (!extensions.isEmpty()) {
+        // 多个插件可以声明同一扩展名，按插件 ID 登记和注销
+        MapParserFactory::instance()->registerLazyExtensions(pluginId, extensions,
+                                                             [this, pluginId](const QString& extension) {
+            activatePlugin(pluginId, QStringLiteral("file extension ") + extension);
+        });
+    }
+
+    // QML 页面
+    for (const QString& page : toStringList(activation.value("pages"))) {
+        m_pageTriggers.insert(page, pluginId);
+    }
+
+    qDebug() << "[PluginManager] Deferred plugin:" << pluginId << "activation:" << activation;
+}
+
+void PluginManager::clearActivationTriggers(const QString& pluginId)
+{
+    QObject* guard = m_activationGuards.take(pluginId);
+    if (!guard) {
+        return;
+    }
+    // 可能正处于该对象的订阅回调中，延后销毁
+    MessageBus::instance()->unsubscribeAll(guard);
+    guard->deleteLater();
+
+    MapParserFactory::instance()->unregisterLazyExtensions(pluginId);
+    m_pageTriggers.removeIf([&pluginId](const std::pair<const QString&, QString&>& trigger) {
+        return trigger.second == pluginId;
+    });
+}
+
+bool PluginManager::activatePlugin(const QString& pluginId, const QString& reason)
+{
+    if (m_plugins.contains(pluginId)) {
+        return true;
+    }
+    qDebug() << "[PluginManager] Activating plugin:" << pluginId << "on" << reason;
+    return loadPlugin(pluginId);
+}
+
+void PluginManager::activateForPage(const QString& page)
+{
+    // 按页面文件名匹配，兼容 "./Home/MapPage.qml"、"qrc:/..." 等写法
+    const QString name = QFileInfo(QUrl(page).path()).completeBaseName();
+    const QStringList pluginIds = m_pageTriggers.values(name) + m_pageTriggers.values(page);
+    for (const QString& pluginId : pluginIds) {
+        activatePlugin(pluginId, QStringLiteral("page ") + page);
+    }
+}
+
 IPlugin* PluginManager::plugin(const QString& pluginId) const
 {
     return m_plugins.value(pluginId, nullptr);
@@ -255,19 +407,28 @@ QList<QObject*> PluginManager::pluginObjects() const
     return result;
 }
 
-QObject* PluginManager::getPlugin(const QString& pluginId) const
+QObject* PluginManager::getPlugin(const QString& pluginId)
 {
+    if (isActivationPending(pluginId)) {
+        activatePlugin(pluginId, QStringLiteral("access"));
+    }
     return m_plugins.value(pluginId, nullptr);
 }
 
-QUrl PluginManager::getPluginQmlEntry(const QString& pluginId) const
+QUrl PluginManager::getPluginQmlEntry(const QString& pluginId)
 {
+    if (isActivationPending(pluginId)) {
+        activatePlugin(pluginId, QStringLiteral("QML entry"));
+    }
     IPlugin* p = plugin(pluginId);
     return p ? p->qmlEntry() : QUrl();
 }
 
-QUrl PluginManager::getPluginSettingsPage(const QString& pluginId) const
+QUrl PluginManager::getPluginSettingsPage(const QString& pluginId)
 {
+    if (isActivationPending(pluginId)) {
+        activatePlugin(pluginId, QStringLiteral("settings page"));
+    }
     IPlugin* p = plugin(pluginId);
     return p ? p->settingsPage() : QUrl();
 }
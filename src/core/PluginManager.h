@@ -7,6 +7,7 @@
 #include <QDir>
 #include <QQmlEngine>
 #include "IPlugin.h"
+#include "PluginMetadataCache.h"
 
 namespace YEFS {
 
@@ -16,6 +17,18 @@ class MessageBus;
  * @brief 插件管理器
  * 
  * 负责插件的发现、加载、卸载和生命周期管理
+ *
+ * 插件可以在 JSON 元数据中声明激活条件，loadAllPlugins() 只登记这些条件，
+ * 不加载共享库，直到首次需要时才加载并初始化：
+ * @code
+ * "activation": {
+ *     "topics": ["adsb/#"],           // MessageBus 主题（可用通配），触发消息转交 onMessageFromHost
+ *     "fileExtensions": ["igc"],      // 首次由 MapParserFactory 打开该扩展名的文件
+ *     "pages": ["MapPage"]            // 打开对应的 QML 页面（按文件名匹配）
+ * }
+ * @endcode
+ * 没有 "activation" 的插件仍在 loadAllPlugins() 中立即加载。
+ * 访问插件对象、QML 入口或设置页时也会按需激活。
  */
 class PluginManager : public QObject
 {
@@ -34,24 +47,33 @@ public:
     void addPluginPath(const QString& path);
     QStringList pluginPaths() const { return m_pluginPaths; }
 
-    // 插件管理
+    // 插件管理：扫描只读取元数据，未变化的插件文件直接使用持久缓存
     void scanPlugins();
     bool loadPlugin(const QString& pluginId);
     bool unloadPlugin(const QString& pluginId);
+    // 立即加载未声明激活条件的插件，其余只登记激活条件
     void loadAllPlugins();
+    // 满足激活条件时调用；已加载时直接返回 true
+    bool activatePlugin(const QString& pluginId, const QString& reason);
+    bool isActivationPending(const QString& pluginId) const { return m_activationGuards.contains(pluginId); }
 
     // 查询
     IPlugin* plugin(const QString& pluginId) const;
+    // 扫描得到的插件 JSON 元数据，插件无需加载
+    QJsonObject pluginMetaData(const QString& pluginId) const;
     QList<IPlugin*> plugins() const { return m_plugins.values(); }
     QList<IPlugin*> pluginsByType(IPlugin::PluginType type) const;
     int pluginCount() const { return m_plugins.count(); }
 
     // QML 访问
     QList<QObject*> pluginObjects() const;
-    Q_INVOKABLE QObject* getPlugin(const QString& pluginId) const;
-    Q_INVOKABLE QUrl getPluginQmlEntry(const QString& pluginId) const;
-    Q_INVOKABLE QUrl getPluginSettingsPage(const QString& pluginId) const;
+    // 以下三个方法会按需激活尚未加载的插件
+    Q_INVOKABLE QObject* getPlugin(const QString& pluginId);
+    Q_INVOKABLE QUrl getPluginQmlEntry(const QString& pluginId);
+    Q_INVOKABLE QUrl getPluginSettingsPage(const QString& pluginId);
     Q_INVOKABLE bool isPluginLoaded(const QString& pluginId) const;
+    // 页面即将打开时由 QML 调用，激活声明了该页面的插件
+    Q_INVOKABLE void activateForPage(const QString& page);
 
 signals:
     void pluginsChanged();
@@ -65,11 +87,20 @@ private:
 
     void createPluginContext();
     bool loadPluginFromPath(const QString& filePath);
+    static QJsonObject readMetaData(const QString& filePath);
+    void registerActivationTriggers(const QString& pluginId, const QJsonObject& activation);
+    void clearActivationTriggers(const QString& pluginId);
 
     static PluginManager* s_instance;
     QStringList m_pluginPaths;
     QHash<QString, IPlugin*> m_plugins;
     QHash<QString, QString> m_pluginFiles;  // pluginId -> filePath
+    QHash<QString, QJsonObject> m_pluginMetaData;   // pluginId -> MetaData
+    PluginMetadataCache m_metadataCache;
+
+    // 延迟激活
+    QHash<QString, QObject*> m_activationGuards;        // pluginId -> 主题订阅的上下文对象
+    QMultiHash<QString, QString> m_pageTriggers;        // 页面名 -> pluginId
     PluginContext* m_context = nullptr;
 };
 
@@ -0,0 +1,131 @@
+#include "PluginMetadataCache.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace YEFS {
+
+namespace {
+
+const QString kVersion = QStringLiteral("version");
+const QString kAppVersion = QStringLiteral("appVersion");
+const QString kEntries = QStringLiteral("entries");
+const QString kSize = QStringLiteral("size");
+const QString kModified = QStringLiteral("modified");
+const QString kMetaData = QStringLiteral("metaData");
+
+qint64 modifiedTime(const QFileInfo& file)
+{
+    return file.lastModified().toMSecsSinceEpoch();
+}
+
+} // namespace
+
+QString PluginMetadataCache::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/plugins.json");
+}
+
+void PluginMetadataCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value(kVersion).toInt() != Version
+        || root.value(kAppVersion).toString() != QCoreApplication::applicationVersion()) {
+        qDebug() << "[PluginMetadataCache] Cache version mismatch, discarding";
+        m_dirty = true;
+        return;
+    }
+
+    const QJsonObject entries = root.value(kEntries).toObject();
+    m_entries.reserve(entries.size());
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        const QJsonObject value = it.value().toObject();
+        Entry entry;
+        entry.size = value.value(kSize).toInteger();
+        entry.modified = value.value(kModified).toInteger();
+        entry.metaData = value.value(kMetaData).toObject();
+        m_entries.insert(it.key(), entry);
+    }
+}
+
+bool PluginMetadataCache::save()
+{
+    if (!m_dirty) {
+        return true;
+    }
+
+    QJsonObject entries;
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        entries.insert(it.key(), QJsonObject{
+            { kSize, it->size },
+            { kModified, it->modified },
+            { kMetaData, it->metaData }
+        });
+    }
+    const QJsonObject root{
+        { kVersion, Version },
+        { kAppVersion, QCoreApplication::applicationVersion() },
+        { kEntries, entries }
+    };
+
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[PluginMetadataCache] Cannot write cache:" << path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning() << "[PluginMetadataCache] Cannot write cache:" << path << file.errorString();
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+bool PluginMetadataCache::lookup(const QFileInfo& file, QJsonObject& metaData) const
+{
+    const auto it = m_entries.constFind(file.absoluteFilePath());
+    if (it == m_entries.cend() || it->size != file.size() || it->modified != modifiedTime(file)) {
+        return false;
+    }
+    metaData = it->metaData;
+    return true;
+}
+
+void PluginMetadataCache::insert(const QFileInfo& file, const QJsonObject& metaData)
+{
+    Entry entry;
+    entry.size = file.size();
+    entry.modified = modifiedTime(file);
+    entry.metaData = metaData;
+    m_entries.insert(file.absoluteFilePath(), entry);
+    m_dirty = true;
+}
+
+void PluginMetadataCache::retain(const QSet<QString>& filePaths)
+{
+    const qsizetype removed = m_entries.removeIf([&filePaths](const std::pair<const QString&, Entry&>& entry) {
+        return !filePaths.contains(entry.first);
+    });
+    if (removed > 0) {
+        m_dirty = true;
+    }
+}
+
+} // namespace YEFS
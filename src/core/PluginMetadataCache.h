@@ -0,0 +1,52 @@
+#ifndef YEFS_PLUGINMETADATACACHE_H
+#define YEFS_PLUGINMETADATACACHE_H
+
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonObject>
+#include <QSet>
+#include <QString>
+
+namespace YEFS {
+
+/**
+ * @brief 插件元数据的持久缓存
+ *
+ * 以插件文件的绝对路径、大小和修改时间作为键，保存 QPluginLoader 读出的 "MetaData" 对象，
+ * 扫描时文件未变化的插件不再打开。不是 YEFS 插件的共享库记录为空对象，同样不再重复读取。
+ * 缓存文件带版本号和应用版本，任一不符时整体作废。只在主线程使用。
+ */
+class PluginMetadataCache
+{
+public:
+    static constexpr int Version = 1;
+
+    static QString cachePath();
+
+    void load();
+    bool save();
+
+    // 命中时填充 metaData 并返回 true；metaData 为空表示不是 YEFS 插件
+    bool lookup(const QFileInfo& file, QJsonObject& metaData) const;
+    void insert(const QFileInfo& file, const QJsonObject& metaData);
+    // 删除不在 filePaths 中的条目（插件已被移除）
+    void retain(const QSet<QString>& filePaths);
+
+    bool isDirty() const { return m_dirty; }
+    qsizetype size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 modified = 0;
+        QJsonObject metaData;
+    };
+
+    QHash<QString, Entry> m_entries;    // 绝对路径 -> 条目
+    bool m_loaded = false;
+    bool m_dirty = false;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_PLUGINMETADATACACHE_H
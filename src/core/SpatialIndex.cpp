@@ -0,0 +1,403 @@
+#include "SpatialIndex.h"
+#include "FeatureStore.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace YEFS {
+
+namespace {
+
+constexpr double kMetersPerDegree = 6371008.8 * M_PI / 180.0;
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+// 16 位网格坐标的 Hilbert 曲线下标
+quint32 hilbert(quint32 x, quint32 y)
+{
+    quint32 a = x ^ y;
+    quint32 b = 0xFFFF ^ a;
+    quint32 c = 0xFFFF ^ (x | y);
+    quint32 d = x & (y ^ 0xFFFF);
+
+    quint32 A = a | (b >> 1);
+    quint32 B = (a >> 1) ^ a;
+    quint32 C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+    quint32 D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+    a = A; b = B; c = C; d = D;
+    A = (a & (a >> 2)) ^ (b & (b >> 2));
+    B = (a & (b >> 2)) ^ (b & ((a ^ b) >> 2));
+    C ^= (a & (c >> 2)) ^ (b & (d >> 2));
+    D ^= (b & (c >> 2)) ^ ((a ^ b) & (d >> 2));
+
+    a = A; b = B; c = C; d = D;
+    A = (a & (a >> 4)) ^ (b & (b >> 4));
+    B = (a & (b >> 4)) ^ (b & ((a ^ b) >> 4));
+    C ^= (a & (c >> 4)) ^ (b & (d >> 4));
+    D ^= (b & (c >> 4)) ^ ((a ^ b) & (d >> 4));
+
+    a = A; b = B; c = C; d = D;
+    C ^= (a & (c >> 8)) ^ (b & (d >> 8));
+    D ^= (b & (c >> 8)) ^ ((a ^ b) & (d >> 8));
+
+    a = C ^ (C >> 1);
+    b = D ^ (D >> 1);
+
+    quint32 i0 = x ^ y;
+    quint32 i1 = b | (0xFFFF ^ (i0 | a));
+
+    i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+    i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+    i0 = (i0 | (i0 << 2)) & 0x33333333;
+    i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+    i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+    i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+    i1 = (i1 | (i1 << 2)) & 0x33333333;
+    i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+    return (i1 << 1) | i0;
+}
+
+// 原点到线段 (ax, ay)-(bx, by) 的距离
+double segmentDistance(double ax, double ay, double bx, double by)
+{
+    const double dx = bx - ax;
+    const double dy = by - ay;
+    const double lengthSquared = dx * dx + dy * dy;
+    double t = 0.0;
+    if (lengthSquared > 0.0) {
+        t = qBound(0.0, -(ax * dx + ay * dy) / lengthSquared, 1.0);
+    }
+    return std::hypot(ax + t * dx, ay + t * dy);
+}
+
+} // namespace
+
+// ============================================================================
+// 构建
+// ============================================================================
+
+void SpatialIndex::build(const FeatureStore& store)
+{
+    clear();
+
+    const int n = store.featureCount();
+    if (n == 0) {
+        return;
+    }
+
+    // 各层节点数：叶子层之上每 NodeSize 个节点合并为一个父节点，直到只剩根节点
+    int count = n;
+    int total = n;
+    m_levelBounds.append(total);
+    do {
+        count = (count + NodeSize - 1) / NodeSize;
+        total += count;
+        m_levelBounds.append(total);
+    } while (count > 1);
+
+    m_itemCount = n;
+    m_boxes.resize(qsizetype(total) * 4);
+    m_indices.resize(total);
+
+    // 要素外包矩形，空几何使用反向矩形，永远不会命中
+    const double* lon = store.longitudes();
+    const double* lat = store.latitudes();
+    QList<double> itemBoxes(qsizetype(n) * 4);
+    double minX = kInfinity, minY = kInfinity, maxX = -kInfinity, maxY = -kInfinity;
+
+    for (int f = 0; f < n; ++f) {
+        double* box = itemBoxes.data() + qsizetype(f) * 4;
+        box[0] = kInfinity;
+        box[1] = kInfinity;
+        box[2] = -kInfinity;
+        box[3] = -kInfinity;
+        for (int i = store.featureCoordBegin(f), end = store.featureCoordEnd(f); i < end; ++i) {
+            box[0] = qMin(box[0], lon[i]);
+            box[1] = qMin(box[1], lat[i]);
+            box[2] = qMax(box[2], lon[i]);
+            box[3] = qMax(box[3], lat[i]);
+        }
+        if (box[0] <= box[2]) {
+            minX = qMin(minX, box[0]);
+            minY = qMin(minY, box[1]);
+            maxX = qMax(maxX, box[2]);
+            maxY = qMax(maxY, box[3]);
+        }
+    }
+
+    // 按中心点的 Hilbert 值排序叶子
+    const double width = maxX > minX ? maxX - minX : 1.0;
+    const double height = maxY > minY ? maxY - minY : 1.0;
+    std::vector<std::pair<quint32, quint32>> order(n);
+    for (int f = 0; f < n; ++f) {
+        const double* box = itemBoxes.constData() + qsizetype(f) * 4;
+        quint32 value = 0;
+        if (box[0] <= box[2]) {
+            const double cx = (box[0] + box[2]) / 2.0;
+            const double cy = (box[1] + box[3]) / 2.0;
+            value = hilbert(quint32(0xFFFF * (cx - minX) / width),
+                            quint32(0xFFFF * (cy - minY) / height));
+        }
+        order[f] = {value, quint32(f)};
+    }
+    std::sort(order.begin(), order.end());
+
+    double* boxes = m_boxes.data();
+    for (int pos = 0; pos < n; ++pos) {
+        const quint32 f = order[pos].second;
+        std::copy_n(itemBoxes.constData() + qsizetype(f) * 4, 4, boxes + qsizetype(pos) * 4);
+        m_indices[pos] = f;
+    }
+
+    // 自底向上生成父节点
+    for (int level = 0; level + 1 < m_levelBounds.size(); ++level) {
+        const int childBegin = level == 0 ? 0 : m_levelBounds.at(level - 1);
+        const int childEnd = m_levelBounds.at(level);
+        int out = childEnd;
+
+        for (int i = childBegin; i < childEnd; i += NodeSize) {
+            double* node = boxes + qsizetype(out) * 4;
+            node[0] = kInfinity;
+            node[1] = kInfinity;
+            node[2] = -kInfinity;
+            node[3] = -kInfinity;
+            for (int c = i, end = qMin(i + NodeSize, childEnd); c < end; ++c) {
+                const double* child = boxes + qsizetype(c) * 4;
+                node[0] = qMin(node[0], child[0]);
+                node[1] = qMin(node[1], child[1]);
+                node[2] = qMax(node[2], child[2]);
+                node[3] = qMax(node[3], child[3]);
+            }
+            m_indices[out] = quint32(i);
+            ++out;
+        }
+    }
+}
+
+void SpatialIndex::clear()
+{
+    m_itemCount = 0;
+    m_boxes.clear();
+    m_indices.clear();
+    m_levelBounds.clear();
+}
+
+int SpatialIndex::levelEnd(int position) const
+{
+    return *std::upper_bound(m_levelBounds.cbegin(), m_levelBounds.cend(), position);
+}
+
+double SpatialIndex::boxDistance(int position, double lon, double lat, double lonScale) const
+{
+    const double* box = m_boxes.constData() + qsizetype(position) * 4;
+    const double dx = lon < box[0] ? box[0] - lon : (lon > box[2] ? lon - box[2] : 0.0);
+    const double dy = lat < box[1] ? box[1] - lat : (lat > box[3] ? lat - box[3] : 0.0);
+    return std::hypot(dx * lonScale, dy) * kMetersPerDegree;
+}
+
+// ============================================================================
+// 查询
+// ============================================================================
+
+QList<int> SpatialIndex::search(double minLon, double minLat, double maxLon, double maxLat) const
+{
+    QList<int> result;
+    if (m_itemCount == 0) {
+        return result;
+    }
+
+    QList<int> queue;
+    int nodeIndex = m_indices.size() - 1;   // 根节点
+
+    while (true) {
+        const int end = qMin(nodeIndex + NodeSize, levelEnd(nodeIndex));
+        for (int pos = nodeIndex; pos < end; ++pos) {
+            const double* box = m_boxes.constData() + qsizetype(pos) * 4;
+            if (maxLon < box[0] || maxLat < box[1] || minLon > box[2] || minLat > box[3]) {
+                continue;
+            }
+            if (pos < m_itemCount) {
+                result.append(int(m_indices.at(pos)));
+            } else {
+                queue.append(int(m_indices.at(pos)));
+            }
+        }
+
+        if (queue.isEmpty()) {
+            break;
+        }
+        nodeIndex = queue.takeLast();
+    }
+
+    return result;
+}
+
+QList<int> SpatialIndex::search(const QGeoRectangle& rect) const
+{
+    if (!rect.isValid()) {
+        return QList<int>();
+    }
+    return search(rect.topLeft().longitude(), rect.bottomRight().latitude(),
+                  rect.bottomRight().longitude(), rect.topLeft().latitude());
+}
+
+QList<SpatialIndex::Neighbor> SpatialIndex::withinRadius(const FeatureStore& store,
+                                                         const QGeoCoordinate& center,
+                                                         double radiusMeters) const
+{
+    QList<Neighbor> result;
+    if (m_itemCount == 0 || !center.isValid() || radiusMeters < 0.0) {
+        return result;
+    }
+
+    // 先用经纬度范围粗筛，再计算到几何的精确距离
+    const double lonScale = qCos(qDegreesToRadians(center.latitude()));
+    const double dLat = radiusMeters / kMetersPerDegree;
+    const double dLon = lonScale > 1e-9 ? dLat / lonScale : 360.0;
+
+    const QList<int> candidates = search(center.longitude() - dLon, center.latitude() - dLat,
+                                         center.longitude() + dLon, center.latitude() + dLat);
+    for (int feature : candidates) {
+        const double distance = distanceToFeature(store, feature, center);
+        if (distance <= radiusMeters) {
+            result.append({feature, distance});
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Neighbor& a, const Neighbor& b) {
+        return a.distance < b.distance;
+    });
+    return result;
+}
+
+QList<SpatialIndex::Neighbor> SpatialIndex::nearest(const FeatureStore& store,
+                                                    const QGeoCoordinate& center, int count,
+                                                    double maxDistanceMeters) const
+{
+    QList<Neighbor> result;
+    if (m_itemCount == 0 || !center.isValid() || count <= 0) {
+        return result;
+    }
+
+    // 最佳优先遍历：外包矩形距离是几何距离的下界，候选要素出队时再换成精确距离重新入队
+    enum Kind : quint8 { Node, Candidate, Feature };
+    struct Entry {
+        double distance;
+        int id;         // Node 为首个子节点位置，其余为要素下标
+        Kind kind;
+        bool operator>(const Entry& other) const { return distance > other.distance; }
+    };
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+    const double lon = center.longitude();
+    const double lat = center.latitude();
+    const double lonScale = qCos(qDegreesToRadians(lat));
+    int nodeIndex = m_indices.size() - 1;
+
+    while (nodeIndex >= 0) {
+        const int end = qMin(nodeIndex + NodeSize, levelEnd(nodeIndex));
+        for (int pos = nodeIndex; pos < end; ++pos) {
+            // 空几何的外包矩形是倒置的，距离为无穷大，默认的无穷远上限也不能放行
+            const double* box = m_boxes.constData() + qsizetype(pos) * 4;
+            if (box[0] > box[2] || box[1] > box[3]) {
+                continue;
+            }
+            const double distance = boxDistance(pos, lon, lat, lonScale);
+            if (std::isfinite(distance) && distance <= maxDistanceMeters) {
+                queue.push({distance, int(m_indices.at(pos)), pos < m_itemCount ? Candidate : Node});
+            }
+        }
+
+        nodeIndex = -1;
+        while (!queue.empty()) {
+            const Entry entry = queue.top();
+            queue.pop();
+
+            if (entry.kind == Node) {
+                nodeIndex = entry.id;
+                break;
+            }
+            if (entry.kind == Candidate) {
+                const double distance = distanceToFeature(store, entry.id, center);
+                if (std::isfinite(distance) && distance <= maxDistanceMeters) {
+                    queue.push({distance, entry.id, Feature});
+                }
+                continue;
+            }
+
+            result.append({entry.id, entry.distance});
+            if (result.size() >= count) {
+                return result;
+            }
+        }
+    }
+
+    return result;
+}
+
+double SpatialIndex::distanceToFeature(const FeatureStore& store, int feature,
+                                       const QGeoCoordinate& point)
+{
+    // 以查询点为原点的局部平面坐标（度，经度按纬度缩放）
+    const double originLon = point.longitude();
+    const double originLat = point.latitude();
+    const double lonScale = qCos(qDegreesToRadians(originLat));
+    const double* lon = store.longitudes();
+    const double* lat = store.latitudes();
+    auto x = [&](int i) { return (lon[i] - originLon) * lonScale; };
+    auto y = [&](int i) { return lat[i] - originLat; };
+
+    double best = kInfinity;
+
+    // GeometryCollection 的成员类型可能不同，按组判断
+    for (int g = store.groupBegin(feature); g < store.groupEnd(feature); ++g) {
+        const GeometryType type = store.groupType(feature, g);
+        if (type == GeometryType::Point || type == GeometryType::MultiPoint) {
+            for (int i = store.coordBegin(store.partBegin(g)), end = store.coordBegin(store.partEnd(g)); i < end; ++i) {
+                best = qMin(best, std::hypot(x(i), y(i)));
+            }
+            continue;
+        }
+
+        const bool polygon = type == GeometryType::Polygon || type == GeometryType::MultiPolygon;
+        bool inside = false;
+
+        for (int p = store.partBegin(g); p < store.partEnd(g); ++p) {
+            const int begin = store.coordBegin(p);
+            const int end = store.coordEnd(p);
+            if (end - begin == 1) {
+                best = qMin(best, std::hypot(x(begin), y(begin)));
+                continue;
+            }
+
+            for (int i = begin + 1; i < end; ++i) {
+                best = qMin(best, segmentDistance(x(i - 1), y(i - 1), x(i), y(i)));
+            }
+
+            // 射线法判断原点是否在多边形内（奇偶规则，内环自然抵消）
+            if (polygon) {
+                for (int i = begin, j = end - 1; i < end; j = i++) {
+                    const double yi = y(i), yj = y(j);
+                    if ((yi > 0.0) != (yj > 0.0)) {
+                        const double xi = x(i), xj = x(j);
+                        if (xi + (0.0 - yi) * (xj - xi) / (yj - yi) > 0.0) {
+                            inside = !inside;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (inside) {
+            return 0.0;
+        }
+    }
+
+    return best * kMetersPerDegree;
+}
+
+} // namespace YEFS
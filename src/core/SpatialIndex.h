@@ -0,0 +1,66 @@
+#ifndef YEFS_SPATIALINDEX_H
+#define YEFS_SPATIALINDEX_H
+
+#include <QList>
+#include <QGeoCoordinate>
+#include <QGeoRectangle>
+#include <limits>
+
+namespace YEFS {
+
+class FeatureStore;
+
+/**
+ * @brief 打包 R 树空间索引
+ *
+ * 以 FeatureStore 中每个要素的外包矩形为叶子，按 Hilbert 曲线排序后自底向上批量构建，
+ * 所有节点保存在连续数组中，构建后只读，可在多个线程中同时查询。
+ * 距离按查询点处的等距圆柱投影近似计算（米），不处理跨越 180° 经线的要素。
+ */
+class SpatialIndex
+{
+public:
+    static constexpr int NodeSize = 16;
+
+    struct Neighbor {
+        int feature;
+        double distance;    // 米
+    };
+
+    void build(const FeatureStore& store);
+    void clear();
+
+    int size() const { return m_itemCount; }
+    bool isEmpty() const { return m_itemCount == 0; }
+
+    // 外包矩形与查询范围相交的要素
+    QList<int> search(double minLon, double minLat, double maxLon, double maxLat) const;
+    QList<int> search(const QGeoRectangle& rect) const;
+
+    // 与 center 的距离不超过 radius 的要素，按距离升序；点在多边形内时距离为 0
+    QList<Neighbor> withinRadius(const FeatureStore& store, const QGeoCoordinate& center,
+                                 double radiusMeters) const;
+
+    // 距离 center 最近的 count 个要素，按距离升序
+    QList<Neighbor> nearest(const FeatureStore& store, const QGeoCoordinate& center, int count,
+                            double maxDistanceMeters = std::numeric_limits<double>::infinity()) const;
+
+    // 点到要素几何的距离（米）
+    static double distanceToFeature(const FeatureStore& store, int feature,
+                                    const QGeoCoordinate& point);
+
+private:
+    friend class FeatureCache;
+
+    int levelEnd(int position) const;
+    double boxDistance(int position, double lon, double lat, double lonScale) const;
+
+    int m_itemCount = 0;
+    QList<double> m_boxes;          // 每个节点 minLon, minLat, maxLon, maxLat
+    QList<quint32> m_indices;       // 叶子：要素下标；内部节点：首个子节点位置
+    QList<int> m_levelBounds;       // 每层结束位置（不含）
+};
+
+} // namespace YEFS
+
+#endif // YEFS_SPATIALINDEX_H
@@ -1,227 +1,31 @@
 #include "GPXParser.h"
+#include "../MappedFile.h"
+#include <QBuffer>
 #include <QFile>
 #include <QFileInfo>
-#include <QJsonArray>
+#include <QDateTime>
 #include <QDebug>
-#include <QUuid>
-#include <QtMath>
 
 namespace YEFS {
 
-// ============================================================================
-// GPX 数据结构实现
-// ============================================================================
-
-QJsonObject GPXTrackPoint::toJson() const
-{
-    QJsonObject obj;
-    obj["lat"] = coordinate.latitude();
-    obj["lon"] = coordinate.longitude();
-    if (elevation != 0.0) {
-        obj["ele"] = elevation;
-    }
-    if (time.isValid()) {
-        obj["time"] = time.toString(Qt::ISODate);
-    }
-    if (speed > 0.0) {
-        obj["speed"] = speed;
-    }
-    if (heartRate > 0.0) {
-        obj["hr"] = heartRate;
-    }
-    return obj;
-}
-
-QJsonObject GPXTrackSegment::toJson() const
-{
-    QJsonArray pointsArray;
-    for (const auto& point : points) {
-        pointsArray.append(point.toJson());
-    }
-    QJsonObject obj;
-    obj["points"] = pointsArray;
-    return obj;
-}
-
-QJsonObject GPXTrack::toJson() const
-{
-    QJsonObject obj;
-    obj["name"] = name;
-    obj["description"] = description;
-    
-    QJsonArray segmentsArray;
-    for (const auto& segment : segments) {
-        segmentsArray.append(segment.toJson());
-    }
-    obj["segments"] = segmentsArray;
-    return obj;
-}
-
-QJsonObject GPXWaypoint::toJson() const
-{
-    QJsonObject obj;
-    obj["lat"] = coordinate.latitude();
-    obj["lon"] = coordinate.longitude();
-    obj["name"] = name;
-    obj["description"] = description;
-    obj["symbol"] = symbol;
-    if (elevation != 0.0) {
-        obj["ele"] = elevation;
-    }
-    if (time.isValid()) {
-        obj["time"] = time.toString(Qt::ISODate);
-    }
-    return obj;
-}
-
 // ============================================================================
 // GPXSource 实现
 // ============================================================================
 
-GPXSource::GPXSource(const QString& id, const QString& name, QObject* parent)
+GPXSource::GPXSource(const QString& id, const QString& name,
+                     FeatureStore store, SpatialIndex index,
+                     QObject* parent)
     : IVectorMapSource(parent)
     , m_id(id)
     , m_name(name)
+    , m_store(std::move(store))
     , m_loaded(true)
 {
-}
-
-void GPXSource::addTrack(const GPXTrack& track)
-{
-    m_tracks.append(track);
-    updateBounds();
-}
-
-void GPXSource::addWaypoint(const GPXWaypoint& waypoint)
-{
-    m_waypoints.append(waypoint);
-    updateBounds();
-}
-
-void GPXSource::updateBounds()
-{
-    if (m_tracks.isEmpty() && m_waypoints.isEmpty()) {
-        return;
-    }
-
-    double minLat = 90.0, maxLat = -90.0;
-    double minLon = 180.0, maxLon = -180.0;
-
-    // 从轨迹中计算边界
-    for (const auto& track : m_tracks) {
-        for (const auto& segment : track.segments) {
-            for (const auto& point : segment.points) {
-                minLat = qMin(minLat, point.coordinate.latitude());
-                maxLat = qMax(maxLat, point.coordinate.latitude());
-                minLon = qMin(minLon, point.coordinate.longitude());
-                maxLon = qMax(maxLon, point.coordinate.longitude());
-            }
-        }
-    }
-
-    // 从航点中计算边界
-    for (const auto& waypoint : m_waypoints) {
-        minLat = qMin(minLat, waypoint.coordinate.latitude());
-        maxLat = qMax(maxLat, waypoint.coordinate.latitude());
-        minLon = qMin(minLon, waypoint.coordinate.longitude());
-        maxLon = qMax(maxLon, waypoint.coordinate.longitude());
+    // 高频记录的轨迹顶点很多，加载时预先计算抽稀重要度（缓存恢复的数据已带有）
+    if (!m_store.hasImportance()) {
+        m_store.computeImportance();
     }
-
-    m_bounds = QGeoRectangle(QGeoCoordinate(maxLat, minLon), 
-                             QGeoCoordinate(minLat, maxLon));
-}
-
-QJsonObject GPXSource::toGeoJSON() const
-{
-    QJsonObject geoJson;
-    geoJson["type"] = "FeatureCollection";
-
-    QJsonArray features;
-
-    // 转换轨迹为 LineString
-    for (const auto& track : m_tracks) {
-        for (const auto& segment : track.segments) {
-            QJsonObject feature;
-            feature["type"] = "Feature";
-
-            QJsonObject geometry;
-            geometry["type"] = "LineString";
-
-            QJsonArray coordinates;
-            for (const auto& point : segment.points) {
-                QJsonArray coord;
-                coord.append(point.coordinate.longitude());
-                coord.append(point.coordinate.latitude());
-                if (point.elevation != 0.0) {
-                    coord.append(point.elevation);
-                }
-                coordinates.append(coord);
-            }
-            geometry["coordinates"] = coordinates;
-
-            feature["geometry"] = geometry;
-
-            QJsonObject properties;
-            properties["name"] = track.name;
-            properties["description"] = track.description;
-            feature["properties"] = properties;
-
-            features.append(feature);
-        }
-    }
-
-    // 转换航点为 Point
-    for (const auto& waypoint : m_waypoints) {
-        QJsonObject feature;
-        feature["type"] = "Feature";
-
-        QJsonObject geometry;
-        geometry["type"] = "Point";
-
-        QJsonArray coordinate;
-        coordinate.append(waypoint.coordinate.longitude());
-        coordinate.append(waypoint.coordinate.latitude());
-        if (waypoint.elevation != 0.0) {
-            coordinate.append(waypoint.elevation);
-        }
-        geometry["coordinates"] = coordinate;
-
-        feature["geometry"] = geometry;
-
-        QJsonObject properties;
-        properties["name"] = waypoint.name;
-        properties["description"] = waypoint.description;
-        properties["symbol"] = waypoint.symbol;
-        feature["properties"] = properties;
-
-        features.append(feature);
-    }
-
-    geoJson["features"] = features;
-    return geoJson;
-}
-
-QVariantMap GPXSource::toMapLibreLayer() const
-{
-    QVariantMap layer;
-    layer["id"] = m_id;
-    layer["type"] = "geojson";
-    layer["source"] = QVariant::fromValue(toGeoJSON().toVariantMap());
-    return layer;
-}
-
-QJsonObject GPXSource::features() const
-{
-    return toGeoJSON();
-}
-
-int GPXSource::featureCount() const
-{
-    int count = m_waypoints.count();
-    for (const auto& track : m_tracks) {
-        count += track.segments.count();
-    }
-    return count;
+    buildSpatialIndex(std::move(index));
 }
 
 QVariantMap GPXSource::defaultStyle() const
@@ -279,6 +83,13 @@ bool GPXParser::canParse(QIODevice* device) const
 
 IMapSource* GPXParser::parse(const QString& filePath)
 {
+    QFileInfo fileInfo(filePath);
+
+    MappedFile mapped(filePath);
+    if (mapped.isMapped()) {
+        return parseData(mapped.data(), fileInfo.fileName());
+    }
+
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "[GPXParser] Cannot open file:" << filePath;
@@ -286,7 +97,6 @@ IMapSource* GPXParser::parse(const QString& filePath)
         return nullptr;
     }
 
-    QFileInfo fileInfo(filePath);
     return parse(&file, fileInfo.fileName());
 }
 
@@ -301,141 +111,204 @@ IMapSource* GPXParser::parse(QIODevice* device, const QString& sourceName)
     device->seek(0);
     QXmlStreamReader xml(device);
 
-    return parseGPX(xml, sourceName);
+    return parseGPX(xml, sourceName, nullptr, device->size());
 }
 
-GPXSource* GPXParser::parseGPX(QXmlStreamReader& xml, const QString& sourceName)
+IMapSource* GPXParser::parseData(QByteArrayView data, const QString& sourceName,
+                                 ParseControl* control)
+{
+    // 整段 QByteArray 交给 QXmlStreamReader 时首次读取就会解码成完整的 UTF-16 文本，
+    // 经 QBuffer 按设备读取则按块解码；QBuffer 包装映射内存本身，不复制文件内容
+    QBuffer buffer;
+    buffer.setData(QByteArray::fromRawData(data.data(), data.size()));
+    buffer.open(QIODevice::ReadOnly);
+    QXmlStreamReader xml(&buffer);
+    return parseGPX(xml, sourceName, control, data.size());
+}
+
+IMapSource* GPXParser::createSource(const QString& sourceName, FeatureStore store,
+                                    SpatialIndex index)
+{
+    return IVectorMapSource::create<GPXSource>(sourceName, std::move(store), std::move(index));
+}
+
+GPXSource* GPXParser::parseGPX(QXmlStreamReader& xml, const QString& sourceName,
+                             ParseControl* control, qint64 totalBytes)
 {
-    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
     QString name = sourceName.isEmpty() ? QStringLiteral("GPX") : sourceName;
 
-    auto source = new GPXSource(id, name);
+    FeatureStore store;
+    int trackCount = 0;
+    int waypointCount = 0;
 
     while (!xml.atEnd() && !xml.hasError()) {
         xml.readNext();
 
         if (xml.isStartElement()) {
+            if (control && !control->checkpoint(xml.characterOffset(), totalBytes)) {
+                break;
+            }
+
             if (xml.name() == QStringLiteral("trk")) {
-                source->addTrack(parseTrack(xml));
+                parseTrack(xml, store, control);
+                ++trackCount;
             }
             else if (xml.name() == QStringLiteral("wpt")) {
-                source->addWaypoint(parseWaypoint(xml));
+                parseWaypoint(xml, store);
+                ++waypointCount;
             }
         }
     }
 
+    // 取消时 store 随栈释放，不会产生半成品数据源
+    if (control && control->isCanceled()) {
+        qDebug() << "[GPXParser] Parse canceled:" << name;
+        return nullptr;
+    }
+
     if (xml.hasError()) {
         qWarning() << "[GPXParser] XML parse error:" << xml.errorString();
-        emit parseError(QStringLiteral("XML 解析错误: ") + xml.errorString());
-        delete source;
+        reportError(control, QStringLiteral("XML 解析错误: ") + xml.errorString());
         return nullptr;
     }
 
+    store.squeeze();
+    auto source = IVectorMapSource::create<GPXSource>(name, std::move(store));
+
     qDebug() << "[GPXParser] Parsed GPX:" << name 
-             << "tracks:" << source->tracks().count()
-             << "waypoints:" << source->waypoints().count();
+             << "tracks:" << trackCount
+             << "waypoints:" << waypointCount;
 
     return source;
 }
 
-GPXTrack GPXParser::parseTrack(QXmlStreamReader& xml)
+void GPXParser::parseTrack(QXmlStreamReader& xml, FeatureStore& store, ParseControl* control)
 {
-    GPXTrack track;
+    QString name;
+    QString description;
+    QList<FeatureGeometry> segments;
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("trk"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("trk"))) {
         xml.readNext();
 
         if (xml.isStartElement()) {
             if (xml.name() == QStringLiteral("name")) {
-                track.name = xml.readElementText();
+                name = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("desc")) {
-                track.description = xml.readElementText();
+                description = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("trkseg")) {
-                track.segments.append(parseTrackSegment(xml));
+                FeatureGeometry segment;
+                segment.type = GeometryType::LineString;
+                if (!parseTrackSegment(xml, segment, control)) {
+                    return;
+                }
+                // 空段或单点段构不成有效的 LineString，跳过
+                if (segment.coordinateCount() < 2) {
+                    qDebug() << "[GPXParser] Skipping track segment with" << segment.coordinateCount() << "points";
+                    continue;
+                }
+                segments.append(segment);
             }
         }
     }
 
-    return track;
+    // 每个轨迹段作为一个 LineString 要素
+    const QVariantMap properties{
+        {QStringLiteral("name"), name},
+        {QStringLiteral("description"), description}
+    };
+    for (const FeatureGeometry& segment : segments) {
+        store.append(segment, properties);
+    }
 }
 
-GPXTrackSegment GPXParser::parseTrackSegment(QXmlStreamReader& xml)
+bool GPXParser::parseTrackSegment(QXmlStreamReader& xml, FeatureGeometry& geometry,
+                                  ParseControl* control)
 {
-    GPXTrackSegment segment;
-
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("trkseg"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("trkseg"))) {
         xml.readNext();
 
         if (xml.isStartElement() && xml.name() == QStringLiteral("trkpt")) {
-            segment.points.append(parseTrackPoint(xml));
+            parseTrackPoint(xml, geometry);
+
+            // 长轨迹段内也定期检查取消
+            if (control && geometry.coordinateCount() % 1024 == 0
+                && !control->checkpoint(xml.characterOffset(), control->bytesTotal())) {
+                return false;
+            }
         }
     }
-
-    return segment;
+    return true;
 }
 
-GPXTrackPoint GPXParser::parseTrackPoint(QXmlStreamReader& xml)
+void GPXParser::parseTrackPoint(QXmlStreamReader& xml, FeatureGeometry& geometry)
 {
-    GPXTrackPoint point;
-    point.coordinate = parseCoordinate(xml);
+    parseCoordinate(xml, geometry);
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("trkpt"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("trkpt"))) {
         xml.readNext();
 
         if (xml.isStartElement()) {
             if (xml.name() == QStringLiteral("ele")) {
-                point.elevation = xml.readElementText().toDouble();
+                geometry.setLastAltitude(xml.readElementText().toDouble());
             }
             else if (xml.name() == QStringLiteral("time")) {
-                point.time = QDateTime::fromString(xml.readElementText(), Qt::ISODate);
-            }
-            else if (xml.name() == QStringLiteral("speed")) {
-                point.speed = xml.readElementText().toDouble();
+                geometry.setLastTimestamp(parseTime(xml.readElementText()));
             }
         }
     }
-
-    return point;
 }
 
-GPXWaypoint GPXParser::parseWaypoint(QXmlStreamReader& xml)
+void GPXParser::parseWaypoint(QXmlStreamReader& xml, FeatureStore& store)
 {
-    GPXWaypoint waypoint;
-    waypoint.coordinate = parseCoordinate(xml);
+    FeatureGeometry geometry;
+    geometry.type = GeometryType::Point;
+    parseCoordinate(xml, geometry);
+
+    QVariantMap properties;
+    properties["name"] = QString();
+    properties["description"] = QString();
+    properties["symbol"] = QString();
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("wpt"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("wpt"))) {
         xml.readNext();
 
         if (xml.isStartElement()) {
             if (xml.name() == QStringLiteral("name")) {
-                waypoint.name = xml.readElementText();
+                properties["name"] = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("desc")) {
-                waypoint.description = xml.readElementText();
+                properties["description"] = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("sym")) {
-                waypoint.symbol = xml.readElementText();
+                properties["symbol"] = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("ele")) {
-                waypoint.elevation = xml.readElementText().toDouble();
+                geometry.setLastAltitude(xml.readElementText().toDouble());
             }
             else if (xml.name() == QStringLiteral("time")) {
-                waypoint.time = QDateTime::fromString(xml.readElementText(), Qt::ISODate);
+                geometry.setLastTimestamp(parseTime(xml.readElementText()));
             }
         }
     }
 
-    return waypoint;
+    store.append(geometry, properties);
 }
 
-QGeoCoordinate GPXParser::parseCoordinate(QXmlStreamReader& xml)
+void GPXParser::parseCoordinate(QXmlStreamReader& xml, FeatureGeometry& geometry)
 {
     QXmlStreamAttributes attrs = xml.attributes();
     double lat = attrs.value("lat").toDouble();
     double lon = attrs.value("lon").toDouble();
-    return QGeoCoordinate(lat, lon);
+    geometry.addCoordinate(lon, lat);
+}
+
+qint64 GPXParser::parseTime(const QString& text)
+{
+    QDateTime time = QDateTime::fromString(text, Qt::ISODate);
+    return time.isValid() ? time.toMSecsSinceEpoch() : FeatureGeometry::NoTimestamp;
 }
 
 } // namespace YEFS
@@ -4,68 +4,24 @@
 #include "../IMapParser.h"
 #include "../IMapSource.h"
 #include <QXmlStreamReader>
-#include <QJsonObject>
-#include <QGeoCoordinate>
-#include <QDateTime>
 
 namespace YEFS {
 
-/**
- * @brief GPX 轨迹点
- */
-struct GPXTrackPoint {
-    QGeoCoordinate coordinate;
-    QDateTime time;
-    double elevation = 0.0;
-    double speed = 0.0;
-    double heartRate = 0.0;
-    
-    QJsonObject toJson() const;
-};
-
-/**
- * @brief GPX 轨迹段
- */
-struct GPXTrackSegment {
-    QList<GPXTrackPoint> points;
-    
-    QJsonObject toJson() const;
-};
-
-/**
- * @brief GPX 轨迹
- */
-struct GPXTrack {
-    QString name;
-    QString description;
-    QList<GPXTrackSegment> segments;
-    
-    QJsonObject toJson() const;
-};
-
-/**
- * @brief GPX 航点
- */
-struct GPXWaypoint {
-    QGeoCoordinate coordinate;
-    QString name;
-    QString description;
-    QString symbol;
-    double elevation = 0.0;
-    QDateTime time;
-    
-    QJsonObject toJson() const;
-};
-
 /**
  * @brief GPX 数据源
+ *
+ * 轨迹段保存为 LineString 要素，航点保存为 Point 要素，
+ * 点的时间保存在 FeatureStore 的时间列中。
+ * 加载时计算顶点抽稀重要度，MapLibreEngine::addVectorSourceLayer() 按缩放级别只发送需要的顶点
  */
 class GPXSource : public IVectorMapSource
 {
     Q_OBJECT
 
 public:
-    explicit GPXSource(const QString& id, const QString& name, QObject* parent = nullptr);
+    explicit GPXSource(const QString& id, const QString& name,
+                       FeatureStore store, SpatialIndex index = SpatialIndex(),
+                       QObject* parent = nullptr);
     ~GPXSource() override = default;
 
     // IMapSource 接口实现
@@ -73,32 +29,16 @@ public:
     QString name() const override { return m_name; }
     MapSourceType type() const override { return MapSourceType::Vector; }
     bool isLoaded() const override { return m_loaded; }
-    bool isValid() const override { return !m_tracks.isEmpty() || !m_waypoints.isEmpty(); }
-    QGeoRectangle bounds() const override { return m_bounds; }
-
-    // 数据访问
-    QJsonObject toGeoJSON() const override;
-    QVariantMap toMapLibreLayer() const override;
+    bool isValid() const override { return !m_store.isEmpty(); }
 
     // IVectorMapSource 接口实现
-    QJsonObject features() const override;
-    int featureCount() const override;
+    const FeatureStore& featureStore() const override { return m_store; }
     QVariantMap defaultStyle() const override;
 
-    // GPX 特有数据
-    void addTrack(const GPXTrack& track);
-    void addWaypoint(const GPXWaypoint& waypoint);
-    const QList<GPXTrack>& tracks() const { return m_tracks; }
-    const QList<GPXWaypoint>& waypoints() const { return m_waypoints; }
-
 private:
-    void updateBounds();
-
     QString m_id;
     QString m_name;
-    QList<GPXTrack> m_tracks;
-    QList<GPXWaypoint> m_waypoints;
-    QGeoRectangle m_bounds;
+    FeatureStore m_store;
     bool m_loaded = false;
 };
 
@@ -132,14 +72,20 @@ public:
 
     IMapSource* parse(const QString& filePath) override;
     IMapSource* parse(QIODevice* device, const QString& sourceName) override;
+    IMapSource* parseData(QByteArrayView data, const QString& sourceName,
+                          ParseControl* control = nullptr) override;
+    IMapSource* createSource(const QString& sourceName, FeatureStore store,
+                             SpatialIndex index) override;
 
 private:
-    GPXSource* parseGPX(QXmlStreamReader& xml, const QString& sourceName);
-    GPXTrack parseTrack(QXmlStreamReader& xml);
-    GPXTrackSegment parseTrackSegment(QXmlStreamReader& xml);
-    GPXTrackPoint parseTrackPoint(QXmlStreamReader& xml);
-    GPXWaypoint parseWaypoint(QXmlStreamReader& xml);
-    QGeoCoordinate parseCoordinate(QXmlStreamReader& xml);
+    GPXSource* parseGPX(QXmlStreamReader& xml, const QString& sourceName,
+                         ParseControl* control, qint64 totalBytes);
+    void parseTrack(QXmlStreamReader& xml, FeatureStore& store, ParseControl* control);
+    bool parseTrackSegment(QXmlStreamReader& xml, FeatureGeometry& geometry, ParseControl* control);
+    void parseTrackPoint(QXmlStreamReader& xml, FeatureGeometry& geometry);
+    void parseWaypoint(QXmlStreamReader& xml, FeatureStore& store);
+    void parseCoordinate(QXmlStreamReader& xml, FeatureGeometry& geometry);
+    static qint64 parseTime(const QString& text);
 };
 
 } // namespace YEFS
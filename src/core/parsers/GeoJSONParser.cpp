@@ -1,11 +1,8 @@
 #include "GeoJSONParser.h"
+#include "GeoJSONStreamReader.h"
+#include "../MappedFile.h"
 #include <QFile>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonValue>
 #include <QDebug>
-#include <QUuid>
-#include <functional>
 
 namespace YEFS {
 
@@ -14,101 +11,15 @@ namespace YEFS {
 // ============================================================================
 
 GeoJSONSource::GeoJSONSource(const QString& id, const QString& name, 
-                            const QJsonObject& geoJson, QObject* parent)
+                            FeatureStore store, SpatialIndex index,
+                            QObject* parent)
     : IVectorMapSource(parent)
     , m_id(id)
     , m_name(name)
-    , m_geoJson(geoJson)
+    , m_store(std::move(store))
     , m_loaded(true)
 {
-    calculateBounds();
-}
-
-void GeoJSONSource::calculateBounds()
-{
-    // 遍历 GeoJSON 计算实际边界
-    if (m_geoJson.isEmpty()) {
-        m_bounds = QGeoRectangle();
-        return;
-    }
-
-    double minLat = 90.0, maxLat = -90.0;
-    double minLon = 180.0, maxLon = -180.0;
-    bool hasCoords = false;
-
-    // 递归函数处理坐标
-    std::function<void(const QJsonValue&)> processCoordinates;
-    processCoordinates = [&](const QJsonValue& coords) {
-        if (coords.isArray()) {
-            QJsonArray arr = coords.toArray();
-            if (arr.isEmpty()) return;
-
-            // 检查是否是坐标点 [lon, lat] 或 [lon, lat, alt]
-            if (arr[0].isDouble()) {
-                if (arr.size() >= 2) {
-                    double lon = arr[0].toDouble();
-                    double lat = arr[1].toDouble();
-                    minLat = qMin(minLat, lat);
-                    maxLat = qMax(maxLat, lat);
-                    minLon = qMin(minLon, lon);
-                    maxLon = qMax(maxLon, lon);
-                    hasCoords = true;
-                }
-            } else {
-                // 递归处理嵌套数组
-                for (const auto& item : arr) {
-                    processCoordinates(item);
-                }
-            }
-        }
-    };
-
-    // 处理 Feature 或 FeatureCollection
-    QString type = m_geoJson["type"].toString();
-    if (type == "FeatureCollection") {
-        QJsonArray features = m_geoJson["features"].toArray();
-        for (const auto& feature : features) {
-            QJsonObject featureObj = feature.toObject();
-            QJsonObject geometry = featureObj["geometry"].toObject();
-            processCoordinates(geometry["coordinates"]);
-        }
-    } else if (type == "Feature") {
-        QJsonObject geometry = m_geoJson["geometry"].toObject();
-        processCoordinates(geometry["coordinates"]);
-    } else {
-        // 直接是 Geometry
-        processCoordinates(m_geoJson["coordinates"]);
-    }
-
-    if (hasCoords) {
-        m_bounds = QGeoRectangle(QGeoCoordinate(maxLat, minLon), 
-                                QGeoCoordinate(minLat, maxLon));
-    } else {
-        m_bounds = QGeoRectangle();
-    }
-}
-
-QVariantMap GeoJSONSource::toMapLibreLayer() const
-{
-    QVariantMap layer;
-    layer["id"] = m_id;
-    layer["type"] = "geojson";
-    layer["source"] = QVariant::fromValue(m_geoJson.toVariantMap());
-    return layer;
-}
-
-QJsonObject GeoJSONSource::features() const
-{
-    return m_geoJson;
-}
-
-int GeoJSONSource::featureCount() const
-{
-    if (m_geoJson.contains("features")) {
-        QJsonArray features = m_geoJson["features"].toArray();
-        return features.count();
-    }
-    return 1; // 单个 Feature
+    buildSpatialIndex(std::move(index));
 }
 
 QVariantMap GeoJSONSource::defaultStyle() const
@@ -150,25 +61,28 @@ bool GeoJSONParser::canParse(QIODevice* device) const
     qint64 originalPos = device->pos();
     device->seek(0);
 
-    QByteArray data = device->peek(1024); // 只读取前 1KB
+    QByteArray head = device->peek(4096); // 只检查文件头部
     device->seek(originalPos);
 
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
-    
-    if (error.error != QJsonParseError::NoError) {
-        return false;
-    }
-
-    if (!doc.isObject()) {
-        return false;
-    }
+    return GeoJSONStreamReader::sniff(head);
+}
 
-    return isValidGeoJSON(doc.object());
+bool GeoJSONParser::canParseData(QByteArrayView data) const
+{
+    // 只检查文件头部
+    return GeoJSONStreamReader::sniff(
+        QByteArray::fromRawData(data.data(), qMin<qsizetype>(data.size(), 4096)));
 }
 
 IMapSource* GeoJSONParser::parse(const QString& filePath)
 {
+    QFileInfo fileInfo(filePath);
+
+    MappedFile mapped(filePath);
+    if (mapped.isMapped()) {
+        return parseData(mapped.data(), fileInfo.fileName());
+    }
+
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "[GeoJSONParser] Cannot open file:" << filePath;
@@ -176,7 +90,6 @@ IMapSource* GeoJSONParser::parse(const QString& filePath)
         return nullptr;
     }
 
-    QFileInfo fileInfo(filePath);
     return parse(&file, fileInfo.fileName());
 }
 
@@ -189,62 +102,54 @@ IMapSource* GeoJSONParser::parse(QIODevice* device, const QString& sourceName)
     }
 
     device->seek(0);
-    QByteArray data = device->readAll();
-
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
 
-    if (error.error != QJsonParseError::NoError) {
-        qWarning() << "[GeoJSONParser] JSON parse error:" << error.errorString();
-        emit parseError(QStringLiteral("JSON 解析错误: ") + error.errorString());
-        return nullptr;
-    }
+    GeoJSONStreamReader reader(device);
+    return readSource(reader, sourceName, nullptr);
+}
 
-    if (!doc.isObject()) {
-        qWarning() << "[GeoJSONParser] Invalid GeoJSON: not an object";
-        emit parseError(QStringLiteral("无效的 GeoJSON 格式"));
-        return nullptr;
-    }
+IMapSource* GeoJSONParser::parseData(QByteArrayView data, const QString& sourceName,
+                                     ParseControl* control)
+{
+    // 直接扫描映射内存，不复制到 QByteArray
+    GeoJSONStreamReader reader(QByteArray::fromRawData(data.data(), data.size()));
+    return readSource(reader, sourceName, control);
+}
 
-    return parseGeoJSON(doc.object(), sourceName);
+IMapSource* GeoJSONParser::createSource(const QString& sourceName, FeatureStore store,
+                                        SpatialIndex index)
+{
+    return IVectorMapSource::create<GeoJSONSource>(sourceName, std::move(store), std::move(index));
 }
 
-IMapSource* GeoJSONParser::parseGeoJSON(const QJsonObject& json, const QString& sourceName)
+IMapSource* GeoJSONParser::readSource(GeoJSONStreamReader& reader, const QString& sourceName,
+                                      ParseControl* control)
 {
-    if (!isValidGeoJSON(json)) {
-        qWarning() << "[GeoJSONParser] Invalid GeoJSON structure";
-        emit parseError(QStringLiteral("无效的 GeoJSON 结构"));
+    FeatureStore store;
+    reader.setProgressHandler([this, control](qint64 bytesRead, qint64 bytesTotal) {
+        // 以 KiB 为单位，避免超过 2 GB 的文件溢出 int
+        emit parseProgress(int(bytesRead / 1024), int(bytesTotal / 1024));
+        return !control || control->checkpoint(bytesRead, bytesTotal);
+    });
+
+    // 取消时 store 随栈释放，不会产生半成品数据源
+    if (!reader.read(store)) {
+        if (control && control->isCanceled()) {
+            qDebug() << "[GeoJSONParser] Parse canceled:" << sourceName;
+            return nullptr;
+        }
+        qWarning() << "[GeoJSONParser] GeoJSON parse error:" << reader.errorString();
+        reportError(control, QStringLiteral("GeoJSON 解析错误: ") + reader.errorString());
         return nullptr;
     }
 
-    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
     QString name = sourceName.isEmpty() ? QStringLiteral("GeoJSON") : sourceName;
 
-    auto source = new GeoJSONSource(id, name, json);
+    auto source = IVectorMapSource::create<GeoJSONSource>(name, std::move(store));
     qDebug() << "[GeoJSONParser] Parsed GeoJSON:" << name 
+             << "type:" << reader.rootType()
              << "features:" << source->featureCount();
 
     return source;
 }
 
-bool GeoJSONParser::isValidGeoJSON(const QJsonObject& json) const
-{
-    // 检查是否有 type 字段
-    if (!json.contains("type")) {
-        return false;
-    }
-
-    QString type = json["type"].toString();
-    
-    // 支持的 GeoJSON 类型
-    QStringList validTypes = {
-        "FeatureCollection", "Feature",
-        "Point", "LineString", "Polygon",
-        "MultiPoint", "MultiLineString", "MultiPolygon",
-        "GeometryCollection"
-    };
-
-    return validTypes.contains(type);
-}
-
 } // namespace YEFS
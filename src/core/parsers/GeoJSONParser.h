@@ -3,13 +3,14 @@
 
 #include "../IMapParser.h"
 #include "../IMapSource.h"
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QGeoRectangle>
 #include <QFileInfo>
 
 namespace YEFS {
 
+class GeoJSONStreamReader;
+
 /**
  * @brief GeoJSON 数据源
  */
@@ -19,7 +20,8 @@ class GeoJSONSource : public IVectorMapSource
 
 public:
     explicit GeoJSONSource(const QString& id, const QString& name, 
-                          const QJsonObject& geoJson, QObject* parent = nullptr);
+                          FeatureStore store, SpatialIndex index = SpatialIndex(),
+                          QObject* parent = nullptr);
     ~GeoJSONSource() override = default;
 
     // IMapSource 接口实现
@@ -27,30 +29,24 @@ public:
     QString name() const override { return m_name; }
     MapSourceType type() const override { return MapSourceType::Vector; }
     bool isLoaded() const override { return m_loaded; }
-    bool isValid() const override { return !m_geoJson.isEmpty(); }
-    QGeoRectangle bounds() const override { return m_bounds; }
-
-    // 数据访问
-    QJsonObject toGeoJSON() const override { return m_geoJson; }
-    QVariantMap toMapLibreLayer() const override;
+    // 空的 FeatureCollection 也是有效文档
+    bool isValid() const override { return m_loaded; }
 
     // IVectorMapSource 接口实现
-    QJsonObject features() const override;
-    int featureCount() const override;
+    const FeatureStore& featureStore() const override { return m_store; }
     QVariantMap defaultStyle() const override;
 
 private:
-    void calculateBounds();
-
     QString m_id;
     QString m_name;
-    QJsonObject m_geoJson;
-    QGeoRectangle m_bounds;
+    FeatureStore m_store;
     bool m_loaded = false;
 };
 
 /**
  * @brief GeoJSON 格式解析器
+ *
+ * 使用 GeoJSONStreamReader 流式解析，不在内存中构建完整的 JSON 树
  */
 class GeoJSONParser : public IMapParser
 {
@@ -79,9 +75,15 @@ public:
     IMapSource* parse(const QString& filePath) override;
     IMapSource* parse(QIODevice* device, const QString& sourceName) override;
 
+    bool canParseData(QByteArrayView data) const override;
+    IMapSource* parseData(QByteArrayView data, const QString& sourceName,
+                          ParseControl* control = nullptr) override;
+    IMapSource* createSource(const QString& sourceName, FeatureStore store,
+                             SpatialIndex index) override;
+
 private:
-    IMapSource* parseGeoJSON(const QJsonObject& json, const QString& sourceName);
-    bool isValidGeoJSON(const QJsonObject& json) const;
+    IMapSource* readSource(GeoJSONStreamReader& reader, const QString& sourceName,
+                           ParseControl* control);
 };
 
 } // namespace YEFS
@@ -0,0 +1,704 @@
+#include "GeoJSONStreamReader.h"
+#include <QByteArrayView>
+#include <QHash>
+#include <QStringList>
+
+namespace YEFS {
+
+namespace {
+
+constexpr qint64 kChunkSize = 256 * 1024;
+constexpr qint64 kProgressStep = 1024 * 1024;
+constexpr int kMaxDepth = 256;
+constexpr int kEmptyArray = -2;
+
+bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+int hexDigit(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void appendUtf8(QByteArray* out, uint code)
+{
+    if (code < 0x80) {
+        out->append(char(code));
+    } else if (code < 0x800) {
+        out->append(char(0xC0 | (code >> 6)));
+        out->append(char(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out->append(char(0xE0 | (code >> 12)));
+        out->append(char(0x80 | ((code >> 6) & 0x3F)));
+        out->append(char(0x80 | (code & 0x3F)));
+    } else {
+        out->append(char(0xF0 | (code >> 18)));
+        out->append(char(0x80 | ((code >> 12) & 0x3F)));
+        out->append(char(0x80 | ((code >> 6) & 0x3F)));
+        out->append(char(0x80 | (code & 0x3F)));
+    }
+}
+
+bool geometryTypeFromName(const QString& name, GeometryType* type)
+{
+    static const QHash<QString, GeometryType> types = {
+        {QStringLiteral("Point"), GeometryType::Point},
+        {QStringLiteral("MultiPoint"), GeometryType::MultiPoint},
+        {QStringLiteral("LineString"), GeometryType::LineString},
+        {QStringLiteral("MultiLineString"), GeometryType::MultiLineString},
+        {QStringLiteral("Polygon"), GeometryType::Polygon},
+        {QStringLiteral("MultiPolygon"), GeometryType::MultiPolygon}
+    };
+
+    auto it = types.constFind(name);
+    if (it == types.constEnd()) {
+        return false;
+    }
+    *type = it.value();
+    return true;
+}
+
+} // namespace
+
+GeoJSONStreamReader::GeoJSONStreamReader(QIODevice* device)
+    : m_device(device)
+{
+    if (m_device && !m_device->isSequential()) {
+        m_total = m_device->size() - m_device->pos();
+    }
+}
+
+GeoJSONStreamReader::GeoJSONStreamReader(const QByteArray& data)
+    : m_buffer(data)
+    , m_total(data.size())
+{
+    m_begin = m_buffer.constData();
+    m_cur = m_begin;
+    m_end = m_begin + m_buffer.size();
+}
+
+bool GeoJSONStreamReader::isValidType(const QString& type)
+{
+    static const QStringList validTypes = {
+        "FeatureCollection", "Feature",
+        "Point", "LineString", "Polygon",
+        "MultiPoint", "MultiLineString", "MultiPolygon",
+        "GeometryCollection"
+    };
+    return validTypes.contains(type);
+}
+
+// ============================================================================
+// 缓冲区
+// ============================================================================
+
+bool GeoJSONStreamReader::fill()
+{
+    if (!m_device || m_failed) {
+        return false;
+    }
+
+    m_consumed += m_end - m_begin;
+
+    m_buffer.resize(kChunkSize);
+    qint64 n = m_device->read(m_buffer.data(), kChunkSize);
+    if (n <= 0) {
+        m_begin = m_cur = m_end = nullptr;
+        return false;
+    }
+
+    m_begin = m_buffer.constData();
+    m_cur = m_begin;
+    m_end = m_begin + n;
+    return true;
+}
+
+int GeoJSONStreamReader::peek()
+{
+    while (ensure()) {
+        if (!isWhitespace(*m_cur)) {
+            return uchar(*m_cur);
+        }
+        ++m_cur;
+    }
+    return -1;
+}
+
+int GeoJSONStreamReader::get()
+{
+    if (!ensure()) {
+        return -1;
+    }
+    return uchar(*m_cur++);
+}
+
+bool GeoJSONStreamReader::expect(char c)
+{
+    if (peek() != c) {
+        return fail(QStringLiteral("期望 '%1'").arg(QLatin1Char(c)));
+    }
+    ++m_cur;
+    return true;
+}
+
+bool GeoJSONStreamReader::fail(const QString& message)
+{
+    if (!m_failed) {
+        m_failed = true;
+        m_errorString = QStringLiteral("%1（偏移 %2）").arg(message).arg(position());
+    }
+    return false;
+}
+
+qint64 GeoJSONStreamReader::position() const
+{
+    return m_consumed + (m_cur - m_begin);
+}
+
+bool GeoJSONStreamReader::reportProgress()
+{
+    if (!m_progress) {
+        return true;
+    }
+    const qint64 current = position();
+    if (current >= m_nextProgress) {
+        m_nextProgress = current + kProgressStep;
+        if (!m_progress(current, m_total)) {
+            return fail(QStringLiteral("读取已取消"));
+        }
+    }
+    return true;
+}
+
+void GeoJSONStreamReader::skipBom()
+{
+    if (ensure() && m_end - m_cur >= 3
+        && uchar(m_cur[0]) == 0xEF && uchar(m_cur[1]) == 0xBB && uchar(m_cur[2]) == 0xBF) {
+        m_cur += 3;
+    }
+}
+
+// ============================================================================
+// JSON 基本值
+// ============================================================================
+
+bool GeoJSONStreamReader::parseString(QByteArray* out)
+{
+    if (!expect('"')) {
+        return false;
+    }
+
+    for (;;) {
+        if (!ensure()) {
+            return fail(QStringLiteral("字符串未结束"));
+        }
+
+        // 快速扫描到引号或转义符
+        const char* start = m_cur;
+        while (m_cur < m_end && *m_cur != '"' && *m_cur != '\\') {
+            ++m_cur;
+        }
+        if (out) {
+            out->append(start, m_cur - start);
+        }
+        if (m_cur == m_end) {
+            continue;
+        }
+
+        if (*m_cur++ == '"') {
+            return true;
+        }
+
+        int escape = get();
+        switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+            if (out) out->append(char(escape));
+            break;
+        case 'b': if (out) out->append('\b'); break;
+        case 'f': if (out) out->append('\f'); break;
+        case 'n': if (out) out->append('\n'); break;
+        case 'r': if (out) out->append('\r'); break;
+        case 't': if (out) out->append('\t'); break;
+        case 'u': {
+            auto readHex = [this](uint* value) {
+                *value = 0;
+                for (int i = 0; i < 4; ++i) {
+                    int digit = hexDigit(get());
+                    if (digit < 0) {
+                        return false;
+                    }
+                    *value = (*value << 4) | uint(digit);
+                }
+                return true;
+            };
+
+            uint code = 0;
+            if (!readHex(&code)) {
+                return fail(QStringLiteral("无效的 Unicode 转义"));
+            }
+            // 代理对
+            if (code >= 0xD800 && code < 0xDC00) {
+                uint low = 0;
+                if (get() != '\\' || get() != 'u' || !readHex(&low)
+                    || low < 0xDC00 || low >= 0xE000) {
+                    return fail(QStringLiteral("无效的 Unicode 代理对"));
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            if (out) appendUtf8(out, code);
+            break;
+        }
+        default:
+            return fail(QStringLiteral("无效的转义字符"));
+        }
+    }
+}
+
+bool GeoJSONStreamReader::parseNumber(double* out)
+{
+    char digits[64];
+    int length = 0;
+
+    peek();
+    while (ensure() && isNumberChar(*m_cur)) {
+        if (length == int(sizeof(digits))) {
+            return fail(QStringLiteral("数字过长"));
+        }
+        digits[length++] = *m_cur++;
+    }
+
+    bool ok = false;
+    double value = QByteArrayView(digits, length).toDouble(&ok);
+    if (!ok) {
+        return fail(QStringLiteral("无效的数字"));
+    }
+    if (out) {
+        *out = value;
+    }
+    return true;
+}
+
+bool GeoJSONStreamReader::parseLiteral(const char* word)
+{
+    peek();
+    for (const char* p = word; *p; ++p) {
+        if (get() != uchar(*p)) {
+            return fail(QStringLiteral("无效的字面量"));
+        }
+    }
+    return true;
+}
+
+template<typename Handler>
+bool GeoJSONStreamReader::parseMembers(Handler&& handler)
+{
+    if (!expect('{')) {
+        return false;
+    }
+    if (peek() == '}') {
+        ++m_cur;
+        return true;
+    }
+
+    QByteArray key;
+    for (;;) {
+        key.resize(0);
+        if (!parseString(&key) || !expect(':')) {
+            return false;
+        }
+        if (!handler(key)) {
+            return false;
+        }
+
+        int c = peek();
+        if (c == ',') {
+            ++m_cur;
+        } else if (c == '}') {
+            ++m_cur;
+            return true;
+        } else {
+            return fail(QStringLiteral("期望 ',' 或 '}'"));
+        }
+    }
+}
+
+template<typename Handler>
+bool GeoJSONStreamReader::parseElements(Handler&& handler)
+{
+    if (!expect('[')) {
+        return false;
+    }
+    if (peek() == ']') {
+        ++m_cur;
+        return true;
+    }
+
+    for (;;) {
+        if (!handler()) {
+            return false;
+        }
+
+        int c = peek();
+        if (c == ',') {
+            ++m_cur;
+        } else if (c == ']') {
+            ++m_cur;
+            return true;
+        } else {
+            return fail(QStringLiteral("期望 ',' 或 ']'"));
+        }
+    }
+}
+
+bool GeoJSONStreamReader::parseValue(QVariant* out, int depth)
+{
+    if (depth > kMaxDepth) {
+        return fail(QStringLiteral("嵌套层级过深"));
+    }
+
+    switch (peek()) {
+    case '{': {
+        QVariantMap map;
+        bool ok = parseMembers([&](const QByteArray& key) {
+            if (!out) {
+                return parseValue(nullptr, depth + 1);
+            }
+            QVariant value;
+            if (!parseValue(&value, depth + 1)) {
+                return false;
+            }
+            map.insert(QString::fromUtf8(key), value);
+            return true;
+        });
+        if (ok && out) *out = map;
+        return ok;
+    }
+    case '[': {
+        QVariantList list;
+        bool ok = parseElements([&]() {
+            if (!out) {
+                return parseValue(nullptr, depth + 1);
+            }
+            QVariant value;
+            if (!parseValue(&value, depth + 1)) {
+                return false;
+            }
+            list.append(value);
+            return true;
+        });
+        if (ok && out) *out = list;
+        return ok;
+    }
+    case '"': {
+        if (!out) {
+            return parseString(nullptr);
+        }
+        QByteArray text;
+        if (!parseString(&text)) {
+            return false;
+        }
+        *out = QString::fromUtf8(text);
+        return true;
+    }
+    case 't':
+        if (out) *out = true;
+        return parseLiteral("true");
+    case 'f':
+        if (out) *out = false;
+        return parseLiteral("false");
+    case 'n':
+        if (out) *out = QVariant();
+        return parseLiteral("null");
+    case -1:
+        return fail(QStringLiteral("数据意外结束"));
+    default: {
+        double number = 0.0;
+        if (!parseNumber(&number)) {
+            return false;
+        }
+        if (out) *out = number;
+        return true;
+    }
+    }
+}
+
+// ============================================================================
+// GeoJSON 结构
+// ============================================================================
+
+bool GeoJSONStreamReader::read(FeatureStore& store)
+{
+    skipBom();
+
+    PendingObject root;
+    if (!parseObject(root, store, 0)) {
+        return false;
+    }
+
+    m_rootType = root.type;
+    if (!isValidType(root.type)) {
+        return fail(QStringLiteral("无效的 GeoJSON 结构"));
+    }
+
+    // FeatureCollection 的要素已在 parseFeatures 中逐个提交
+    if (root.type != QStringLiteral("FeatureCollection")) {
+        if (!resolve(root)) {
+            return false;
+        }
+        commit(root, store);
+    }
+
+    store.squeeze();
+    if (m_progress) {
+        m_progress(position(), m_total);
+    }
+    return true;
+}
+
+bool GeoJSONStreamReader::parseObject(PendingObject& object, FeatureStore& store, int depth)
+{
+    if (depth > kMaxDepth) {
+        return fail(QStringLiteral("嵌套层级过深"));
+    }
+
+    return parseMembers([&](const QByteArray& key) {
+        if (key == "type") {
+            QByteArray type;
+            if (!parseString(&type)) {
+                return false;
+            }
+            object.type = QString::fromUtf8(type);
+            return true;
+        }
+        if (key == "features" && depth == 0) {
+            return parseFeatures(store);
+        }
+        if (key == "coordinates") {
+            object.coordinates.clear();
+            object.hasCoordinates = true;
+            return parseCoordinates(object.coordinates, 0) != -1;
+        }
+        if (key == "geometry") {
+            if (peek() == 'n') {
+                return parseLiteral("null");
+            }
+            PendingObject geometry;
+            if (!parseObject(geometry, store, depth + 1) || !resolve(geometry)) {
+                return false;
+            }
+            object.geometries.append(geometry.geometries);
+            object.collection = geometry.collection;
+            return true;
+        }
+        if (key == "geometries") {
+            // 嵌套的集合展开为外层集合的成员
+            object.collection = true;
+            return parseElements([&]() {
+                PendingObject geometry;
+                if (!parseObject(geometry, store, depth + 1) || !resolve(geometry)) {
+                    return false;
+                }
+                object.geometries.append(geometry.geometries);
+                return true;
+            });
+        }
+        if (key == "properties") {
+            QVariant properties;
+            if (!parseValue(&properties, depth + 1)) {
+                return false;
+            }
+            object.properties = properties.toMap();
+            return true;
+        }
+        if (key == "id") {
+            QVariant id;
+            if (!parseValue(&id, depth + 1)) {
+                return false;
+            }
+            // GeoJSON 的 ID 是字符串或数值，保留原类型
+            if (id.typeId() == QMetaType::QString || id.typeId() == QMetaType::Double) {
+                object.id = id;
+            }
+            return true;
+        }
+        return parseValue(nullptr, depth + 1);
+    });
+}
+
+bool GeoJSONStreamReader::parseFeatures(FeatureStore& store)
+{
+    return parseElements([&]() {
+        PendingObject feature;
+        if (!parseObject(feature, store, 1) || !resolve(feature)) {
+            return false;
+        }
+        commit(feature, store);
+        return reportProgress();
+    });
+}
+
+int GeoJSONStreamReader::parseCoordinates(FeatureGeometry& geometry, int level)
+{
+    // 坐标最多嵌套到 MultiPolygon 的四层
+    if (level > 3) {
+        fail(QStringLiteral("坐标嵌套层级过深"));
+        return -1;
+    }
+    if (!expect('[')) {
+        return -1;
+    }
+
+    int c = peek();
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        if (!parsePosition(geometry)) {
+            return -1;
+        }
+        // 单个大要素（长线、大面）内也定期报告进度、检查取消
+        if (geometry.coordinateCount() % 1024 == 0 && !reportProgress()) {
+            return -1;
+        }
+        return 0;
+    }
+
+    int depth = kEmptyArray;
+    if (c == ']') {
+        ++m_cur;
+        return kEmptyArray;
+    }
+
+    for (;;) {
+        int child = parseCoordinates(geometry, level + 1);
+        if (child == -1) {
+            return -1;
+        }
+        if (child != kEmptyArray) {
+            depth = child;
+        }
+
+        c = peek();
+        if (c == ',') {
+            ++m_cur;
+        } else if (c == ']') {
+            ++m_cur;
+            break;
+        } else {
+            fail(QStringLiteral("期望 ',' 或 ']'"));
+            return -1;
+        }
+    }
+
+    if (depth == 0) {
+        geometry.endPart();
+    } else if (depth == 1) {
+        geometry.endGroup();
+    }
+    return depth == kEmptyArray ? kEmptyArray : depth + 1;
+}
+
+bool GeoJSONStreamReader::parsePosition(FeatureGeometry& geometry)
+{
+    // '[' 已被读取
+    double values[3] = {0.0, 0.0, 0.0};
+    int count = 0;
+
+    for (;;) {
+        double value = 0.0;
+        if (!parseNumber(&value)) {
+            return false;
+        }
+        if (count < 3) {
+            values[count] = value;
+        }
+        ++count;
+
+        int c = peek();
+        if (c == ',') {
+            ++m_cur;
+        } else if (c == ']') {
+            ++m_cur;
+            break;
+        } else {
+            return fail(QStringLiteral("期望 ',' 或 ']'"));
+        }
+    }
+
+    if (count < 2) {
+        return fail(QStringLiteral("坐标至少需要经度和纬度"));
+    }
+
+    if (count >= 3) {
+        geometry.addCoordinate(values[0], values[1], values[2]);
+    } else {
+        geometry.addCoordinate(values[0], values[1]);
+    }
+    return true;
+}
+
+bool GeoJSONStreamReader::resolve(PendingObject& object)
+{
+    if (!object.hasCoordinates) {
+        return true;
+    }
+
+    GeometryType type;
+    if (!geometryTypeFromName(object.type, &type)) {
+        return fail(QStringLiteral("不支持的几何类型: %1").arg(object.type));
+    }
+
+    object.coordinates.type = type;
+    object.geometries.append(object.coordinates);
+    object.coordinates.clear();
+    object.hasCoordinates = false;
+    return true;
+}
+
+void GeoJSONStreamReader::commit(const PendingObject& object, FeatureStore& store)
+{
+    // GeometryCollection 作为一个要素；"geometry": null 的要素只保存属性
+    if (object.collection) {
+        store.appendCollection(object.geometries, object.properties, object.id);
+    } else if (object.geometries.isEmpty()) {
+        store.appendWithoutGeometry(object.properties, object.id);
+    } else {
+        store.append(object.geometries.first(), object.properties, object.id);
+    }
+}
+
+bool GeoJSONStreamReader::sniff(const QByteArray& head)
+{
+    GeoJSONStreamReader reader(head);
+    reader.skipBom();
+
+    bool recognized = false;
+    reader.parseMembers([&](const QByteArray& key) {
+        if (key == "type") {
+            QByteArray type;
+            if (reader.parseString(&type)) {
+                recognized = isValidType(QString::fromUtf8(type));
+            }
+            return false;
+        }
+        if (key == "features" || key == "geometry"
+            || key == "coordinates" || key == "geometries") {
+            recognized = true;
+            return false;
+        }
+        return reader.parseValue(nullptr, 1);
+    });
+
+    return recognized;
+}
+
+} // namespace YEFS
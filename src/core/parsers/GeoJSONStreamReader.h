@@ -0,0 +1,96 @@
+#ifndef YEFS_GEOJSONSTREAMREADER_H
+#define YEFS_GEOJSONSTREAMREADER_H
+
+#include "../FeatureStore.h"
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QVariant>
+#include <functional>
+
+namespace YEFS {
+
+/**
+ * @brief 流式 GeoJSON 读取器
+ *
+ * 按块从 QIODevice 读取数据（或直接扫描内存映射的整段数据），逐个解析 features 数组中的要素
+ * 并直接写入 FeatureStore，不构建 QJsonDocument，峰值内存只与单个要素的大小相关。
+ */
+class GeoJSONStreamReader
+{
+public:
+    // 返回 false 时中止读取
+    using ProgressHandler = std::function<bool(qint64 bytesRead, qint64 bytesTotal)>;
+
+    explicit GeoJSONStreamReader(QIODevice* device);
+    // data 可以是 QByteArray::fromRawData 包装的映射内存，读取期间需保持有效
+    explicit GeoJSONStreamReader(const QByteArray& data);
+
+    void setProgressHandler(ProgressHandler handler) { m_progress = std::move(handler); }
+
+    // 读取整个文档，要素依次追加到 store
+    bool read(FeatureStore& store);
+
+    QString rootType() const { return m_rootType; }
+    QString errorString() const { return m_errorString; }
+
+    // 根据文件头部判断是否像 GeoJSON（允许数据被截断）
+    static bool sniff(const QByteArray& head);
+    static bool isValidType(const QString& type);
+
+private:
+    struct PendingObject {
+        QString type;
+        FeatureGeometry coordinates;
+        bool hasCoordinates = false;
+        QList<FeatureGeometry> geometries;
+        bool collection = false;        // 几何为 GeometryCollection，geometries 为其成员
+        QVariantMap properties;
+        QVariant id;                    // 字符串或数值
+    };
+
+    // 缓冲区
+    bool fill();
+    bool ensure() { return m_cur < m_end || fill(); }
+    int peek();
+    int get();
+    bool expect(char c);
+    bool fail(const QString& message);
+    qint64 position() const;
+    void skipBom();
+    bool reportProgress();
+
+    // JSON 基本值
+    bool parseString(QByteArray* out);
+    bool parseNumber(double* out);
+    bool parseLiteral(const char* word);
+    bool parseValue(QVariant* out, int depth);
+    template<typename Handler> bool parseMembers(Handler&& handler);
+    template<typename Handler> bool parseElements(Handler&& handler);
+
+    // GeoJSON 结构
+    bool parseObject(PendingObject& object, FeatureStore& store, int depth);
+    bool parseFeatures(FeatureStore& store);
+    int parseCoordinates(FeatureGeometry& geometry, int level);
+    bool parsePosition(FeatureGeometry& geometry);
+    bool resolve(PendingObject& object);
+    void commit(const PendingObject& object, FeatureStore& store);
+
+    QIODevice* m_device = nullptr;
+    QByteArray m_buffer;
+    const char* m_begin = nullptr;
+    const char* m_cur = nullptr;
+    const char* m_end = nullptr;
+    qint64 m_consumed = 0;      // 当前缓冲区之前已读取的字节数
+    qint64 m_total = 0;
+    qint64 m_nextProgress = 0;
+
+    ProgressHandler m_progress;
+    QString m_rootType;
+    QString m_errorString;
+    bool m_failed = false;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_GEOJSONSTREAMREADER_H
@@ -1,165 +1,26 @@
 #include "KMLParser.h"
+#include "../MappedFile.h"
+#include <QBuffer>
 #include <QFile>
 #include <QFileInfo>
-#include <QJsonArray>
 #include <QDebug>
-#include <QUuid>
-#include <QRegularExpression>
 
 namespace YEFS {
 
-// ============================================================================
-// KMLPlacemark 实现
-// ============================================================================
-
-QJsonObject KMLPlacemark::toGeoJSONFeature() const
-{
-    QJsonObject feature;
-    feature["type"] = "Feature";
-
-    // 几何数据
-    QJsonObject geometry;
-    switch (geometryType) {
-    case Point:
-        geometry["type"] = "Point";
-        if (!coordinates.isEmpty()) {
-            QJsonArray coord;
-            coord.append(coordinates[0].longitude());
-            coord.append(coordinates[0].latitude());
-            coord.append(coordinates[0].altitude());
-            geometry["coordinates"] = coord;
-        }
-        break;
-        
-    case LineString:
-        geometry["type"] = "LineString";
-        {
-            QJsonArray coords;
-            for (const auto& coord : coordinates) {
-                QJsonArray point;
-                point.append(coord.longitude());
-                point.append(coord.latitude());
-                point.append(coord.altitude());
-                coords.append(point);
-            }
-            geometry["coordinates"] = coords;
-        }
-        break;
-        
-    case Polygon:
-        geometry["type"] = "Polygon";
-        {
-            QJsonArray rings;
-            // 外环
-            QJsonArray outerRing;
-            for (const auto& coord : coordinates) {
-                QJsonArray point;
-                point.append(coord.longitude());
-                point.append(coord.latitude());
-                point.append(coord.altitude());
-                outerRing.append(point);
-            }
-            rings.append(outerRing);
-            
-            // 内环
-            for (const auto& inner : innerBoundaries) {
-                QJsonArray innerRing;
-                for (const auto& coord : inner) {
-                    QJsonArray point;
-                    point.append(coord.longitude());
-                    point.append(coord.latitude());
-                    point.append(coord.altitude());
-                    innerRing.append(point);
-                }
-                rings.append(innerRing);
-            }
-            
-            geometry["coordinates"] = rings;
-        }
-        break;
-        
-    default:
-        break;
-    }
-    
-    feature["geometry"] = geometry;
-
-    // 属性
-    QJsonObject properties;
-    properties["name"] = name;
-    properties["description"] = description;
-    properties["styleUrl"] = styleUrl;
-    feature["properties"] = properties;
-
-    return feature;
-}
-
 // ============================================================================
 // KMLSource 实现
 // ============================================================================
 
-KMLSource::KMLSource(const QString& id, const QString& name, QObject* parent)
+KMLSource::KMLSource(const QString& id, const QString& name,
+                     FeatureStore store, SpatialIndex index,
+                     QObject* parent)
     : IVectorMapSource(parent)
     , m_id(id)
     , m_name(name)
+    , m_store(std::move(store))
     , m_loaded(true)
 {
-}
-
-void KMLSource::addPlacemark(const KMLPlacemark& placemark)
-{
-    m_placemarks.append(placemark);
-    updateBounds();
-}
-
-void KMLSource::updateBounds()
-{
-    if (m_placemarks.isEmpty()) {
-        return;
-    }
-
-    double minLat = 90.0, maxLat = -90.0;
-    double minLon = 180.0, maxLon = -180.0;
-
-    for (const auto& placemark : m_placemarks) {
-        for (const auto& coord : placemark.coordinates) {
-            minLat = qMin(minLat, coord.latitude());
-            maxLat = qMax(maxLat, coord.latitude());
-            minLon = qMin(minLon, coord.longitude());
-            maxLon = qMax(maxLon, coord.longitude());
-        }
-    }
-
-    m_bounds = QGeoRectangle(QGeoCoordinate(maxLat, minLon), 
-                             QGeoCoordinate(minLat, maxLon));
-}
-
-QJsonObject KMLSource::toGeoJSON() const
-{
-    QJsonObject geoJson;
-    geoJson["type"] = "FeatureCollection";
-
-    QJsonArray features;
-    for (const auto& placemark : m_placemarks) {
-        features.append(placemark.toGeoJSONFeature());
-    }
-
-    geoJson["features"] = features;
-    return geoJson;
-}
-
-QVariantMap KMLSource::toMapLibreLayer() const
-{
-    QVariantMap layer;
-    layer["id"] = m_id;
-    layer["type"] = "geojson";
-    layer["source"] = QVariant::fromValue(toGeoJSON().toVariantMap());
-    return layer;
-}
-
-QJsonObject KMLSource::features() const
-{
-    return toGeoJSON();
+    buildSpatialIndex(std::move(index));
 }
 
 QVariantMap KMLSource::defaultStyle() const
@@ -217,6 +78,13 @@ bool KMLParser::canParse(QIODevice* device) const
 
 IMapSource* KMLParser::parse(const QString& filePath)
 {
+    QFileInfo fileInfo(filePath);
+
+    MappedFile mapped(filePath);
+    if (mapped.isMapped()) {
+        return parseData(mapped.data(), fileInfo.fileName());
+    }
+
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "[KMLParser] Cannot open file:" << filePath;
@@ -224,7 +92,6 @@ IMapSource* KMLParser::parse(const QString& filePath)
         return nullptr;
     }
 
-    QFileInfo fileInfo(filePath);
     return parse(&file, fileInfo.fileName());
 }
 
@@ -239,164 +106,226 @@ IMapSource* KMLParser::parse(QIODevice* device, const QString& sourceName)
     device->seek(0);
     QXmlStreamReader xml(device);
 
-    return parseKML(xml, sourceName);
+    return parseKML(xml, sourceName, nullptr, device->size());
 }
 
-KMLSource* KMLParser::parseKML(QXmlStreamReader& xml, const QString& sourceName)
+IMapSource* KMLParser::parseData(QByteArrayView data, const QString& sourceName,
+                                 ParseControl* control)
+{
+    // 整段 QByteArray 交给 QXmlStreamReader 时首次读取就会解码成完整的 UTF-16 文本，
+    // 经 QBuffer 按设备读取则按块解码；QBuffer 包装映射内存本身，不复制文件内容
+    QBuffer buffer;
+    buffer.setData(QByteArray::fromRawData(data.data(), data.size()));
+    buffer.open(QIODevice::ReadOnly);
+    QXmlStreamReader xml(&buffer);
+    return parseKML(xml, sourceName, control, data.size());
+}
+
+IMapSource* KMLParser::createSource(const QString& sourceName, FeatureStore store,
+                                    SpatialIndex index)
+{
+    return IVectorMapSource::create<KMLSource>(sourceName, std::move(store), std::move(index));
+}
+
+KMLSource* KMLParser::parseKML(QXmlStreamReader& xml, const QString& sourceName,
+                             ParseControl* control, qint64 totalBytes)
 {
-    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
     QString name = sourceName.isEmpty() ? QStringLiteral("KML") : sourceName;
 
-    auto source = new KMLSource(id, name);
+    FeatureStore store;
+    int placemarkCount = 0;
 
     while (!xml.atEnd() && !xml.hasError()) {
         xml.readNext();
 
         if (xml.isStartElement() && xml.name() == QStringLiteral("Placemark")) {
-            source->addPlacemark(parsePlacemark(xml));
+            if (control && !control->checkpoint(xml.characterOffset(), totalBytes)) {
+                break;
+            }
+            parsePlacemark(xml, store);
+            ++placemarkCount;
         }
     }
 
+    // 取消时 store 随栈释放，不会产生半成品数据源
+    if (control && control->isCanceled()) {
+        qDebug() << "[KMLParser] Parse canceled:" << name;
+        return nullptr;
+    }
+
     if (xml.hasError()) {
         qWarning() << "[KMLParser] XML parse error:" << xml.errorString();
-        emit parseError(QStringLiteral("XML 解析错误: ") + xml.errorString());
-        delete source;
+        reportError(control, QStringLiteral("XML 解析错误: ") + xml.errorString());
         return nullptr;
     }
 
+    store.squeeze();
+    auto source = IVectorMapSource::create<KMLSource>(name, std::move(store));
+
     qDebug() << "[KMLParser] Parsed KML:" << name 
-             << "placemarks:" << source->placemarks().count();
+             << "placemarks:" << placemarkCount
+             << "features:" << source->featureCount();
 
     return source;
 }
 
-KMLPlacemark KMLParser::parsePlacemark(QXmlStreamReader& xml)
+void KMLParser::parsePlacemark(QXmlStreamReader& xml, FeatureStore& store)
 {
-    KMLPlacemark placemark;
-    QString name, description, styleUrl;
+    QVariantMap properties;
+    properties["name"] = QString();
+    properties["description"] = QString();
+    properties["styleUrl"] = QString();
+
+    // 地标内的所有几何（包括 MultiGeometry 中的成员）
+    QList<FeatureGeometry> geometries;
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("Placemark"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("Placemark"))) {
         xml.readNext();
 
         if (xml.isStartElement()) {
             if (xml.name() == QStringLiteral("name")) {
-                name = xml.readElementText();
+                properties["name"] = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("description")) {
-                description = xml.readElementText();
+                properties["description"] = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("styleUrl")) {
-                styleUrl = xml.readElementText();
+                properties["styleUrl"] = xml.readElementText();
             }
             else if (xml.name() == QStringLiteral("Point")) {
-                placemark = parsePoint(xml);
-                placemark.name = name;
-                placemark.description = description;
-                placemark.styleUrl = styleUrl;
+                geometries.append(parsePoint(xml));
             }
             else if (xml.name() == QStringLiteral("LineString")) {
-                placemark = parseLineString(xml);
-                placemark.name = name;
-                placemark.description = description;
-                placemark.styleUrl = styleUrl;
+                geometries.append(parseLineString(xml));
             }
             else if (xml.name() == QStringLiteral("Polygon")) {
-                placemark = parsePolygon(xml);
-                placemark.name = name;
-                placemark.description = description;
-                placemark.styleUrl = styleUrl;
+                geometries.append(parsePolygon(xml));
             }
         }
     }
 
-    return placemark;
+    for (const FeatureGeometry& geometry : geometries) {
+        if (!geometry.isEmpty()) {
+            store.append(geometry, properties);
+        }
+    }
 }
 
-KMLPlacemark KMLParser::parsePoint(QXmlStreamReader& xml)
+FeatureGeometry KMLParser::parsePoint(QXmlStreamReader& xml)
 {
-    KMLPlacemark placemark;
-    placemark.geometryType = KMLPlacemark::Point;
+    FeatureGeometry geometry;
+    geometry.type = GeometryType::Point;
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("Point"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("Point"))) {
         xml.readNext();
 
         if (xml.isStartElement() && xml.name() == QStringLiteral("coordinates")) {
-            QString coordString = xml.readElementText();
-            placemark.coordinates = parseCoordinates(coordString);
+            parseCoordinates(xml.readElementText(), geometry);
         }
     }
 
-    return placemark;
+    return geometry;
 }
 
-KMLPlacemark KMLParser::parseLineString(QXmlStreamReader& xml)
+FeatureGeometry KMLParser::parseLineString(QXmlStreamReader& xml)
 {
-    KMLPlacemark placemark;
-    placemark.geometryType = KMLPlacemark::LineString;
+    FeatureGeometry geometry;
+    geometry.type = GeometryType::LineString;
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("LineString"))) {
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("LineString"))) {
         xml.readNext();
 
         if (xml.isStartElement() && xml.name() == QStringLiteral("coordinates")) {
-            QString coordString = xml.readElementText();
-            placemark.coordinates = parseCoordinates(coordString);
+            parseCoordinates(xml.readElementText(), geometry);
         }
     }
 
-    return placemark;
+    return geometry;
 }
 
-KMLPlacemark KMLParser::parsePolygon(QXmlStreamReader& xml)
+FeatureGeometry KMLParser::parsePolygon(QXmlStreamReader& xml)
 {
-    KMLPlacemark placemark;
-    placemark.geometryType = KMLPlacemark::Polygon;
+    FeatureGeometry geometry;
+    geometry.type = GeometryType::Polygon;
 
-    while (!(xml.isEndElement() && xml.name() == QStringLiteral("Polygon"))) {
+    // 外环在前，内环依次在后
+    FeatureGeometry innerRings;
+
+    while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("Polygon"))) {
         xml.readNext();
 
         if (xml.isStartElement()) {
             if (xml.name() == QStringLiteral("outerBoundaryIs")) {
-                while (!(xml.isEndElement() && xml.name() == QStringLiteral("outerBoundaryIs"))) {
+                while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("outerBoundaryIs"))) {
                     xml.readNext();
                     if (xml.isStartElement() && xml.name() == QStringLiteral("coordinates")) {
-                        QString coordString = xml.readElementText();
-                        placemark.coordinates = parseCoordinates(coordString);
+                        parseCoordinates(xml.readElementText(), geometry);
+                        geometry.endPart();
                     }
                 }
             }
             else if (xml.name() == QStringLiteral("innerBoundaryIs")) {
-                while (!(xml.isEndElement() && xml.name() == QStringLiteral("innerBoundaryIs"))) {
+                while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == QStringLiteral("innerBoundaryIs"))) {
                     xml.readNext();
                     if (xml.isStartElement() && xml.name() == QStringLiteral("coordinates")) {
-                        QString coordString = xml.readElementText();
-                        placemark.innerBoundaries.append(parseCoordinates(coordString));
+                        parseCoordinates(xml.readElementText(), innerRings);
+                        innerRings.endPart();
                     }
                 }
             }
         }
     }
 
-    return placemark;
+    // 追加内环
+    const quint32 base = quint32(geometry.coordinateCount());
+    geometry.lon.append(innerRings.lon);
+    geometry.lat.append(innerRings.lat);
+    geometry.alt.append(innerRings.alt);
+    geometry.hasAltitude = geometry.hasAltitude || innerRings.hasAltitude;
+    for (quint32 end : innerRings.partEnds) {
+        geometry.partEnds.append(base + end);
+    }
+
+    return geometry;
 }
 
-QList<QGeoCoordinate> KMLParser::parseCoordinates(const QString& coordString)
+void KMLParser::parseCoordinates(QStringView text, FeatureGeometry& geometry)
 {
-    QList<QGeoCoordinate> coordinates;
-    
-    QString trimmed = coordString.trimmed();
-    QStringList points = trimmed.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-
-    for (const QString& point : points) {
-        QStringList parts = point.split(',');
-        if (parts.size() >= 2) {
-            double lon = parts[0].toDouble();
-            double lat = parts[1].toDouble();
-            double alt = parts.size() >= 3 ? parts[2].toDouble() : 0.0;
-            coordinates.append(QGeoCoordinate(lat, lon, alt));
+    // 坐标元组以空白分隔，元组内为 "lon,lat[,alt]"
+    const qsizetype size = text.size();
+    qsizetype i = 0;
+
+    while (i < size) {
+        while (i < size && text.at(i).isSpace()) {
+            ++i;
+        }
+        const qsizetype start = i;
+        while (i < size && !text.at(i).isSpace()) {
+            ++i;
+        }
+        if (start == i) {
+            break;
         }
-    }
 
-    return coordinates;
+        const QStringView tuple = text.mid(start, i - start);
+        double values[3] = {0.0, 0.0, 0.0};
+        int count = 0;
+        qsizetype from = 0;
+        while (count < 3 && from <= tuple.size()) {
+            qsizetype comma = tuple.indexOf(QLatin1Char(','), from);
+            if (comma < 0) {
+                comma = tuple.size();
+            }
+            values[count++] = tuple.mid(from, comma - from).toDouble();
+            from = comma + 1;
+        }
+
+        if (count >= 3) {
+            geometry.addCoordinate(values[0], values[1], values[2]);
+        } else if (count == 2) {
+            geometry.addCoordinate(values[0], values[1]);
+        }
+    }
 }
 
 } // namespace YEFS
@@ -4,43 +4,22 @@
 #include "../IMapParser.h"
 #include "../IMapSource.h"
 #include <QXmlStreamReader>
-#include <QJsonObject>
-#include <QGeoCoordinate>
 
 namespace YEFS {
 
-/**
- * @brief KML 地标
- */
-struct KMLPlacemark {
-    QString name;
-    QString description;
-    QString styleUrl;
-    
-    // 几何数据
-    enum GeometryType {
-        Point,
-        LineString,
-        Polygon,
-        MultiGeometry
-    };
-    
-    GeometryType geometryType;
-    QList<QGeoCoordinate> coordinates;
-    QList<QList<QGeoCoordinate>> innerBoundaries; // For Polygon
-    
-    QJsonObject toGeoJSONFeature() const;
-};
-
 /**
  * @brief KML 数据源
+ *
+ * 每个地标的几何保存为一个要素，MultiGeometry 拆分为共享属性的多个要素
  */
 class KMLSource : public IVectorMapSource
 {
     Q_OBJECT
 
 public:
-    explicit KMLSource(const QString& id, const QString& name, QObject* parent = nullptr);
+    explicit KMLSource(const QString& id, const QString& name,
+                       FeatureStore store, SpatialIndex index = SpatialIndex(),
+                       QObject* parent = nullptr);
     ~KMLSource() override = default;
 
     // IMapSource 接口实现
@@ -48,29 +27,16 @@ public:
     QString name() const override { return m_name; }
     MapSourceType type() const override { return MapSourceType::Vector; }
     bool isLoaded() const override { return m_loaded; }
-    bool isValid() const override { return !m_placemarks.isEmpty(); }
-    QGeoRectangle bounds() const override { return m_bounds; }
-
-    // 数据访问
-    QJsonObject toGeoJSON() const override;
-    QVariantMap toMapLibreLayer() const override;
+    bool isValid() const override { return !m_store.isEmpty(); }
 
     // IVectorMapSource 接口实现
-    QJsonObject features() const override;
-    int featureCount() const override { return m_placemarks.count(); }
+    const FeatureStore& featureStore() const override { return m_store; }
     QVariantMap defaultStyle() const override;
 
-    // KML 特有数据
-    void addPlacemark(const KMLPlacemark& placemark);
-    const QList<KMLPlacemark>& placemarks() const { return m_placemarks; }
-
 private:
-    void updateBounds();
-
     QString m_id;
     QString m_name;
-    QList<KMLPlacemark> m_placemarks;
-    QGeoRectangle m_bounds;
+    FeatureStore m_store;
     bool m_loaded = false;
 };
 
@@ -105,14 +71,19 @@ public:
 
     IMapSource* parse(const QString& filePath) override;
     IMapSource* parse(QIODevice* device, const QString& sourceName) override;
+    IMapSource* parseData(QByteArrayView data, const QString& sourceName,
+                          ParseControl* control = nullptr) override;
+    IMapSource* createSource(const QString& sourceName, FeatureStore store,
+                             SpatialIndex index) override;
 
 private:
-    KMLSource* parseKML(QXmlStreamReader& xml, const QString& sourceName);
-    KMLPlacemark parsePlacemark(QXmlStreamReader& xml);
-    QList<QGeoCoordinate> parseCoordinates(const QString& coordString);
-    KMLPlacemark parsePoint(QXmlStreamReader& xml);
-    KMLPlacemark parseLineString(QXmlStreamReader& xml);
-    KMLPlacemark parsePolygon(QXmlStreamReader& xml);
+    KMLSource* parseKML(QXmlStreamReader& xml, const QString& sourceName,
+                         ParseControl* control, qint64 totalBytes);
+    void parsePlacemark(QXmlStreamReader& xml, FeatureStore& store);
+    void parseCoordinates(QStringView text, FeatureGeometry& geometry);
+    FeatureGeometry parsePoint(QXmlStreamReader& xml);
+    FeatureGeometry parseLineString(QXmlStreamReader& xml);
+    FeatureGeometry parsePolygon(QXmlStreamReader& xml);
 };
 
 } // namespace YEFS
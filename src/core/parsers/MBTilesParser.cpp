@@ -0,0 +1,71 @@
+#include "MBTilesParser.h"
+#include "../tiles/LocalTileSource.h"
+#include "../tiles/MBTilesReader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <QUuid>
+
+namespace YEFS {
+
+// ============================================================================
+// MBTilesParser 实现
+// ============================================================================
+
+MBTilesParser::MBTilesParser(QObject* parent)
+    : IMapParser(parent)
+{
+}
+
+bool MBTilesParser::canParse(const QString& filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return canParse(&file);
+}
+
+bool MBTilesParser::canParse(QIODevice* device) const
+{
+    if (!device || !device->isReadable()) {
+        return false;
+    }
+    return MBTilesReader::isSQLite(device->peek(16));
+}
+
+bool MBTilesParser::canParseData(QByteArrayView data) const
+{
+    return MBTilesReader::isSQLite(data);
+}
+
+IMapSource* MBTilesParser::parse(const QString& filePath)
+{
+    auto reader = std::make_shared<MBTilesReader>(filePath);
+    if (!reader->isValid()) {
+        qWarning() << "[MBTilesParser] Cannot open MBTiles:" << filePath << reader->errorString();
+        emit parseError(reader->errorString());
+        return nullptr;
+    }
+
+    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    const QJsonObject metadata = reader->metadata();
+    QString name = metadata.value(QStringLiteral("name")).toString();
+    if (name.isEmpty()) {
+        name = QFileInfo(filePath).fileName();
+    }
+
+    qDebug() << "[MBTilesParser] Opened MBTiles:" << name << "format:" << reader->format();
+    return new LocalTileSource(id, name, std::move(reader), metadata);
+}
+
+IMapSource* MBTilesParser::parse(QIODevice* device, const QString& sourceName)
+{
+    // SQLite 只能打开文件
+    Q_UNUSED(device)
+    qWarning() << "[MBTilesParser] MBTiles can only be opened from a file:" << sourceName;
+    emit parseError(QStringLiteral("MBTiles 只能从文件加载"));
+    return nullptr;
+}
+
+} // namespace YEFS
@@ -0,0 +1,47 @@
+#ifndef YEFS_MBTILESPARSER_H
+#define YEFS_MBTILESPARSER_H
+
+#include "../IMapParser.h"
+#include "../IMapSource.h"
+
+namespace YEFS {
+
+/**
+ * @brief MBTiles 解析器
+ *
+ * 支持栅格（png/jpg/webp）和矢量（pbf）MBTiles。打开时只读取 metadata 表，
+ * 瓦片由 MBTilesReader 按需从 SQLite 文件读取
+ */
+class MBTilesParser : public IMapParser
+{
+    Q_OBJECT
+
+public:
+    explicit MBTilesParser(QObject* parent = nullptr);
+    ~MBTilesParser() override = default;
+
+    // IMapParser 接口实现
+    QString name() const override { return QStringLiteral("MBTiles"); }
+    QString description() const override {
+        return QStringLiteral("MBTiles 离线瓦片解析器");
+    }
+    QStringList supportedExtensions() const override {
+        return {QStringLiteral("mbtiles")};
+    }
+    QStringList mimeTypes() const override {
+        return {QStringLiteral("application/vnd.mapbox-vector-tile"),
+                QStringLiteral("application/x-sqlite3")};
+    }
+    bool needsFilePath() const override { return true; }
+
+    bool canParse(const QString& filePath) const override;
+    bool canParse(QIODevice* device) const override;
+    bool canParseData(QByteArrayView data) const override;
+
+    IMapSource* parse(const QString& filePath) override;
+    IMapSource* parse(QIODevice* device, const QString& sourceName) override;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_MBTILESPARSER_H
@@ -0,0 +1,71 @@
+#include "PMTilesParser.h"
+#include "../tiles/LocalTileSource.h"
+#include "../tiles/PMTilesReader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <QUuid>
+
+namespace YEFS {
+
+// ============================================================================
+// PMTilesParser 实现
+// ============================================================================
+
+PMTilesParser::PMTilesParser(QObject* parent)
+    : IMapParser(parent)
+{
+}
+
+bool PMTilesParser::canParse(const QString& filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return canParse(&file);
+}
+
+bool PMTilesParser::canParse(QIODevice* device) const
+{
+    if (!device || !device->isReadable()) {
+        return false;
+    }
+    return PMTilesReader::isPMTiles(device->peek(8));
+}
+
+bool PMTilesParser::canParseData(QByteArrayView data) const
+{
+    return PMTilesReader::isPMTiles(data);
+}
+
+IMapSource* PMTilesParser::parse(const QString& filePath)
+{
+    auto reader = std::make_shared<PMTilesReader>(filePath);
+    if (!reader->isValid()) {
+        qWarning() << "[PMTilesParser] Cannot open PMTiles:" << filePath << reader->errorString();
+        emit parseError(reader->errorString());
+        return nullptr;
+    }
+
+    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    const QJsonObject metadata = reader->metadata();
+    QString name = metadata.value(QStringLiteral("name")).toString();
+    if (name.isEmpty()) {
+        name = QFileInfo(filePath).fileName();
+    }
+
+    qDebug() << "[PMTilesParser] Opened PMTiles:" << name << "format:" << reader->format();
+    return new LocalTileSource(id, name, std::move(reader), metadata);
+}
+
+IMapSource* PMTilesParser::parse(QIODevice* device, const QString& sourceName)
+{
+    // 目录和瓦片按偏移随机读取，需要映射整个文件
+    Q_UNUSED(device)
+    qWarning() << "[PMTilesParser] PMTiles can only be opened from a file:" << sourceName;
+    emit parseError(QStringLiteral("PMTiles 只能从文件加载"));
+    return nullptr;
+}
+
+} // namespace YEFS
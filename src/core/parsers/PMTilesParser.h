@@ -0,0 +1,43 @@
+#ifndef YEFS_PMTILESPARSER_H
+#define YEFS_PMTILESPARSER_H
+
+#include "../IMapParser.h"
+#include "../IMapSource.h"
+
+namespace YEFS {
+
+/**
+ * @brief PMTiles 解析器
+ *
+ * 支持 PMTiles v3 单文件归档（栅格或矢量）。打开时只解码文件头、元数据和根目录，
+ * 瓦片由 PMTilesReader 按需从映射内存读取
+ */
+class PMTilesParser : public IMapParser
+{
+    Q_OBJECT
+
+public:
+    explicit PMTilesParser(QObject* parent = nullptr);
+    ~PMTilesParser() override = default;
+
+    // IMapParser 接口实现
+    QString name() const override { return QStringLiteral("PMTiles"); }
+    QString description() const override {
+        return QStringLiteral("PMTiles v3 单文件瓦片归档解析器");
+    }
+    QStringList supportedExtensions() const override {
+        return {QStringLiteral("pmtiles")};
+    }
+    bool needsFilePath() const override { return true; }
+
+    bool canParse(const QString& filePath) const override;
+    bool canParse(QIODevice* device) const override;
+    bool canParseData(QByteArrayView data) const override;
+
+    IMapSource* parse(const QString& filePath) override;
+    IMapSource* parse(QIODevice* device, const QString& sourceName) override;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_PMTILESPARSER_H
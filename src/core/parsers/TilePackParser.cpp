@@ -0,0 +1,74 @@
+#include "TilePackParser.h"
+#include "../tiles/LocalTileSource.h"
+#include "../tiles/TilePack.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <QUuid>
+
+namespace YEFS {
+
+// ============================================================================
+// TilePackParser 实现
+// ============================================================================
+
+TilePackParser::TilePackParser(QObject* parent)
+    : IMapParser(parent)
+{
+}
+
+bool TilePackParser::canParse(const QString& filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return canParse(&file);
+}
+
+bool TilePackParser::canParse(QIODevice* device) const
+{
+    if (!device || !device->isReadable()) {
+        return false;
+    }
+    return TilePack::isTilePack(device->peek(TilePackFormat::HeaderSize));
+}
+
+bool TilePackParser::canParseData(QByteArrayView data) const
+{
+    return TilePack::isTilePack(data);
+}
+
+IMapSource* TilePackParser::parse(const QString& filePath)
+{
+    auto pack = std::make_shared<TilePack>(filePath);
+    if (!pack->isValid()) {
+        qWarning() << "[TilePackParser] Cannot open tile pack:" << filePath << pack->errorString();
+        emit parseError(pack->errorString());
+        return nullptr;
+    }
+
+    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    QJsonObject metadata = pack->metadata();
+    QString name = metadata.value(QStringLiteral("name")).toString();
+    if (name.isEmpty()) {
+        name = QFileInfo(filePath).fileName();
+    }
+    metadata[QStringLiteral("description")] = metadata.value(QStringLiteral("complete")).toBool()
+        ? QStringLiteral("离线瓦片包，%1 个瓦片").arg(pack->tileCount())
+        : QStringLiteral("离线瓦片包（未下载完整），%1 个瓦片").arg(pack->tileCount());
+
+    qDebug() << "[TilePackParser] Opened tile pack:" << name << "tiles:" << pack->tileCount();
+    return new LocalTileSource(id, name, std::move(pack), metadata);
+}
+
+IMapSource* TilePackParser::parse(QIODevice* device, const QString& sourceName)
+{
+    // 瓦片按偏移随机读取，需要映射整个文件
+    Q_UNUSED(device)
+    qWarning() << "[TilePackParser] Tile packs can only be opened from a file:" << sourceName;
+    emit parseError(QStringLiteral("离线瓦片包只能从文件加载"));
+    return nullptr;
+}
+
+} // namespace YEFS
@@ -0,0 +1,42 @@
+#ifndef YEFS_TILEPACKPARSER_H
+#define YEFS_TILEPACKPARSER_H
+
+#include "../IMapParser.h"
+#include "../IMapSource.h"
+
+namespace YEFS {
+
+/**
+ * @brief 离线瓦片包解析器
+ *
+ * 打开 OfflinePackDownloader 生成的 .yefspack 文件，只读取索引，瓦片按需从映射内存取出
+ */
+class TilePackParser : public IMapParser
+{
+    Q_OBJECT
+
+public:
+    explicit TilePackParser(QObject* parent = nullptr);
+    ~TilePackParser() override = default;
+
+    // IMapParser 接口实现
+    QString name() const override { return QStringLiteral("TilePack"); }
+    QString description() const override {
+        return QStringLiteral("离线瓦片包解析器");
+    }
+    QStringList supportedExtensions() const override {
+        return {QStringLiteral("yefspack")};
+    }
+    bool needsFilePath() const override { return true; }
+
+    bool canParse(const QString& filePath) const override;
+    bool canParse(QIODevice* device) const override;
+    bool canParseData(QByteArrayView data) const override;
+
+    IMapSource* parse(const QString& filePath) override;
+    IMapSource* parse(QIODevice* device, const QString& sourceName) override;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_TILEPACKPARSER_H
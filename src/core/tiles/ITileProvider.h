@@ -0,0 +1,59 @@
+#ifndef YEFS_ITILEPROVIDER_H
+#define YEFS_ITILEPROVIDER_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+namespace YEFS {
+
+/**
+ * @brief 本地瓦片数据提供者接口
+ *
+ * LocalTileServer 通过它取得已编码的瓦片字节（PNG/JPEG/WebP 图像或 MVT），
+ * tileData() 会在线程池中并发调用，实现必须线程安全。
+ * 数据来自异步来源（如在线瓦片代理）的提供者改为重写 requestTileData()。
+ */
+class ITileProvider
+{
+public:
+    virtual ~ITileProvider() = default;
+
+    // 瓦片不存在或为空时返回空数组
+    virtual QByteArray tileData(int z, int x, int y) = 0;
+
+    // 异步取得瓦片：在 LocalTileServer 所在的 GUI 线程调用，取得数据后调用 done（可在任意线程），
+    // 返回 true。默认返回 false，由 LocalTileServer 在线程池中调用 tileData()
+    using DataCallback = std::function<void(const QByteArray& data)>;
+    virtual bool requestTileData(int z, int x, int y, const DataCallback& done) {
+        Q_UNUSED(z)
+        Q_UNUSED(x)
+        Q_UNUSED(y)
+        Q_UNUSED(done)
+        return false;
+    }
+
+    virtual QByteArray contentType() const = 0;
+    virtual QString fileExtension() const = 0;
+
+    // 瓦片数据本身已压缩时（如 gzip 的 MVT）返回对应的 Content-Encoding
+    virtual QByteArray contentEncoding() const { return QByteArray(); }
+
+    // MBTiles 风格的 format 字段（png/jpg/webp/pbf）对应的 Content-Type
+    static QByteArray contentTypeForFormat(const QString& format) {
+        if (format == QLatin1String("jpg") || format == QLatin1String("jpeg")) {
+            return QByteArrayLiteral("image/jpeg");
+        }
+        if (format == QLatin1String("webp")) {
+            return QByteArrayLiteral("image/webp");
+        }
+        if (format == QLatin1String("pbf") || format == QLatin1String("mvt")) {
+            return QByteArrayLiteral("application/x-protobuf");
+        }
+        return QByteArrayLiteral("image/png");
+    }
+};
+
+} // namespace YEFS
+
+#endif // YEFS_ITILEPROVIDER_H
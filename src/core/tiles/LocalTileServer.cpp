@@ -0,0 +1,243 @@
+#include "LocalTileServer.h"
+#include <QDebug>
+#include <QHostAddress>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QUrl>
+
+namespace YEFS {
+
+namespace {
+
+constexpr qsizetype kMaxHeaderBytes = 16 * 1024;
+
+QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return QByteArrayLiteral("OK");
+    case 204: return QByteArrayLiteral("No Content");
+    case 400: return QByteArrayLiteral("Bad Request");
+    case 403: return QByteArrayLiteral("Forbidden");
+    case 404: return QByteArrayLiteral("Not Found");
+    case 405: return QByteArrayLiteral("Method Not Allowed");
+    default:  return QByteArrayLiteral("Error");
+    }
+}
+
+QByteArray generateToken()
+{
+    quint32 words[4];
+    QRandomGenerator::system()->fillRange(words);
+    return QByteArray(reinterpret_cast<const char*>(words), sizeof(words)).toHex();
+}
+
+} // namespace
+
+LocalTileServer* LocalTileServer::s_instance = nullptr;
+
+LocalTileServer::LocalTileServer(QObject* parent)
+    : QObject(parent)
+    , m_token(generateToken())
+{
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() - 1));
+}
+
+LocalTileServer* LocalTileServer::instance()
+{
+    if (!s_instance) {
+        s_instance = new LocalTileServer();
+    }
+    return s_instance;
+}
+
+bool LocalTileServer::ensureListening()
+{
+    if (m_server && m_server->isListening()) {
+        return true;
+    }
+    if (!m_server) {
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, &LocalTileServer::onNewConnection);
+    }
+    if (!m_server->listen(QHostAddress::LocalHost, 0)) {
+        qWarning() << "[LocalTileServer] Listen failed:" << m_server->errorString();
+        return false;
+    }
+    qDebug() << "[LocalTileServer] Listening on port" << m_server->serverPort();
+    return true;
+}
+
+quint16 LocalTileServer::port() const
+{
+    return m_server && m_server->isListening() ? m_server->serverPort() : 0;
+}
+
+QString LocalTileServer::tileUrlTemplate(const QString& name) const
+{
+    if (!m_tilesets.contains(name) || port() == 0) {
+        return QString();
+    }
+    return QStringLiteral("http://127.0.0.1:%1/tiles/%2/%3/{z}/{x}/{y}.%4")
+        .arg(port())
+        .arg(QString::fromLatin1(m_token))
+        .arg(QString::fromLatin1(QUrl::toPercentEncoding(name)))
+        .arg(m_tilesets.value(name)->fileExtension());
+}
+
+QString LocalTileServer::addTileset(const QString& name, std::shared_ptr<ITileProvider> provider)
+{
+    if (!provider || !ensureListening()) {
+        return QString();
+    }
+    m_tilesets.insert(name, std::move(provider));
+    qDebug() << "[LocalTileServer] Tileset added:" << name;
+    return tileUrlTemplate(name);
+}
+
+void LocalTileServer::removeTileset(const QString& name)
+{
+    // 正在切片的任务持有 shared_ptr，完成后自行释放
+    if (m_tilesets.remove(name)) {
+        qDebug() << "[LocalTileServer] Tileset removed:" << name;
+    }
+}
+
+// ============================================================================
+// HTTP 处理
+// ============================================================================
+
+void LocalTileServer::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        m_connections.insert(socket, Connection());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            auto it = m_connections.find(socket);
+            if (it == m_connections.end()) {
+                return;
+            }
+            it->buffer.append(socket->readAll());
+            processRequests(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_connections.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void LocalTileServer::processRequests(QTcpSocket* socket)
+{
+    auto it = m_connections.find(socket);
+    while (it != m_connections.end() && !it->busy) {
+        const qsizetype headerEnd = it->buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (it->buffer.size() > kMaxHeaderBytes) {
+                it->closeAfterReply = true;
+                writeResponse(socket, 400, QByteArray());
+            }
+            return;
+        }
+
+        const QByteArray header = it->buffer.left(headerEnd);
+        it->buffer.remove(0, headerEnd + 4);
+        it->closeAfterReply = header.toLower().contains("connection: close");
+
+        const QList<QByteArray> requestLine = header.left(header.indexOf("\r\n")).split(' ');
+        if (requestLine.size() < 2) {
+            it->closeAfterReply = true;
+            writeResponse(socket, 400, QByteArray());
+            return;
+        }
+        handleRequest(socket, requestLine.at(0), requestLine.at(1));
+        it = m_connections.find(socket);
+    }
+}
+
+void LocalTileServer::handleRequest(QTcpSocket* socket, const QByteArray& method,
+                                     const QByteArray& path)
+{
+    if (method != "GET") {
+        writeResponse(socket, 405, QByteArray());
+        return;
+    }
+
+    // /tiles/<token>/<name>/<z>/<x>/<y>.<ext>
+    const QList<QByteArray> segments = path.split('?').first().split('/');
+    if (segments.size() != 7 || !segments.at(0).isEmpty() || segments.at(1) != "tiles") {
+        writeResponse(socket, 404, QByteArray());
+        return;
+    }
+    // 本机其他进程不知道本次会话的令牌，不能读取瓦片
+    if (segments.at(2) != m_token) {
+        writeResponse(socket, 403, QByteArray());
+        return;
+    }
+
+    const QString name = QUrl::fromPercentEncoding(segments.at(3));
+    const auto tileset = m_tilesets.value(name);
+    bool okZ = false, okX = false, okY = false;
+    const int z = segments.at(4).toInt(&okZ);
+    const int x = segments.at(5).toInt(&okX);
+    const int y = segments.at(6).split('.').first().toInt(&okY);
+    if (!tileset || !okZ || !okX || !okY) {
+        writeResponse(socket, 404, QByteArray());
+        return;
+    }
+
+    m_connections[socket].busy = true;
+    QPointer<QTcpSocket> guard(socket);
+    // 数据可能在线程池或提供者的回调中取得，都排队回到本线程应答
+    const ITileProvider::DataCallback reply = [this, guard, tileset](const QByteArray& data) {
+        QMetaObject::invokeMethod(this, [this, guard, tileset, data]() {
+            if (!guard) {
+                return;
+            }
+            auto it = m_connections.find(guard.data());
+            if (it == m_connections.end()) {
+                return;
+            }
+            it->busy = false;
+            // 空瓦片返回 204，MapLibre 按空瓦片处理
+            writeResponse(guard.data(), data.isEmpty() ? 204 : 200, data,
+                          tileset->contentType(), tileset->contentEncoding());
+            processRequests(guard.data());
+        }, Qt::QueuedConnection);
+    };
+    if (!tileset->requestTileData(z, x, y, reply)) {
+        m_pool.start([tileset, z, x, y, reply]() {
+            reply(tileset->tileData(z, x, y));
+        });
+    }
+}
+
+void LocalTileServer::writeResponse(QTcpSocket* socket, int status, const QByteArray& body,
+                                    const QByteArray& contentType, const QByteArray& contentEncoding)
+{
+    const bool close = m_connections.value(socket).closeAfterReply;
+
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n";
+    if (status == 200) {
+        response += "Content-Type: " + contentType + "\r\n";
+        if (!contentEncoding.isEmpty()) {
+            response += "Content-Encoding: " + contentEncoding + "\r\n";
+        }
+    }
+    // 204 不能带消息体，也不发送 Content-Length
+    if (status != 204) {
+        response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    }
+    // 数据集可能以同名重新注册，不让 MapLibre 缓存
+    response += "Cache-Control: no-cache\r\n";
+    response += close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    response += body;
+
+    socket->write(response);
+    if (close) {
+        socket->disconnectFromHost();
+    }
+}
+
+} // namespace YEFS
@@ -0,0 +1,70 @@
+#ifndef YEFS_LOCALTILESERVER_H
+#define YEFS_LOCALTILESERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <memory>
+
+#include "ITileProvider.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+namespace YEFS {
+
+/**
+ * @brief 本地瓦片服务
+ *
+ * 在 127.0.0.1 的随机端口上提供 /tiles/<token>/<name>/{z}/{x}/{y}.<ext>，
+ * token 为每次运行随机生成的会话令牌（令牌不符时返回 403），
+ * 供 MapLibre 作为 vector/raster 数据源按需请求。瓦片数据来自 ITileProvider
+ * （矢量切片器、离线瓦片包等），在线程池中生成，
+ * 同一连接上的请求按顺序应答（支持 keep-alive）。只能在 GUI 线程调用。
+ */
+class LocalTileServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LocalTileServer* instance();
+
+    // 注册瓦片集，返回 MapLibre 使用的瓦片 URL 模板；监听失败时返回空字符串
+    QString addTileset(const QString& name, std::shared_ptr<ITileProvider> provider);
+    void removeTileset(const QString& name);
+    bool hasTileset(const QString& name) const { return m_tilesets.contains(name); }
+
+    QString tileUrlTemplate(const QString& name) const;
+    quint16 port() const;
+
+private:
+    explicit LocalTileServer(QObject* parent = nullptr);
+    ~LocalTileServer() override = default;
+
+    bool ensureListening();
+    void onNewConnection();
+    void processRequests(QTcpSocket* socket);
+    void handleRequest(QTcpSocket* socket, const QByteArray& method, const QByteArray& path);
+    void writeResponse(QTcpSocket* socket, int status, const QByteArray& body,
+                       const QByteArray& contentType = QByteArray(),
+                       const QByteArray& contentEncoding = QByteArray());
+
+    struct Connection {
+        QByteArray buffer;
+        bool busy = false;          // 正在切片，后续请求等待
+        bool closeAfterReply = false;
+    };
+
+    static LocalTileServer* s_instance;
+
+    QTcpServer* m_server = nullptr;
+    QHash<QTcpSocket*, Connection> m_connections;
+    QThreadPool m_pool;
+    QHash<QString, std::shared_ptr<ITileProvider>> m_tilesets;
+    QByteArray m_token;             // 会话令牌（十六进制）
+};
+
+} // namespace YEFS
+
+#endif // YEFS_LOCALTILESERVER_H
@@ -0,0 +1,116 @@
+#include "LocalTileSource.h"
+#include "ITileProvider.h"
+#include "LocalTileServer.h"
+#include <QJsonArray>
+
+namespace YEFS {
+
+LocalTileSource::LocalTileSource(const QString& id, const QString& name,
+                                 std::shared_ptr<ITileProvider> provider, const QJsonObject& metadata,
+                                 QObject* parent)
+    : IRasterMapSource(parent)
+    , m_id(id)
+    , m_name(name)
+    , m_provider(std::move(provider))
+    , m_metadata(metadata)
+{
+}
+
+LocalTileSource::~LocalTileSource()
+{
+    if (!m_tileUrlTemplate.isEmpty()) {
+        LocalTileServer::instance()->removeTileset(m_id);
+    }
+}
+
+QString LocalTileSource::description() const
+{
+    return m_metadata.value(QStringLiteral("description")).toString();
+}
+
+QGeoRectangle LocalTileSource::bounds() const
+{
+    const QJsonArray bounds = m_metadata.value(QStringLiteral("bounds")).toArray();
+    if (bounds.size() != 4) {
+        return QGeoRectangle(QGeoCoordinate(85.0, -180.0), QGeoCoordinate(-85.0, 180.0));
+    }
+    return QGeoRectangle(QGeoCoordinate(bounds.at(3).toDouble(), bounds.at(0).toDouble()),
+                         QGeoCoordinate(bounds.at(1).toDouble(), bounds.at(2).toDouble()));
+}
+
+int LocalTileSource::minZoom() const
+{
+    return m_metadata.value(QStringLiteral("minzoom")).toInt(0);
+}
+
+int LocalTileSource::maxZoom() const
+{
+    return m_metadata.value(QStringLiteral("maxzoom")).toInt(18);
+}
+
+QString LocalTileSource::format() const
+{
+    return m_metadata.value(QStringLiteral("format")).toString(QStringLiteral("png"));
+}
+
+int LocalTileSource::tileSize() const
+{
+    return m_metadata.value(QStringLiteral("tileSize")).toInt(256);
+}
+
+bool LocalTileSource::isVector() const
+{
+    const QString fmt = format();
+    return fmt == QLatin1String("pbf") || fmt == QLatin1String("mvt");
+}
+
+QImage LocalTileSource::tile(int z, int x, int y) const
+{
+    if (isVector()) {
+        return QImage();
+    }
+    const QByteArray data = m_provider->tileData(z, x, y);
+    return data.isEmpty() ? QImage() : QImage::fromData(data);
+}
+
+QString LocalTileSource::ensureTileUrlTemplate() const
+{
+    if (m_tileUrlTemplate.isEmpty()) {
+        m_tileUrlTemplate = LocalTileServer::instance()->addTileset(m_id, m_provider);
+    }
+    return m_tileUrlTemplate;
+}
+
+QString LocalTileSource::tileUrl(int z, int x, int y) const
+{
+    QString url = ensureTileUrlTemplate();
+    url.replace(QStringLiteral("{z}"), QString::number(z));
+    url.replace(QStringLiteral("{x}"), QString::number(x));
+    url.replace(QStringLiteral("{y}"), QString::number(y));
+    return url;
+}
+
+QVariantMap LocalTileSource::toMapLibreLayer() const
+{
+    const QString type = isVector() ? QStringLiteral("vector") : QStringLiteral("raster");
+
+    QVariantMap layer;
+    layer["id"] = m_id;
+    layer["type"] = type;
+
+    QVariantMap source;
+    source["type"] = type;
+    source["tiles"] = QStringList{ensureTileUrlTemplate()};
+    if (!isVector()) {
+        source["tileSize"] = tileSize();
+    }
+    source["minzoom"] = minZoom();
+    source["maxzoom"] = maxZoom();
+    source["attribution"] = m_metadata.value(QStringLiteral("attribution")).toString();
+
+    layer["source"] = source;
+
+    return layer;
+}
+
+} // namespace YEFS
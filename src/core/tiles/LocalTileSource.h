@@ -0,0 +1,65 @@
+#ifndef YEFS_LOCALTILESOURCE_H
+#define YEFS_LOCALTILESOURCE_H
+
+#include "../IMapSource.h"
+#include <QJsonObject>
+#include <memory>
+
+namespace YEFS {
+
+class ITileProvider;
+
+/**
+ * @brief 本地瓦片数据源
+ *
+ * 离线瓦片包、MBTiles 等本地瓦片文件共用的数据源，瓦片来自 ITileProvider，不访问网络。
+ * 元数据沿用 MBTiles 的字段：name、format、bounds（[west, south, east, north]）、
+ * minzoom、maxzoom、attribution、description、tileSize。
+ * MapLibre 通过 LocalTileServer 按 z/x/y 请求瓦片；首次调用 toMapLibreLayer()
+ * 或 tileUrl() 时注册（须在 GUI 线程），数据源销毁时注销。
+ */
+class LocalTileSource : public IRasterMapSource
+{
+    Q_OBJECT
+
+public:
+    explicit LocalTileSource(const QString& id, const QString& name,
+                             std::shared_ptr<ITileProvider> provider, const QJsonObject& metadata,
+                             QObject* parent = nullptr);
+    ~LocalTileSource() override;
+
+    // IMapSource 接口实现
+    QString id() const override { return m_id; }
+    QString name() const override { return m_name; }
+    QString description() const override;
+    bool isLoaded() const override { return true; }
+    bool isValid() const override { return m_provider != nullptr; }
+    QGeoRectangle bounds() const override;
+    int minZoom() const override;
+    int maxZoom() const override;
+
+    // IRasterMapSource 接口实现
+    QImage tile(int z, int x, int y) const override;
+    QString tileUrl(int z, int x, int y) const override;
+    QString format() const override;
+    int tileSize() const override;
+
+    // 数据访问
+    QVariantMap toMapLibreLayer() const override;
+
+    QJsonObject metadata() const { return m_metadata; }
+    bool isVector() const;
+
+private:
+    QString ensureTileUrlTemplate() const;
+
+    QString m_id;
+    QString m_name;
+    std::shared_ptr<ITileProvider> m_provider;
+    QJsonObject m_metadata;
+    mutable QString m_tileUrlTemplate;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_LOCALTILESOURCE_H
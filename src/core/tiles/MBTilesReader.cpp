@@ -0,0 +1,267 @@
+#include "MBTilesReader.h"
+#include "TileMath.h"
+#include <QDebug>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+#include <cstring>
+#include <limits>
+
+namespace YEFS {
+
+namespace {
+
+constexpr char kSQLiteMagic[16] = {'S', 'Q', 'L', 'i', 't', 'e', ' ', 'f',
+                                   'o', 'r', 'm', 'a', 't', ' ', '3', '\0'};
+
+const QString kTileQuery = QStringLiteral(
+    "SELECT tile_data FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+
+bool openConnection(const QString& connectionName, const QString& filePath, QString* error)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName);
+    db.setDatabaseName(filePath);
+    db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+    if (!db.open()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        return false;
+    }
+    return true;
+}
+
+void closeConnection(const QString& connectionName)
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+// 某个线程中某个读取器的连接
+struct ThreadConnection {
+    QString name;
+    std::weak_ptr<int> owner;
+    std::unique_ptr<QSqlQuery> query;
+
+    ~ThreadConnection() {
+        query.reset();
+        closeConnection(name);
+    }
+};
+
+// 线程结束时析构，关闭该线程打开的全部连接
+QHash<quint64, std::shared_ptr<ThreadConnection>>& threadConnections()
+{
+    thread_local QHash<quint64, std::shared_ptr<ThreadConnection>> connections;
+    return connections;
+}
+
+QJsonArray parseBounds(const QString& text)
+{
+    const QStringList parts = text.split(QLatin1Char(','));
+    if (parts.size() != 4) {
+        return QJsonArray();
+    }
+    QJsonArray bounds;
+    for (const QString& part : parts) {
+        bool ok = false;
+        const double value = part.trimmed().toDouble(&ok);
+        if (!ok) {
+            return QJsonArray();
+        }
+        bounds.append(value);
+    }
+    return bounds;
+}
+
+} // namespace
+
+std::atomic<quint64> MBTilesReader::s_nextSerial{1};
+
+MBTilesReader::MBTilesReader(const QString& filePath, qint64 cacheBytes)
+    : m_filePath(filePath)
+    , m_serial(s_nextSerial.fetch_add(1))
+    , m_alive(std::make_shared<int>(0))
+{
+    m_cache.setMaxCost(int(qBound<qint64>(0, cacheBytes, std::numeric_limits<int>::max())));
+
+    if (!QSqlDatabase::isDriverAvailable(QStringLiteral("QSQLITE"))) {
+        m_errorString = QStringLiteral("缺少 SQLite 数据库驱动");
+        return;
+    }
+    m_valid = readMetadata();
+}
+
+MBTilesReader::~MBTilesReader()
+{
+    // 其他线程的连接在它们下次访问或线程结束时关闭
+    m_alive.reset();
+    threadConnections().remove(m_serial);
+}
+
+bool MBTilesReader::isSQLite(QByteArrayView data)
+{
+    return data.size() >= qsizetype(sizeof(kSQLiteMagic))
+        && std::memcmp(data.data(), kSQLiteMagic, sizeof(kSQLiteMagic)) == 0;
+}
+
+bool MBTilesReader::readMetadata()
+{
+    const QString connectionName = QStringLiteral("yefs-mbtiles-probe-%1").arg(m_serial);
+    bool ok = false;
+    if (!openConnection(connectionName, m_filePath, &m_errorString)) {
+        closeConnection(connectionName);
+        return false;
+    }
+
+    {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        QSqlQuery query(db);
+        if (!query.exec(QStringLiteral("SELECT name, value FROM metadata"))) {
+            m_errorString = QStringLiteral("不是有效的 MBTiles 文件: %1").arg(query.lastError().text());
+        } else {
+            QJsonObject metadata;
+            while (query.next()) {
+                const QString name = query.value(0).toString();
+                const QString value = query.value(1).toString();
+                if (name == QLatin1String("bounds")) {
+                    const QJsonArray bounds = parseBounds(value);
+                    if (!bounds.isEmpty()) {
+                        metadata.insert(name, bounds);
+                    }
+                } else if (name == QLatin1String("minzoom") || name == QLatin1String("maxzoom")) {
+                    metadata.insert(name, value.toInt());
+                } else if (name == QLatin1String("json")) {
+                    // 矢量瓦片的图层说明（vector_layers）
+                    metadata.insert(name, QJsonDocument::fromJson(value.toUtf8()).object());
+                } else {
+                    metadata.insert(name, value);
+                }
+            }
+
+            // 缺少级别范围时从瓦片表统计（zoom_level 上有索引）
+            if (!metadata.contains(QStringLiteral("minzoom")) || !metadata.contains(QStringLiteral("maxzoom"))) {
+                if (query.exec(QStringLiteral("SELECT MIN(zoom_level), MAX(zoom_level) FROM tiles"))
+                    && query.next() && !query.value(0).isNull()) {
+                    metadata.insert(QStringLiteral("minzoom"), query.value(0).toInt());
+                    metadata.insert(QStringLiteral("maxzoom"), query.value(1).toInt());
+                }
+            }
+
+            // 规范要求矢量瓦片 gzip 压缩，但并非所有工具都遵守，按实际数据判断
+            if (query.exec(QStringLiteral("SELECT tile_data FROM tiles LIMIT 1"))) {
+                ok = true;
+                if (query.next()) {
+                    const QByteArray sample = query.value(0).toByteArray();
+                    if (sample.startsWith("\x1f\x8b")) {
+                        m_contentEncoding = QByteArrayLiteral("gzip");
+                    }
+                }
+            } else {
+                m_errorString = QStringLiteral("不是有效的 MBTiles 文件: %1").arg(query.lastError().text());
+            }
+            m_metadata = metadata;
+        }
+    }
+
+    closeConnection(connectionName);
+    if (ok) {
+        qDebug() << "[MBTilesReader] Opened" << m_filePath << "format:" << format()
+                 << "zoom:" << m_metadata.value(QStringLiteral("minzoom")).toInt()
+                 << "-" << m_metadata.value(QStringLiteral("maxzoom")).toInt();
+    }
+    return ok;
+}
+
+QString MBTilesReader::format() const
+{
+    return m_metadata.value(QStringLiteral("format")).toString(QStringLiteral("png"));
+}
+
+QSqlQuery* MBTilesReader::threadQuery()
+{
+    auto& connections = threadConnections();
+    if (const auto existing = connections.value(m_serial)) {
+        return existing->query.get();
+    }
+
+    // 顺便关闭本线程中已销毁读取器留下的连接
+    connections.removeIf([](const QHash<quint64, std::shared_ptr<ThreadConnection>>::iterator it) {
+        return it.value()->owner.expired();
+    });
+
+    auto connection = std::make_shared<ThreadConnection>();
+    connection->name = QStringLiteral("yefs-mbtiles-%1-%2")
+        .arg(m_serial)
+        .arg(quintptr(QThread::currentThreadId()));
+    connection->owner = m_alive;
+
+    QString error;
+    if (!openConnection(connection->name, m_filePath, &error)) {
+        qWarning() << "[MBTilesReader] Cannot open" << m_filePath << error;
+        return nullptr;     // connection 析构时移除连接
+    }
+    connection->query = std::make_unique<QSqlQuery>(QSqlDatabase::database(connection->name, false));
+    connection->query->setForwardOnly(true);
+    if (!connection->query->prepare(kTileQuery)) {
+        qWarning() << "[MBTilesReader] Prepare failed:" << connection->query->lastError().text();
+        return nullptr;
+    }
+
+    connections.insert(m_serial, connection);
+    return connection->query.get();
+}
+
+QByteArray MBTilesReader::queryTile(int z, int x, int y)
+{
+    QSqlQuery* query = threadQuery();
+    if (!query) {
+        return QByteArray();
+    }
+
+    query->bindValue(0, z);
+    query->bindValue(1, x);
+    query->bindValue(2, (1 << z) - 1 - y);      // TMS 行号自下而上
+    QByteArray data;
+    if (query->exec() && query->next()) {
+        data = query->value(0).toByteArray();
+    } else if (query->lastError().isValid()) {
+        qWarning() << "[MBTilesReader] Query failed:" << query->lastError().text();
+    }
+    query->finish();
+    return data;
+}
+
+QByteArray MBTilesReader::tile(int z, int x, int y)
+{
+    if (!m_valid || !TileMath::isValidTile(z, x, y)) {
+        return QByteArray();
+    }
+
+    const quint64 key = TileMath::tileKey(z, x, y);
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QByteArray* cached = m_cache.object(key)) {
+            return *cached;
+        }
+    }
+
+    // 查询不持锁，各线程使用自己的连接并行读取
+    const QByteArray data = queryTile(z, x, y);
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.insert(key, new QByteArray(data), data.size() + 64);
+    return data;
+}
+
+} // namespace YEFS
@@ -0,0 +1,76 @@
+#ifndef YEFS_MBTILESREADER_H
+#define YEFS_MBTILESREADER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QCache>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+#include "ITileProvider.h"
+
+class QSqlQuery;
+
+namespace YEFS {
+
+/**
+ * @brief MBTiles 瓦片读取器
+ *
+ * 以只读方式打开 MBTiles（SQLite）文件。QSqlDatabase 连接只能在创建它的线程中使用，
+ * 因此每个调用线程各自打开一个连接并缓存预编译的查询语句，连接随线程结束或下次访问时
+ * 发现读取器已销毁而关闭。最近读取的瓦片（包括不存在的瓦片）进入按字节计的 LRU。
+ * tileData() 可在多个线程中同时调用。
+ */
+class MBTilesReader : public ITileProvider
+{
+public:
+    explicit MBTilesReader(const QString& filePath, qint64 cacheBytes = 32 * 1024 * 1024);
+    ~MBTilesReader() override;
+
+    bool isValid() const { return m_valid; }
+    QString filePath() const { return m_filePath; }
+    QString errorString() const { return m_errorString; }
+
+    // 规范化后的元数据：bounds 为 [west, south, east, north] 数组，minzoom/maxzoom 为整数
+    QJsonObject metadata() const { return m_metadata; }
+    QString format() const;
+
+    // z/x/y 为 XYZ 方案（原点在左上），内部换算为 MBTiles 的 TMS 行号
+    QByteArray tile(int z, int x, int y);
+
+    // ITileProvider 接口实现
+    QByteArray tileData(int z, int x, int y) override { return tile(z, x, y); }
+    QByteArray contentType() const override { return contentTypeForFormat(format()); }
+    QString fileExtension() const override { return format(); }
+    QByteArray contentEncoding() const override { return m_contentEncoding; }
+
+    // SQLite 文件头
+    static bool isSQLite(QByteArrayView data);
+
+private:
+    bool readMetadata();
+    QByteArray queryTile(int z, int x, int y);
+
+    // 当前线程的连接中预编译的瓦片查询，打开失败时返回 nullptr
+    QSqlQuery* threadQuery();
+
+    QString m_filePath;
+    quint64 m_serial = 0;                       // 区分线程连接所属的读取器
+    std::shared_ptr<int> m_alive;               // 线程连接通过 weak_ptr 判断读取器是否已销毁
+    QJsonObject m_metadata;
+    QByteArray m_contentEncoding;
+    bool m_valid = false;
+    QString m_errorString;
+
+    QMutex m_cacheMutex;
+    QCache<quint64, QByteArray> m_cache;
+
+    static std::atomic<quint64> s_nextSerial;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_MBTILESREADER_H
@@ -0,0 +1,220 @@
+#include "MvtEncoder.h"
+#include <QtMath>
+#include <cstring>
+
+namespace YEFS {
+
+namespace {
+
+// protobuf 线格式
+enum WireType : quint8 {
+    Varint = 0,
+    Fixed64 = 1,
+    LengthDelimited = 2
+};
+
+void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+void writeTag(QByteArray& out, int field, WireType type)
+{
+    writeVarint(out, (quint64(field) << 3) | type);
+}
+
+void writeBytes(QByteArray& out, int field, const QByteArray& bytes)
+{
+    writeTag(out, field, LengthDelimited);
+    writeVarint(out, quint64(bytes.size()));
+    out.append(bytes);
+}
+
+void writePacked(QByteArray& out, int field, const QList<quint32>& values)
+{
+    QByteArray packed;
+    for (quint32 value : values) {
+        writeVarint(packed, value);
+    }
+    writeBytes(out, field, packed);
+}
+
+quint32 zigzag(qint32 value)
+{
+    return (quint32(value) << 1) ^ quint32(value >> 31);
+}
+
+quint32 command(int id, int count)
+{
+    return quint32(id & 0x7) | (quint32(count) << 3);
+}
+
+} // namespace
+
+MvtEncoder::MvtEncoder(const QString& layerName, int extent)
+    : m_layerName(layerName)
+    , m_extent(extent)
+{
+}
+
+quint32 MvtEncoder::keyIndex(const QString& key)
+{
+    auto it = m_keyIndex.constFind(key);
+    if (it != m_keyIndex.constEnd()) {
+        return it.value();
+    }
+    const quint32 index = quint32(m_keys.size());
+    m_keys.append(key);
+    m_keyIndex.insert(key, index);
+    return index;
+}
+
+quint32 MvtEncoder::valueIndex(const QVariant& value)
+{
+    // Value 消息：1 string，3 double，6 sint64，7 bool
+    QByteArray encoded;
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        writeTag(encoded, 7, Varint);
+        writeVarint(encoded, value.toBool() ? 1 : 0);
+        break;
+
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double number = value.toDouble();
+        if (number == std::floor(number) && qAbs(number) < 9007199254740992.0) {
+            const qint64 integer = qint64(number);
+            writeTag(encoded, 6, Varint);
+            writeVarint(encoded, (quint64(integer) << 1) ^ quint64(integer >> 63));
+        } else {
+            quint64 bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            writeTag(encoded, 3, Fixed64);
+            for (int i = 0; i < 8; ++i) {
+                encoded.append(char((bits >> (8 * i)) & 0xFF));
+            }
+        }
+        break;
+    }
+
+    default:
+        writeBytes(encoded, 1, value.toString().toUtf8());
+        break;
+    }
+
+    auto it = m_valueIndex.constFind(encoded);
+    if (it != m_valueIndex.constEnd()) {
+        return it.value();
+    }
+    const quint32 index = quint32(m_values.size());
+    m_values.append(encoded);
+    m_valueIndex.insert(encoded, index);
+    return index;
+}
+
+void MvtEncoder::addFeature(GeomType type, const QList<QPolygon>& parts,
+                            const QVariantMap& properties, quint64 id)
+{
+    // 几何命令：1 MoveTo，2 LineTo，7 ClosePath，参数为相对上一点的 zigzag 增量
+    QList<quint32> geometry;
+    QPoint cursor(0, 0);
+    auto appendPoint = [&geometry, &cursor](const QPoint& point) {
+        geometry.append(zigzag(point.x() - cursor.x()));
+        geometry.append(zigzag(point.y() - cursor.y()));
+        cursor = point;
+    };
+
+    if (type == Point) {
+        int count = 0;
+        for (const QPolygon& part : parts) {
+            count += part.size();
+        }
+        if (count == 0) {
+            return;
+        }
+        geometry.append(command(1, count));
+        for (const QPolygon& part : parts) {
+            for (const QPoint& point : part) {
+                appendPoint(point);
+            }
+        }
+    } else {
+        for (const QPolygon& part : parts) {
+            // 多边形的环不重复写闭合点
+            const int count = type == Polygon ? part.size() - 1 : part.size();
+            if (count < (type == Polygon ? 3 : 2)) {
+                continue;
+            }
+            geometry.append(command(1, 1));
+            appendPoint(part.first());
+            geometry.append(command(2, count - 1));
+            for (int i = 1; i < count; ++i) {
+                appendPoint(part.at(i));
+            }
+            if (type == Polygon) {
+                geometry.append(command(7, 1));
+            }
+        }
+        if (geometry.isEmpty()) {
+            return;
+        }
+    }
+
+    QList<quint32> tags;
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        if (it.value().isNull()) {
+            continue;
+        }
+        tags.append(keyIndex(it.key()));
+        tags.append(valueIndex(it.value()));
+    }
+
+    // Feature 消息：1 id，2 tags，3 type，4 geometry
+    QByteArray feature;
+    if (id != 0) {
+        writeTag(feature, 1, Varint);
+        writeVarint(feature, id);
+    }
+    if (!tags.isEmpty()) {
+        writePacked(feature, 2, tags);
+    }
+    writeTag(feature, 3, Varint);
+    writeVarint(feature, type);
+    writePacked(feature, 4, geometry);
+
+    writeBytes(m_features, 2, feature);
+    ++m_featureCount;
+}
+
+QByteArray MvtEncoder::encode() const
+{
+    // Layer 消息：15 version，1 name，2 features，3 keys，4 values，5 extent
+    QByteArray layer;
+    writeTag(layer, 15, Varint);
+    writeVarint(layer, 2);
+    writeBytes(layer, 1, m_layerName.toUtf8());
+    layer.append(m_features);
+    for (const QString& key : m_keys) {
+        writeBytes(layer, 3, key.toUtf8());
+    }
+    for (const QByteArray& value : m_values) {
+        writeBytes(layer, 4, value);
+    }
+    writeTag(layer, 5, Varint);
+    writeVarint(layer, quint64(m_extent));
+
+    // Tile 消息：3 layers
+    QByteArray tile;
+    writeBytes(tile, 3, layer);
+    return tile;
+}
+
+} // namespace YEFS
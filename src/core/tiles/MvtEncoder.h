@@ -0,0 +1,57 @@
+#ifndef YEFS_MVTENCODER_H
+#define YEFS_MVTENCODER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPolygon>
+#include <QString>
+#include <QVariantMap>
+
+namespace YEFS {
+
+/**
+ * @brief Mapbox Vector Tile（MVT 2.1）编码器
+ *
+ * 生成只包含一个图层的瓦片。几何使用瓦片坐标（0 ~ extent，y 轴向下），
+ * 属性键和值在图层内去重。直接手写 protobuf 线格式，不依赖 protobuf 库。
+ */
+class MvtEncoder
+{
+public:
+    enum GeomType : quint8 {
+        Point = 1,
+        LineString = 2,
+        Polygon = 3
+    };
+
+    MvtEncoder(const QString& layerName, int extent);
+
+    // Point：每个部件的所有点；LineString：每个部件一条线；
+    // Polygon：环需闭合，外环为顺时针（y 向下坐标系中面积为正），其后紧跟它的内环
+    void addFeature(GeomType type, const QList<QPolygon>& parts,
+                    const QVariantMap& properties, quint64 id = 0);
+
+    bool isEmpty() const { return m_featureCount == 0; }
+    int featureCount() const { return m_featureCount; }
+
+    QByteArray encode() const;
+
+private:
+    quint32 keyIndex(const QString& key);
+    quint32 valueIndex(const QVariant& value);
+
+    QString m_layerName;
+    int m_extent;
+    int m_featureCount = 0;
+
+    QByteArray m_features;          // 已编码的 Feature 消息（含字段头）
+    QList<QString> m_keys;
+    QHash<QString, quint32> m_keyIndex;
+    QList<QByteArray> m_values;     // 已编码的 Value 消息体
+    QHash<QByteArray, quint32> m_valueIndex;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_MVTENCODER_H
@@ -0,0 +1,482 @@
+#include "OfflinePackDownloader.h"
+#include "TileMath.h"
+#include "../OnlineMapProvider.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace YEFS {
+
+namespace {
+
+constexpr double kMetersPerNauticalMile = 1852.0;
+constexpr double kMetersPerDegreeLatitude = 111320.0;
+constexpr int kMaxAttempts = 3;
+constexpr int kRetryBaseDelayMs = 1000;     // 第 n 次重试前等待 kRetryBaseDelayMs·2^(n-1)
+constexpr int kMaxRetryDelayMs = 60000;
+constexpr int kFlushInterval = 64;
+constexpr int kMaxSamplesPerSegment = 10000;
+constexpr int kTransferTimeoutMs = 30000;
+
+double wrapLongitude(double lon)
+{
+    if (lon < -180.0) {
+        return lon + 360.0;
+    }
+    if (lon > 180.0) {
+        return lon - 360.0;
+    }
+    return lon;
+}
+
+QGeoRectangle boxAround(const QGeoCoordinate& center, double halfSizeMeters)
+{
+    const double dLat = halfSizeMeters / kMetersPerDegreeLatitude;
+    const double cosLat = qMax(0.01, std::cos(qDegreesToRadians(center.latitude())));
+    const double dLon = halfSizeMeters / (kMetersPerDegreeLatitude * cosLat);
+    const double north = qMin(90.0, center.latitude() + dLat);
+    const double south = qMax(-90.0, center.latitude() - dLat);
+    if (dLon >= 180.0) {
+        return QGeoRectangle(QGeoCoordinate(north, -180.0), QGeoCoordinate(south, 180.0));
+    }
+    // 越过 180° 经线的一侧绕回，得到西边界大于东边界的矩形
+    return QGeoRectangle(QGeoCoordinate(north, wrapLongitude(center.longitude() - dLon)),
+                         QGeoCoordinate(south, wrapLongitude(center.longitude() + dLon)));
+}
+
+// 区域在级别 z 覆盖的列范围；跨越 180° 经线（西边界大于东边界）时分成两段
+QList<std::pair<int, int>> columnRanges(const QGeoRectangle& area, int z)
+{
+    const double west = area.topLeft().longitude();
+    const double east = area.bottomRight().longitude();
+    const int x0 = TileMath::tileIndex(TileMath::lonToX(west), z);
+    const int x1 = TileMath::tileIndex(TileMath::lonToX(east), z);
+    if (west <= east) {
+        return {{x0, x1}};
+    }
+    const int last = (1 << z) - 1;
+    if (x0 <= x1) {
+        return {{0, last}};     // 两段在该级别已连成整圈
+    }
+    return {{x0, last}, {0, x1}};
+}
+
+QGeoCoordinate toCoordinate(const QVariant& value)
+{
+    if (value.canConvert<QGeoCoordinate>()) {
+        return value.value<QGeoCoordinate>();
+    }
+    const QVariantMap map = value.toMap();
+    return QGeoCoordinate(map.value(QStringLiteral("latitude")).toDouble(),
+                          map.value(QStringLiteral("longitude")).toDouble());
+}
+
+} // namespace
+
+OfflinePackDownloader::OfflinePackDownloader(QObject* parent)
+    : QObject(parent)
+    , m_network(new QNetworkAccessManager(this))
+{
+    // 批量下载不经过 TileFetcher 的磁盘缓存，避免挤掉浏览时的瓦片
+    m_network->setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    m_network->setTransferTimeout(kTransferTimeoutMs);
+}
+
+OfflinePackDownloader::~OfflinePackDownloader()
+{
+    if (m_running) {
+        cancel();
+    }
+}
+
+double OfflinePackDownloader::progress() const
+{
+    return m_queue.isEmpty() ? 0.0 : double(m_completed + m_failed) / m_queue.size();
+}
+
+void OfflinePackDownloader::setMaxConcurrentDownloads(int count)
+{
+    count = qBound(1, count, 16);
+    if (m_maxConcurrent == count) {
+        return;
+    }
+    m_maxConcurrent = count;
+    emit maxConcurrentDownloadsChanged();
+    if (m_running) {
+        startNext();
+    }
+}
+
+// ============================================================================
+// 瓦片范围
+// ============================================================================
+
+bool OfflinePackDownloader::appendAreaTiles(const QGeoRectangle& area, int minZoom, int maxZoom,
+                                            QSet<quint64>& seen, QList<TileRequest>& tiles)
+{
+    for (int z = minZoom; z <= maxZoom; ++z) {
+        const int y0 = TileMath::tileIndex(TileMath::latToY(area.topLeft().latitude()), z);
+        const int y1 = TileMath::tileIndex(TileMath::latToY(area.bottomRight().latitude()), z);
+        for (const auto& [x0, x1] : columnRanges(area, z)) {
+            for (int x = x0; x <= x1; ++x) {
+                for (int y = y0; y <= y1; ++y) {
+                    if (seen.contains(TileMath::tileKey(z, x, y))) {
+                        continue;
+                    }
+                    if (tiles.size() >= MaxTiles) {
+                        return false;
+                    }
+                    seen.insert(TileMath::tileKey(z, x, y));
+                    tiles.append({z, x, y, 0});
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int OfflinePackDownloader::countAreaTiles(const QGeoRectangle& area, int minZoom, int maxZoom) const
+{
+    if (!area.isValid()) {
+        return 0;
+    }
+    minZoom = qBound(0, minZoom, TileMath::MaxZoom);
+    maxZoom = qBound(minZoom, maxZoom, TileMath::MaxZoom);
+
+    qint64 count = 0;
+    for (int z = minZoom; z <= maxZoom && count <= MaxTiles; ++z) {
+        qint64 columns = 0;
+        for (const auto& [x0, x1] : columnRanges(area, z)) {
+            columns += x1 - x0 + 1;
+        }
+        const qint64 rows = TileMath::tileIndex(TileMath::latToY(area.bottomRight().latitude()), z)
+                          - TileMath::tileIndex(TileMath::latToY(area.topLeft().latitude()), z) + 1;
+        count += columns * rows;
+    }
+    return int(qMin<qint64>(count, std::numeric_limits<int>::max()));
+}
+
+// ============================================================================
+// 下载
+// ============================================================================
+
+bool OfflinePackDownloader::downloadArea(OnlineTileSource* source, const QGeoRectangle& area,
+                                         int minZoom, int maxZoom, const QString& packPath)
+{
+    if (!area.isValid()) {
+        fail(QStringLiteral("下载范围无效"));
+        return false;
+    }
+
+    minZoom = qBound(0, minZoom, TileMath::MaxZoom);
+    maxZoom = qBound(minZoom, maxZoom, TileMath::MaxZoom);
+
+    QSet<quint64> seen;
+    QList<TileRequest> tiles;
+    if (!appendAreaTiles(area, minZoom, maxZoom, seen, tiles)) {
+        fail(QStringLiteral("瓦片数量过多，请缩小范围或降低最大级别"));
+        return false;
+    }
+    return start(source, std::move(tiles), area, minZoom, maxZoom, packPath);
+}
+
+bool OfflinePackDownloader::downloadCorridor(OnlineTileSource* source, const QVariantList& route,
+                                             double bufferNauticalMiles, int minZoom, int maxZoom,
+                                             const QString& packPath)
+{
+    QList<QGeoCoordinate> coordinates;
+    coordinates.reserve(route.size());
+    for (const QVariant& point : route) {
+        coordinates.append(toCoordinate(point));
+    }
+    return downloadCorridor(source, coordinates, bufferNauticalMiles, minZoom, maxZoom, packPath);
+}
+
+bool OfflinePackDownloader::downloadCorridor(OnlineTileSource* source, const QList<QGeoCoordinate>& route,
+                                             double bufferNauticalMiles, int minZoom, int maxZoom,
+                                             const QString& packPath)
+{
+    QList<QGeoCoordinate> points;
+    for (const QGeoCoordinate& point : route) {
+        if (point.isValid()) {
+            points.append(point);
+        }
+    }
+    if (points.isEmpty() || bufferNauticalMiles <= 0) {
+        fail(QStringLiteral("航线或缓冲距离无效"));
+        return false;
+    }
+
+    minZoom = qBound(0, minZoom, TileMath::MaxZoom);
+    maxZoom = qBound(minZoom, maxZoom, TileMath::MaxZoom);
+    const double buffer = bufferNauticalMiles * kMetersPerNauticalMile;
+
+    // 沿每段航线等距取样，取样点周围的方框覆盖两侧缓冲区；
+    // 方框半宽取 buffer + step / 2，保证航线任意点缓冲范围内的位置都落在某个方框中
+    QSet<quint64> seen;
+    QList<TileRequest> tiles;
+    QGeoRectangle bounds(points.first(), points.first());
+    for (int i = 0; i < points.size(); ++i) {
+        const QGeoCoordinate& from = points.at(i);
+        const QGeoCoordinate& to = i + 1 < points.size() ? points.at(i + 1) : from;
+        const double length = from.distanceTo(to);
+        const double azimuth = from.azimuthTo(to);
+        const double step = qMax(buffer, length / kMaxSamplesPerSegment);
+        const int samples = qMax(1, int(std::ceil(length / step)));
+        const double halfSize = buffer + step / 2.0;
+
+        for (int s = 0; s <= samples; ++s) {
+            const QGeoCoordinate sample = from.atDistanceAndAzimuth(qMin(length, s * step), azimuth);
+            const QGeoRectangle box = boxAround(sample, halfSize);
+            bounds = bounds.united(box);
+            if (!appendAreaTiles(box, minZoom, maxZoom, seen, tiles)) {
+                fail(QStringLiteral("瓦片数量过多，请缩小缓冲距离或降低最大级别"));
+                return false;
+            }
+        }
+    }
+
+    // 先下载低级别，中途停止时也能得到可用的概览
+    std::stable_sort(tiles.begin(), tiles.end(), [](const TileRequest& a, const TileRequest& b) {
+        return a.z < b.z;
+    });
+    return start(source, std::move(tiles), bounds, minZoom, maxZoom, packPath);
+}
+
+bool OfflinePackDownloader::start(OnlineTileSource* source, QList<TileRequest> tiles,
+                                  const QGeoRectangle& bounds, int minZoom, int maxZoom,
+                                  const QString& packPath)
+{
+    if (m_running) {
+        fail(QStringLiteral("已有下载任务正在进行"));
+        return false;
+    }
+    if (!source || !source->isValid()) {
+        fail(QStringLiteral("在线瓦片源无效"));
+        return false;
+    }
+    if (!m_writer.open(packPath)) {
+        fail(QStringLiteral("无法打开瓦片包: %1").arg(m_writer.errorString()));
+        return false;
+    }
+
+    // 续传或向已有瓦片包追加区域时合并范围与级别
+    QGeoRectangle packBounds = bounds;
+    int packMinZoom = minZoom;
+    int packMaxZoom = maxZoom;
+    const QJsonObject previous = m_writer.metadata();
+    const QJsonArray previousBounds = previous.value(QStringLiteral("bounds")).toArray();
+    if (previousBounds.size() == 4) {
+        packBounds = packBounds.united(QGeoRectangle(
+            QGeoCoordinate(previousBounds.at(3).toDouble(), previousBounds.at(0).toDouble()),
+            QGeoCoordinate(previousBounds.at(1).toDouble(), previousBounds.at(2).toDouble())));
+        packMinZoom = qMin(packMinZoom, previous.value(QStringLiteral("minzoom")).toInt(minZoom));
+        packMaxZoom = qMax(packMaxZoom, previous.value(QStringLiteral("maxzoom")).toInt(maxZoom));
+    }
+
+    QJsonObject metadata;
+    metadata[QStringLiteral("name")] = source->name();
+    metadata[QStringLiteral("format")] = source->format();
+    metadata[QStringLiteral("tileSize")] = source->tileSize();
+    metadata[QStringLiteral("attribution")] = source->attribution();
+    metadata[QStringLiteral("bounds")] = QJsonArray{
+        packBounds.topLeft().longitude(), packBounds.bottomRight().latitude(),
+        packBounds.bottomRight().longitude(), packBounds.topLeft().latitude()
+    };
+    metadata[QStringLiteral("minzoom")] = packMinZoom;
+    metadata[QStringLiteral("maxzoom")] = packMaxZoom;
+    metadata[QStringLiteral("complete")] = false;
+    if (!m_writer.writeMetadata(metadata)) {
+        const QString message = m_writer.errorString();
+        m_writer.close();
+        fail(QStringLiteral("写入瓦片包失败: %1").arg(message));
+        return false;
+    }
+
+    m_source = source;
+    m_packPath = packPath;
+    m_queue = std::move(tiles);
+    m_next = 0;
+    m_retry.clear();
+    m_retryWaiting = 0;
+    ++m_generation;
+    m_completed = 0;
+    m_failed = 0;
+    m_sinceFlush = 0;
+    m_running = true;
+
+    qDebug() << "[OfflinePackDownloader] Downloading" << m_queue.size() << "tiles to" << packPath
+             << "existing:" << m_writer.existingCount();
+    emit runningChanged();
+    emit progressChanged();
+
+    startNext();
+    return true;
+}
+
+void OfflinePackDownloader::startNext()
+{
+    if (!m_running) {
+        return;
+    }
+    if (!m_source) {
+        fail(QStringLiteral("在线瓦片源已被移除"));
+        finish(true);
+        return;
+    }
+
+    bool skipped = false;
+    while (m_active.size() < m_maxConcurrent) {
+        TileRequest request;
+        if (!m_retry.isEmpty()) {
+            request = m_retry.takeFirst();
+        } else if (m_next < m_queue.size()) {
+            request = m_queue.at(m_next++);
+            if (m_writer.contains(request.z, request.x, request.y)) {
+                ++m_completed;      // 上次已下载
+                skipped = true;
+                continue;
+            }
+        } else {
+            break;
+        }
+
+        QNetworkRequest networkRequest(QUrl(m_source->tileUrl(request.z, request.x, request.y)));
+        networkRequest.setHeader(QNetworkRequest::UserAgentHeader,
+                                 QCoreApplication::applicationName() + QLatin1Char('/')
+                                 + QCoreApplication::applicationVersion());
+        networkRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+        QNetworkReply* reply = m_network->get(networkRequest);
+        m_active.insert(reply, request);
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            onReplyFinished(reply);
+        });
+    }
+
+    if (skipped) {
+        emit progressChanged();
+    }
+    if (m_active.isEmpty() && m_retry.isEmpty() && m_retryWaiting == 0 && m_next >= m_queue.size()) {
+        finish(false);
+    }
+}
+
+void OfflinePackDownloader::onReplyFinished(QNetworkReply* reply)
+{
+    reply->deleteLater();
+    if (!m_active.contains(reply)) {
+        return;     // 已取消
+    }
+    TileRequest request = m_active.take(reply);
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool written = false;
+    if (reply->error() == QNetworkReply::NoError) {
+        written = status == 204
+            ? m_writer.writeMissing(request.z, request.x, request.y)
+            : m_writer.writeTile(request.z, request.x, request.y, reply->readAll());
+    } else if (status == 404) {
+        // 服务端没有该瓦片（海域、超出数据范围），记为缺失，续传时不再请求
+        written = m_writer.writeMissing(request.z, request.x, request.y);
+    } else if (++request.attempts < kMaxAttempts) {
+        scheduleRetry(request, reply);
+        startNext();
+        return;
+    } else {
+        qDebug() << "[OfflinePackDownloader] Tile failed:" << request.z << request.x << request.y
+                 << reply->errorString();
+        ++m_failed;
+        emit progressChanged();
+        startNext();
+        return;
+    }
+
+    if (!written) {
+        fail(QStringLiteral("写入瓦片包失败: %1").arg(m_writer.errorString()));
+        finish(true);
+        return;
+    }
+
+    ++m_completed;
+    if (++m_sinceFlush >= kFlushInterval) {
+        m_writer.flush();
+        m_sinceFlush = 0;
+    }
+    emit progressChanged();
+    startNext();
+}
+
+void OfflinePackDownloader::scheduleRetry(const TileRequest& request, QNetworkReply* reply)
+{
+    // 指数退避，服务端给出 Retry-After（秒）时至少等待该时长
+    int delay = kRetryBaseDelayMs << (request.attempts - 1);
+    bool ok = false;
+    const int retryAfter = reply->rawHeader("Retry-After").trimmed().toInt(&ok);
+    if (ok && retryAfter > 0) {
+        delay = qMax(delay, retryAfter * 1000);
+    }
+    delay = qMin(delay, kMaxRetryDelayMs);
+
+    ++m_retryWaiting;
+    const quint64 generation = m_generation;
+    QTimer::singleShot(delay, this, [this, request, generation]() {
+        if (!m_running || generation != m_generation) {
+            return;     // 已结束或已开始新的下载
+        }
+        --m_retryWaiting;
+        m_retry.append(request);
+        startNext();
+    });
+}
+
+void OfflinePackDownloader::cancel()
+{
+    if (m_running) {
+        finish(true);
+    }
+}
+
+void OfflinePackDownloader::finish(bool canceled)
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+
+    const QList<QNetworkReply*> replies = m_active.keys();
+    m_active.clear();
+    for (QNetworkReply* reply : replies) {
+        reply->abort();
+    }
+
+    // 全部瓦片都已下载时标记为完整
+    const bool success = !canceled && m_failed == 0;
+    QJsonObject metadata = m_writer.metadata();
+    metadata[QStringLiteral("complete")] = success;
+    m_writer.writeMetadata(metadata);
+    m_writer.close();
+
+    qDebug() << "[OfflinePackDownloader] Finished" << m_packPath << "completed:" << m_completed
+             << "failed:" << m_failed << "canceled:" << canceled;
+    emit runningChanged();
+    emit progressChanged();
+    emit finished(success, m_packPath);
+}
+
+void OfflinePackDownloader::fail(const QString& message)
+{
+    qWarning() << "[OfflinePackDownloader]" << message;
+    emit error(message);
+}
+
+} // namespace YEFS
@@ -0,0 +1,127 @@
+#ifndef YEFS_OFFLINEPACKDOWNLOADER_H
+#define YEFS_OFFLINEPACKDOWNLOADER_H
+
+#include <QObject>
+#include <QGeoCoordinate>
+#include <QGeoRectangle>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QSet>
+#include <QString>
+#include <QVariantList>
+
+#include "TilePack.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+namespace YEFS {
+
+class OnlineTileSource;
+
+/**
+ * @brief 离线瓦片包下载器
+ *
+ * 把在线瓦片源在指定范围（矩形区域，或航线两侧一定海里的走廊）和缩放级别内的瓦片
+ * 下载到单个 .yefspack 文件。并发数有上限，按级别从低到高下载；
+ * 临时失败的瓦片按指数退避重试若干次，服务端不存在的瓦片记为缺失。
+ * 西边界大于东边界的区域视为跨越 180° 经线。
+ * 对同一文件再次下载时跳过已有瓦片，从中断处继续。
+ * 下载完成的瓦片包由 TilePackParser 打开，之后完全不访问网络。
+ */
+class OfflinePackDownloader : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(int totalTiles READ totalTiles NOTIFY progressChanged)
+    Q_PROPERTY(int completedTiles READ completedTiles NOTIFY progressChanged)
+    Q_PROPERTY(int failedTiles READ failedTiles NOTIFY progressChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int maxConcurrentDownloads READ maxConcurrentDownloads WRITE setMaxConcurrentDownloads
+               NOTIFY maxConcurrentDownloadsChanged)
+
+public:
+    // 单次下载的瓦片数上限，防止误选过大的范围或级别
+    static constexpr int MaxTiles = 500000;
+
+    explicit OfflinePackDownloader(QObject* parent = nullptr);
+    ~OfflinePackDownloader() override;
+
+    bool isRunning() const { return m_running; }
+    int totalTiles() const { return m_queue.size(); }
+    int completedTiles() const { return m_completed; }
+    int failedTiles() const { return m_failed; }
+    double progress() const;
+
+    int maxConcurrentDownloads() const { return m_maxConcurrent; }
+    void setMaxConcurrentDownloads(int count);
+
+    // 下载矩形区域
+    Q_INVOKABLE bool downloadArea(OnlineTileSource* source, const QGeoRectangle& area,
+                                  int minZoom, int maxZoom, const QString& packPath);
+
+    // 下载航线走廊：route 为 QGeoCoordinate（或含 latitude/longitude 的对象）列表，
+    // 覆盖距航线不超过 bufferNauticalMiles 海里的范围
+    Q_INVOKABLE bool downloadCorridor(OnlineTileSource* source, const QVariantList& route,
+                                      double bufferNauticalMiles, int minZoom, int maxZoom,
+                                      const QString& packPath);
+    bool downloadCorridor(OnlineTileSource* source, const QList<QGeoCoordinate>& route,
+                          double bufferNauticalMiles, int minZoom, int maxZoom,
+                          const QString& packPath);
+
+    Q_INVOKABLE void cancel();
+
+    // 覆盖范围内的瓦片数（不下载），可用于下载前提示
+    Q_INVOKABLE int countAreaTiles(const QGeoRectangle& area, int minZoom, int maxZoom) const;
+
+signals:
+    void runningChanged();
+    void progressChanged();
+    void maxConcurrentDownloadsChanged();
+    void finished(bool success, const QString& packPath);
+    void error(const QString& message);
+
+private:
+    struct TileRequest {
+        int z = 0;
+        int x = 0;
+        int y = 0;
+        int attempts = 0;
+    };
+
+    bool start(OnlineTileSource* source, QList<TileRequest> tiles, const QGeoRectangle& bounds,
+               int minZoom, int maxZoom, const QString& packPath);
+    void startNext();
+    void onReplyFinished(QNetworkReply* reply);
+    void scheduleRetry(const TileRequest& request, QNetworkReply* reply);
+    void finish(bool canceled);
+    void fail(const QString& message);
+
+    static bool appendAreaTiles(const QGeoRectangle& area, int minZoom, int maxZoom,
+                                QSet<quint64>& seen, QList<TileRequest>& tiles);
+
+    QNetworkAccessManager* m_network = nullptr;
+    QPointer<OnlineTileSource> m_source;
+    TilePackWriter m_writer;
+    QString m_packPath;
+
+    QList<TileRequest> m_queue;
+    int m_next = 0;
+    QList<TileRequest> m_retry;         // 等待期已过、可以重新发出的请求
+    int m_retryWaiting = 0;             // 仍在退避等待中的请求数
+    quint64 m_generation = 0;           // 每次下载递增，作废上一次下载的重试计时器
+    QHash<QNetworkReply*, TileRequest> m_active;
+    int m_completed = 0;
+    int m_failed = 0;
+    int m_sinceFlush = 0;
+    int m_maxConcurrent = 4;
+    bool m_running = false;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_OFFLINEPACKDOWNLOADER_H
@@ -0,0 +1,393 @@
+#include "PMTilesReader.h"
+#include "TileMath.h"
+#include "../MappedFile.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef YEFS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace YEFS {
+
+namespace {
+
+constexpr qint64 kHeaderSize = 127;
+constexpr quint8 kVersion = 3;
+constexpr int kMaxDirectoryDepth = 4;           // 根目录 + 至多三级叶目录
+constexpr int kLeafCacheEntries = 256 * 1024;
+constexpr qsizetype kMaxDecompressedBytes = 256 * 1024 * 1024;
+
+// PMTiles 规范中的压缩方式与瓦片类型
+enum Compression : quint8 {
+    CompressionUnknown = 0,
+    CompressionNone = 1,
+    CompressionGzip = 2,
+    CompressionBrotli = 3,
+    CompressionZstd = 4
+};
+
+enum TileType : quint8 {
+    TileTypeUnknown = 0,
+    TileTypeMvt = 1,
+    TileTypePng = 2,
+    TileTypeJpeg = 3,
+    TileTypeWebp = 4,
+    TileTypeAvif = 5
+};
+
+QString formatForTileType(quint8 type)
+{
+    switch (type) {
+    case TileTypeMvt:  return QStringLiteral("pbf");
+    case TileTypeJpeg: return QStringLiteral("jpg");
+    case TileTypeWebp: return QStringLiteral("webp");
+    case TileTypeAvif: return QStringLiteral("avif");
+    default:           return QStringLiteral("png");
+    }
+}
+
+// protobuf 风格的无符号变长整数
+class VarintReader
+{
+public:
+    explicit VarintReader(const QByteArray& data)
+        : m_data(reinterpret_cast<const uchar*>(data.constData()))
+        , m_size(data.size())
+    {
+    }
+
+    bool ok() const { return m_ok; }
+    qsizetype remaining() const { return m_size - m_pos; }
+
+    quint64 read() {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_pos >= m_size) {
+                m_ok = false;
+                return 0;
+            }
+            const uchar byte = m_data[m_pos++];
+            value |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        m_ok = false;
+        return 0;
+    }
+
+private:
+    const uchar* m_data;
+    qsizetype m_size;
+    qsizetype m_pos = 0;
+    bool m_ok = true;
+};
+
+#ifdef YEFS_HAVE_ZLIB
+bool gunzip(QByteArrayView input, QByteArray& output)
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = uInt(input.size());
+
+    output.resize(qMax<qsizetype>(input.size() * 4, 4096));
+    int result = Z_OK;
+    while (result == Z_OK) {
+        if (qsizetype(stream.total_out) == output.size()) {
+            if (output.size() >= kMaxDecompressedBytes) {
+                break;
+            }
+            output.resize(output.size() * 2);
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(output.data()) + stream.total_out;
+        stream.avail_out = uInt(output.size() - qsizetype(stream.total_out));
+        result = inflate(&stream, Z_NO_FLUSH);
+    }
+    output.resize(qsizetype(stream.total_out));
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+#endif
+
+} // namespace
+
+PMTilesReader::PMTilesReader(const QString& filePath)
+    : m_filePath(filePath)
+    , m_file(std::make_unique<MappedFile>(filePath))
+{
+    m_leafCache.setMaxCost(kLeafCacheEntries);
+
+    if (!m_file->isMapped()) {
+        m_errorString = m_file->errorString();
+        return;
+    }
+    if (!readHeader()) {
+        return;
+    }
+
+    QByteArray root;
+    if (!decompress(m_header.rootOffset, m_header.rootLength, root) || !decodeDirectory(root, m_root)) {
+        m_errorString = QStringLiteral("PMTiles 根目录损坏或压缩方式不受支持");
+        return;
+    }
+
+    readMetadata();
+    m_valid = true;
+    qDebug() << "[PMTilesReader] Opened" << filePath << "format:" << format()
+             << "zoom:" << m_header.minZoom << "-" << m_header.maxZoom
+             << "root entries:" << m_root.size();
+}
+
+PMTilesReader::~PMTilesReader() = default;
+
+bool PMTilesReader::isPMTiles(QByteArrayView data)
+{
+    return data.size() >= 8 && std::memcmp(data.data(), "PMTiles", 7) == 0
+        && quint8(data.at(7)) == kVersion;
+}
+
+quint64 PMTilesReader::tileId(int z, int x, int y)
+{
+    // 较低级别的瓦片总数 (4^z - 1) / 3，加上本级 Hilbert 曲线上的位置
+    quint64 id = ((quint64(1) << (2 * z)) - 1) / 3;
+    quint64 tx = quint64(x);
+    quint64 ty = quint64(y);
+    for (quint64 s = (quint64(1) << z) / 2; s > 0; s /= 2) {
+        const quint64 rx = (tx & s) ? 1 : 0;
+        const quint64 ry = (ty & s) ? 1 : 0;
+        id += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                tx = s - 1 - tx;
+                ty = s - 1 - ty;
+            }
+            std::swap(tx, ty);
+        }
+    }
+    return id;
+}
+
+// ============================================================================
+// 文件头与元数据
+// ============================================================================
+
+bool PMTilesReader::readHeader()
+{
+    const QByteArrayView data = m_file->data();
+    if (data.size() < kHeaderSize || !isPMTiles(data)) {
+        m_errorString = QStringLiteral("不是有效的 PMTiles v3 文件");
+        return false;
+    }
+
+    const auto* p = reinterpret_cast<const uchar*>(data.data());
+    m_header.rootOffset = qFromLittleEndian<quint64>(p + 8);
+    m_header.rootLength = qFromLittleEndian<quint64>(p + 16);
+    m_header.metadataOffset = qFromLittleEndian<quint64>(p + 24);
+    m_header.metadataLength = qFromLittleEndian<quint64>(p + 32);
+    m_header.leafOffset = qFromLittleEndian<quint64>(p + 40);
+    m_header.leafLength = qFromLittleEndian<quint64>(p + 48);
+    m_header.tileDataOffset = qFromLittleEndian<quint64>(p + 56);
+    m_header.tileDataLength = qFromLittleEndian<quint64>(p + 64);
+    m_header.internalCompression = p[97];
+    m_header.tileCompression = p[98];
+    m_header.tileType = p[99];
+    m_header.minZoom = p[100];
+    m_header.maxZoom = p[101];
+    for (int i = 0; i < 4; ++i) {
+        m_header.bounds[i] = qFromLittleEndian<qint32>(p + 102 + 4 * i) / 1e7;
+    }
+
+    const quint64 size = quint64(data.size());
+    if (m_header.tileDataOffset > size || m_header.tileDataLength > size - m_header.tileDataOffset) {
+        m_errorString = QStringLiteral("PMTiles 文件不完整");
+        return false;
+    }
+    return true;
+}
+
+bool PMTilesReader::readMetadata()
+{
+    QJsonObject json;
+    QByteArray bytes;
+    if (m_header.metadataLength > 0 && decompress(m_header.metadataOffset, m_header.metadataLength, bytes)) {
+        json = QJsonDocument::fromJson(bytes).object();
+    }
+
+    QJsonObject metadata;
+    metadata[QStringLiteral("name")] = json.value(QStringLiteral("name")).toString();
+    metadata[QStringLiteral("format")] = formatForTileType(m_header.tileType);
+    metadata[QStringLiteral("bounds")] = QJsonArray{
+        m_header.bounds[0], m_header.bounds[1], m_header.bounds[2], m_header.bounds[3]
+    };
+    metadata[QStringLiteral("minzoom")] = int(m_header.minZoom);
+    metadata[QStringLiteral("maxzoom")] = int(m_header.maxZoom);
+    metadata[QStringLiteral("attribution")] = json.value(QStringLiteral("attribution")).toString();
+    metadata[QStringLiteral("description")] = json.value(QStringLiteral("description")).toString();
+    if (json.contains(QStringLiteral("vector_layers"))) {
+        metadata[QStringLiteral("json")] = QJsonObject{
+            { QStringLiteral("vector_layers"), json.value(QStringLiteral("vector_layers")) }
+        };
+    }
+    m_metadata = metadata;
+    return !json.isEmpty();
+}
+
+QString PMTilesReader::format() const
+{
+    return formatForTileType(m_header.tileType);
+}
+
+QByteArray PMTilesReader::contentEncoding() const
+{
+    switch (m_header.tileCompression) {
+    case CompressionGzip:   return QByteArrayLiteral("gzip");
+    case CompressionBrotli: return QByteArrayLiteral("br");
+    case CompressionZstd:   return QByteArrayLiteral("zstd");
+    default:                return QByteArray();
+    }
+}
+
+// ============================================================================
+// 目录
+// ============================================================================
+
+bool PMTilesReader::decompress(quint64 offset, quint64 length, QByteArray& out) const
+{
+    const quint64 size = quint64(m_file->size());
+    if (offset > size || length > size - offset) {
+        return false;
+    }
+    const QByteArrayView input(m_file->data().data() + offset, qsizetype(length));
+
+    switch (m_header.internalCompression) {
+    case CompressionUnknown:
+    case CompressionNone:
+        out = input.toByteArray();
+        return true;
+#ifdef YEFS_HAVE_ZLIB
+    case CompressionGzip:
+        return gunzip(input, out);
+#endif
+    default:
+        qWarning() << "[PMTilesReader] Unsupported internal compression:" << m_header.internalCompression;
+        return false;
+    }
+}
+
+bool PMTilesReader::decodeDirectory(const QByteArray& data, Directory& directory) const
+{
+    // 列式编码：条目数，然后依次是 TileID 增量、连续数、长度、偏移（0 表示紧接上一条）
+    VarintReader reader(data);
+    const quint64 count = reader.read();
+    if (!reader.ok() || count > quint64(reader.remaining())) {
+        return false;
+    }
+
+    directory.resize(qsizetype(count));
+    quint64 lastId = 0;
+    for (Entry& entry : directory) {
+        lastId += reader.read();
+        entry.tileId = lastId;
+    }
+    for (Entry& entry : directory) {
+        entry.runLength = quint32(reader.read());
+    }
+    for (Entry& entry : directory) {
+        entry.length = quint32(reader.read());
+    }
+    for (qsizetype i = 0; i < directory.size(); ++i) {
+        const quint64 value = reader.read();
+        if (value == 0 && i > 0) {
+            directory[i].offset = directory[i - 1].offset + directory[i - 1].length;
+        } else {
+            directory[i].offset = value - 1;
+        }
+    }
+    return reader.ok();
+}
+
+const PMTilesReader::Entry* PMTilesReader::findEntry(const Directory& directory, quint64 tileId)
+{
+    // 最后一个 TileID 不大于目标的条目
+    auto it = std::upper_bound(directory.cbegin(), directory.cend(), tileId,
+                               [](quint64 id, const Entry& entry) { return id < entry.tileId; });
+    if (it == directory.cbegin()) {
+        return nullptr;
+    }
+    const Entry& entry = *(it - 1);
+    if (entry.runLength == 0 || tileId - entry.tileId < entry.runLength) {
+        return &entry;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const PMTilesReader::Directory> PMTilesReader::leafDirectory(quint64 offset, quint64 length)
+{
+    {
+        QMutexLocker locker(&m_leafMutex);
+        if (const auto* cached = m_leafCache.object(offset)) {
+            return *cached;
+        }
+    }
+
+    // 不持锁解码，多个线程可以并行解码不同叶目录
+    QByteArray data;
+    auto directory = std::make_shared<Directory>();
+    if (!decompress(m_header.leafOffset + offset, length, data) || !decodeDirectory(data, *directory)) {
+        qWarning() << "[PMTilesReader] Corrupt leaf directory at" << offset << "in" << m_filePath;
+        return nullptr;
+    }
+
+    std::shared_ptr<const Directory> result = std::move(directory);
+    QMutexLocker locker(&m_leafMutex);
+    m_leafCache.insert(offset, new std::shared_ptr<const Directory>(result),
+                       qMax<int>(1, int(result->size())));
+    return result;
+}
+
+// ============================================================================
+// 瓦片
+// ============================================================================
+
+QByteArray PMTilesReader::tile(int z, int x, int y)
+{
+    if (!m_valid || !TileMath::isValidTile(z, x, y) || z < m_header.minZoom || z > m_header.maxZoom) {
+        return QByteArray();
+    }
+
+    const quint64 id = tileId(z, x, y);
+    const Directory* directory = &m_root;
+    std::shared_ptr<const Directory> leaf;
+    for (int depth = 0; depth < kMaxDirectoryDepth; ++depth) {
+        const Entry* entry = findEntry(*directory, id);
+        if (!entry) {
+            return QByteArray();
+        }
+        if (entry->runLength > 0) {
+            if (entry->offset > m_header.tileDataLength
+                || entry->length > m_header.tileDataLength - entry->offset) {
+                return QByteArray();
+            }
+            return QByteArray(m_file->data().data() + m_header.tileDataOffset + entry->offset,
+                              qsizetype(entry->length));
+        }
+        leaf = leafDirectory(entry->offset, entry->length);
+        if (!leaf) {
+            return QByteArray();
+        }
+        directory = leaf.get();
+    }
+    return QByteArray();
+}
+
+} // namespace YEFS
@@ -0,0 +1,103 @@
+#ifndef YEFS_PMTILESREADER_H
+#define YEFS_PMTILESREADER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QCache>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <memory>
+
+#include "ITileProvider.h"
+
+namespace YEFS {
+
+class MappedFile;
+
+/**
+ * @brief PMTiles v3 单文件瓦片归档读取器
+ *
+ * 映射整个归档，瓦片按 (z, x, y) 的 Hilbert 编号在根目录和至多三级叶目录中二分查找，
+ * 得到偏移和长度后直接从映射内存取出，不经过数据库或网络。
+ * 根目录在打开时解码并常驻；叶目录解码后进入 LRU，同一区域的瓦片共用一次解码。
+ * 瓦片本身按原样返回，压缩方式由 contentEncoding() 告知 MapLibre。
+ * tileData() 可在多个线程中同时调用。
+ */
+class PMTilesReader : public ITileProvider
+{
+public:
+    explicit PMTilesReader(const QString& filePath);
+    ~PMTilesReader() override;
+
+    bool isValid() const { return m_valid; }
+    QString filePath() const { return m_filePath; }
+    QString errorString() const { return m_errorString; }
+
+    // 规范化为 MBTiles 风格：name、format、bounds、minzoom、maxzoom、attribution、description、json
+    QJsonObject metadata() const { return m_metadata; }
+    QString format() const;
+
+    QByteArray tile(int z, int x, int y);
+
+    // ITileProvider 接口实现
+    QByteArray tileData(int z, int x, int y) override { return tile(z, x, y); }
+    QByteArray contentType() const override { return contentTypeForFormat(format()); }
+    QString fileExtension() const override { return format(); }
+    QByteArray contentEncoding() const override;
+
+    // 归档文件头
+    static bool isPMTiles(QByteArrayView data);
+
+    // 瓦片在 Hilbert 曲线上的全局编号（PMTiles 的 TileID）
+    static quint64 tileId(int z, int x, int y);
+
+private:
+    struct Entry {
+        quint64 tileId = 0;
+        quint64 offset = 0;
+        quint32 length = 0;
+        quint32 runLength = 0;      // 0 表示指向叶目录
+    };
+    using Directory = QList<Entry>;
+
+    struct Header {
+        quint64 rootOffset = 0;
+        quint64 rootLength = 0;
+        quint64 metadataOffset = 0;
+        quint64 metadataLength = 0;
+        quint64 leafOffset = 0;
+        quint64 leafLength = 0;
+        quint64 tileDataOffset = 0;
+        quint64 tileDataLength = 0;
+        quint8 internalCompression = 0;
+        quint8 tileCompression = 0;
+        quint8 tileType = 0;
+        quint8 minZoom = 0;
+        quint8 maxZoom = 0;
+        double bounds[4] = {-180.0, -85.0, 180.0, 85.0};   // west, south, east, north
+    };
+
+    bool readHeader();
+    bool readMetadata();
+    bool decompress(quint64 offset, quint64 length, QByteArray& out) const;
+    bool decodeDirectory(const QByteArray& data, Directory& directory) const;
+    std::shared_ptr<const Directory> leafDirectory(quint64 offset, quint64 length);
+    static const Entry* findEntry(const Directory& directory, quint64 tileId);
+
+    QString m_filePath;
+    std::unique_ptr<MappedFile> m_file;
+    Header m_header;
+    Directory m_root;
+    QJsonObject m_metadata;
+    bool m_valid = false;
+    QString m_errorString;
+
+    QMutex m_leafMutex;
+    QCache<quint64, std::shared_ptr<const Directory>> m_leafCache;     // 代价单位：目录项
+};
+
+} // namespace YEFS
+
+#endif // YEFS_PMTILESREADER_H
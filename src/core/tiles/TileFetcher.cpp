@@ -0,0 +1,551 @@
+#include "TileFetcher.h"
+#include "TileMath.h"
+#include "../OnlineMapProvider.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace YEFS {
+
+namespace {
+
+constexpr qint64 kDefaultDiskCacheBytes = 512LL * 1024 * 1024;
+constexpr qint64 kDefaultMemoryCacheBytes = 64LL * 1024 * 1024;
+constexpr int kTransferTimeoutMs = 15000;
+
+} // namespace
+
+TileFetcher* TileFetcher::s_instance = nullptr;
+
+TileFetcher* TileFetcher::instance()
+{
+    if (!s_instance) {
+        s_instance = new TileFetcher();
+    }
+    return s_instance;
+}
+
+TileFetcher::TileFetcher(QObject* parent)
+    : QObject(parent)
+    , m_network(new QNetworkAccessManager(this))
+    , m_diskCache(new QNetworkDiskCache(this))
+{
+    m_diskCache->setCacheDirectory(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/tiles"));
+    m_diskCache->setMaximumCacheSize(kDefaultDiskCacheBytes);
+    m_network->setCache(m_diskCache);
+    m_network->setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    m_network->setTransferTimeout(kTransferTimeoutMs);
+
+    m_memoryCache.setMaxCost(int(kDefaultMemoryCacheBytes / 1024));
+}
+
+TileFetcher::~TileFetcher()
+{
+    cancelAll();
+}
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+void TileFetcher::setCacheDirectory(const QString& directory)
+{
+    m_diskCache->setCacheDirectory(directory);
+}
+
+QString TileFetcher::cacheDirectory() const
+{
+    return m_diskCache->cacheDirectory();
+}
+
+void TileFetcher::setDiskCacheSize(qint64 bytes)
+{
+    m_diskCache->setMaximumCacheSize(bytes);
+}
+
+void TileFetcher::setMemoryCacheSize(qint64 bytes)
+{
+    m_memoryCache.setMaxCost(int(qBound<qint64>(0, bytes / 1024, std::numeric_limits<int>::max())));
+}
+
+void TileFetcher::setMaxConcurrentRequests(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+    startRequests();
+}
+
+void TileFetcher::setMaxRequestsPerHost(int count)
+{
+    m_maxPerHost = qMax(1, count);
+    startRequests();
+}
+
+void TileFetcher::setPrefetchBudget(int count)
+{
+    m_prefetchBudget = qMax(0, count);
+    startRequests();
+}
+
+void TileFetcher::setViewCenter(double latitude, double longitude)
+{
+    m_centerX = TileMath::lonToX(longitude);
+    m_centerY = TileMath::latToY(latitude);
+}
+
+void TileFetcher::setViewport(const QGeoRectangle& region, double zoom)
+{
+    if (!region.isValid()) {
+        m_viewZoom = -1;
+        return;
+    }
+    m_viewLeft = TileMath::lonToX(region.topLeft().longitude());
+    m_viewTop = TileMath::latToY(region.topLeft().latitude());
+    m_viewRight = TileMath::lonToX(region.bottomRight().longitude());
+    m_viewBottom = TileMath::latToY(region.bottomRight().latitude());
+    m_viewZoom = qBound(0, int(std::floor(zoom)), TileMath::MaxZoom);
+    m_centerX = (m_viewLeft + m_viewRight) / 2.0;
+    m_centerY = (m_viewTop + m_viewBottom) / 2.0;
+    cancelOutsideViewport();
+}
+
+// ============================================================================
+// 请求
+// ============================================================================
+
+QString TileFetcher::tileKey(const QString& sourceId, int z, int x, int y)
+{
+    return sourceId + QLatin1Char('/') + QString::number(z) + QLatin1Char('/')
+         + QString::number(x) + QLatin1Char('/') + QString::number(y);
+}
+
+QString TileFetcher::hostKey(const QString& urlTemplate)
+{
+    // 取模板中的主机部分，{s} 保持原样，使 a/b/c 子域名共用一个并发上限
+    const qsizetype schemeEnd = urlTemplate.indexOf(QLatin1String("://"));
+    const qsizetype hostStart = schemeEnd < 0 ? 0 : schemeEnd + 3;
+    const qsizetype hostEnd = urlTemplate.indexOf(QLatin1Char('/'), hostStart);
+    return urlTemplate.mid(hostStart, hostEnd < 0 ? -1 : hostEnd - hostStart).toLower();
+}
+
+double TileFetcher::priority(const Request& request) const
+{
+    // 以该级别的瓦片为单位计算到视图中心的距离，越小越先下载
+    const double scale = double(1 << request.z);
+    const double dx = (request.x + 0.5) - m_centerX * scale;
+    const double dy = (request.y + 0.5) - m_centerY * scale;
+    return dx * dx + dy * dy;
+}
+
+bool TileFetcher::isInViewport(const Request& request) const
+{
+    // 预取请求本来就在视口之外，由 cancelPrefetch() 统一丢弃；
+    // 有 requestTileData 调用方等待的请求由调用方决定是否还需要
+    if (m_viewZoom < 0 || request.prefetch || m_dataWaiters.contains(request.key)) {
+        return true;
+    }
+    // 相邻级别的瓦片仍可能作为过渡显示
+    if (qAbs(request.z - m_viewZoom) > 1) {
+        return false;
+    }
+    // 视口外保留一圈瓦片余量
+    const double scale = double(1 << request.z);
+    return request.x + 2 > m_viewLeft * scale && request.x - 1 < m_viewRight * scale
+        && request.y + 2 > m_viewTop * scale && request.y - 1 < m_viewBottom * scale;
+}
+
+void TileFetcher::cancelOutsideViewport()
+{
+    const qsizetype before = m_pending.size();
+    m_pending.removeIf([this](const Request& request) {
+        if (isInViewport(request)) {
+            return false;
+        }
+        m_pendingKeys.remove(request.key);
+        return true;
+    });
+    m_stats.canceled += quint64(before - m_pending.size());
+
+    QStringList outside;
+    for (auto it = m_active.cbegin(); it != m_active.cend(); ++it) {
+        if (!isInViewport(it->request)) {
+            outside.append(it.key());
+        }
+    }
+    for (const QString& key : std::as_const(outside)) {
+        abortActive(key);
+    }
+    startRequests();
+}
+
+void TileFetcher::abortActive(const QString& key)
+{
+    const ActiveRequest active = m_active.take(key);
+    if (!active.reply) {
+        return;
+    }
+    if (--m_activePerHost[active.request.host] <= 0) {
+        m_activePerHost.remove(active.request.host);
+    }
+    ++m_stats.canceled;
+    active.reply->abort();
+    finishData(key, QByteArray());
+}
+
+QImage TileFetcher::cachedTile(const QString& sourceId, int z, int x, int y) const
+{
+    const QImage* image = m_memoryCache.object(tileKey(sourceId, z, x, y));
+    return image ? *image : QImage();
+}
+
+QImage TileFetcher::requestTile(const OnlineTileSource* source, int z, int x, int y)
+{
+    if (!source || !TileMath::isValidTile(z, x, y) || z < source->minZoom() || z > source->maxZoom()) {
+        return QImage();
+    }
+
+    ++m_stats.requests;
+    const QString key = tileKey(source->id(), z, x, y);
+    if (const QImage* image = m_memoryCache.object(key)) {
+        ++m_stats.memoryHits;
+        return *image;
+    }
+
+    // 已在队列、下载或解码中的瓦片合并为一次请求，完成时统一发出 tileReady
+    if (m_pendingKeys.contains(key) || m_active.contains(key) || m_decoding.contains(key)) {
+        ++m_stats.coalesced;
+        promote(key, true);
+        return QImage();
+    }
+
+    Request request = makeRequest(source, z, x, y);
+    request.decodeImage = true;
+    m_pending.append(request);
+    m_pendingKeys.insert(request.key);
+    startRequests();
+    return QImage();
+}
+
+bool TileFetcher::prefetchTile(const OnlineTileSource* source, int z, int x, int y)
+{
+    if (!source || !TileMath::isValidTile(z, x, y) || z < source->minZoom() || z > source->maxZoom()) {
+        return false;
+    }
+
+    const QString key = tileKey(source->id(), z, x, y);
+    if (m_memoryCache.contains(key) || m_pendingKeys.contains(key)
+        || m_active.contains(key) || m_decoding.contains(key)) {
+        return false;
+    }
+
+    Request request = makeRequest(source, z, x, y);
+    request.prefetch = true;
+    m_pending.append(request);
+    m_pendingKeys.insert(request.key);
+    ++m_stats.prefetched;
+    startRequests();
+    return true;
+}
+
+void TileFetcher::cancelPrefetch()
+{
+    m_pending.removeIf([this](const Request& request) {
+        if (!request.prefetch) {
+            return false;
+        }
+        m_pendingKeys.remove(request.key);
+        return true;
+    });
+}
+
+void TileFetcher::requestTileData(const OnlineTileSource* source, int z, int x, int y, DataCallback done)
+{
+    if (!source || !TileMath::isValidTile(z, x, y) || z < source->minZoom() || z > source->maxZoom()) {
+        done(QByteArray());
+        return;
+    }
+
+    ++m_stats.requests;
+    const QString key = tileKey(source->id(), z, x, y);
+
+    // 排队或下载中的瓦片（含预取）合并，响应到达时一并应答
+    if (m_pendingKeys.contains(key) || m_active.contains(key)) {
+        ++m_stats.coalesced;
+        promote(key, false);
+        m_dataWaiters[key].append(std::move(done));
+        return;
+    }
+
+    Request request = makeRequest(source, z, x, y);
+    // 已下载过（解码中或在内存缓存中）的瓦片直接从磁盘缓存读取编码字节
+    if (m_decoding.contains(key) || m_memoryCache.contains(key)) {
+        std::unique_ptr<QIODevice> cached(m_diskCache->data(request.url));
+        if (cached) {
+            ++m_stats.diskHits;
+            done(cached->readAll());
+            return;
+        }
+    }
+
+    m_dataWaiters[key].append(std::move(done));
+    m_pending.append(request);
+    m_pendingKeys.insert(key);
+    startRequests();
+}
+
+TileFetcher::Request TileFetcher::makeRequest(const OnlineTileSource* source, int z, int x, int y) const
+{
+    Request request;
+    request.key = tileKey(source->id(), z, x, y);
+    request.sourceId = source->id();
+    request.host = hostKey(source->urlTemplate());
+    request.url = QUrl(source->tileUrl(z, x, y));
+    request.z = z;
+    request.x = x;
+    request.y = y;
+    return request;
+}
+
+TileFetcher::Request* TileFetcher::findRequest(const QString& key)
+{
+    if (m_pendingKeys.contains(key)) {
+        for (Request& pending : m_pending) {
+            if (pending.key == key) {
+                return &pending;
+            }
+        }
+    } else if (m_active.contains(key)) {
+        return &m_active[key].request;
+    } else if (m_decoding.contains(key)) {
+        return &m_decoding[key];
+    }
+    return nullptr;
+}
+
+void TileFetcher::promote(const QString& key, bool decodeImage)
+{
+    Request* request = findRequest(key);
+    if (!request) {
+        return;
+    }
+    request->decodeImage = request->decodeImage || decodeImage;
+    if (request->prefetch) {
+        request->prefetch = false;
+        ++m_stats.prefetchUsed;
+    }
+}
+
+void TileFetcher::finishData(const QString& key, const QByteArray& data)
+{
+    const QList<DataCallback> waiters = m_dataWaiters.take(key);
+    for (const DataCallback& done : waiters) {
+        done(data);
+    }
+}
+
+int TileFetcher::activePrefetchCount() const
+{
+    int count = 0;
+    for (const ActiveRequest& active : m_active) {
+        if (active.request.prefetch) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void TileFetcher::startRequests()
+{
+    // 至少留一个连接给屏幕内请求
+    const int prefetchSlots = qMin(m_prefetchBudget, m_maxConcurrent - 1);
+    while (m_active.size() < m_maxConcurrent && !m_pending.isEmpty()) {
+        // 队列通常只有几十到几百项，线性选取即可随视图中心变化即时调整顺序；
+        // 已达到主机并发上限的请求留在队列中，预取请求排在所有屏幕内请求之后
+        const bool allowPrefetch = activePrefetchCount() < prefetchSlots;
+        int best = -1;
+        bool bestPrefetch = true;
+        double bestPriority = 0.0;
+        for (int i = 0; i < m_pending.size(); ++i) {
+            const Request& candidate = m_pending.at(i);
+            if (m_activePerHost.value(candidate.host) >= m_maxPerHost
+                || (candidate.prefetch && !allowPrefetch)) {
+                continue;
+            }
+            const double p = priority(candidate);
+            const bool better = candidate.prefetch == bestPrefetch ? p < bestPriority
+                                                                   : bestPrefetch;
+            if (best < 0 || better) {
+                best = i;
+                bestPrefetch = candidate.prefetch;
+                bestPriority = p;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        const Request request = m_pending.takeAt(best);
+        m_pendingKeys.remove(request.key);
+
+        QNetworkRequest networkRequest(request.url);
+        networkRequest.setHeader(QNetworkRequest::UserAgentHeader,
+                                 QCoreApplication::applicationName() + QLatin1Char('/')
+                                 + QCoreApplication::applicationVersion());
+        networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                                    QNetworkRequest::PreferNetwork);
+        networkRequest.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
+        networkRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+        QNetworkReply* reply = m_network->get(networkRequest);
+        m_active.insert(request.key, ActiveRequest{reply, request});
+        ++m_activePerHost[request.host];
+        connect(reply, &QNetworkReply::finished, this, [this, reply, key = request.key]() {
+            onReplyFinished(reply, key);
+        });
+    }
+}
+
+void TileFetcher::onReplyFinished(QNetworkReply* reply, const QString& key)
+{
+    reply->deleteLater();
+    const auto it = m_active.constFind(key);
+    if (it == m_active.cend() || it->reply != reply) {
+        return;     // 已取消，计数在取消时处理
+    }
+    // 下载期间可能已被屏幕内请求提升，以登记的请求为准
+    const Request request = it->request;
+    m_active.erase(it);
+    if (--m_activePerHost[request.host] <= 0) {
+        m_activePerHost.remove(request.host);
+    }
+
+    if (reply->error() == QNetworkReply::OperationCanceledError) {
+        startRequests();
+        return;
+    }
+
+    if (reply->error() == QNetworkReply::NoError) {
+        if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+            ++m_stats.diskHits;
+        } else {
+            ++m_stats.downloaded;
+        }
+        finishReply(request, reply->readAll());
+    } else {
+        // 离线或服务端出错时，使用磁盘缓存中已过期的瓦片
+        std::unique_ptr<QIODevice> stale(m_diskCache->data(request.url));
+        if (stale) {
+            ++m_stats.diskHits;
+            finishReply(request, stale->readAll());
+        } else {
+            ++m_stats.failed;
+            finishData(request.key, QByteArray());
+            if (!request.prefetch) {
+                qDebug() << "[TileFetcher] Tile failed:" << request.url.toString() << reply->errorString();
+            }
+            if (request.decodeImage) {
+                emit tileFailed(request.sourceId, request.z, request.x, request.y, reply->errorString());
+            }
+        }
+    }
+
+    startRequests();
+}
+
+void TileFetcher::finishReply(const Request& request, const QByteArray& data)
+{
+    // 编码字节直接交给 requestTileData 调用方；预取只需写入磁盘缓存，不解码
+    finishData(request.key, data);
+    if (request.decodeImage) {
+        decode(request, data);
+    }
+}
+
+void TileFetcher::decode(const Request& request, const QByteArray& data)
+{
+    m_decoding.insert(request.key, request);
+
+    // 解码放到线程池，避免阻塞界面
+    QPointer<TileFetcher> self(this);
+    QThreadPool::globalInstance()->start([self, request, data]() {
+        QImage image = QImage::fromData(data);
+        if (!image.isNull()) {
+            image.convertTo(QImage::Format_ARGB32_Premultiplied);
+        }
+        TileFetcher* fetcher = self.data();
+        if (!fetcher) {
+            return;
+        }
+        QMetaObject::invokeMethod(fetcher, [self, key = request.key, image]() {
+            if (!self || !self->m_decoding.contains(key)) {
+                return;     // 期间被取消
+            }
+            // 解码期间可能已被屏幕内请求提升
+            const Request request = self->m_decoding.take(key);
+            if (image.isNull()) {
+                emit self->tileFailed(request.sourceId, request.z, request.x, request.y,
+                                      QStringLiteral("瓦片解码失败"));
+                return;
+            }
+            self->m_memoryCache.insert(request.key, new QImage(image),
+                                       qMax(1, int(image.sizeInBytes() / 1024)));
+            emit self->tileReady(request.sourceId, request.z, request.x, request.y, image);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TileFetcher::cancelSource(const QString& sourceId)
+{
+    const qsizetype before = m_pending.size();
+    QStringList removed;
+    m_pending.removeIf([this, &sourceId, &removed](const Request& request) {
+        if (request.sourceId != sourceId) {
+            return false;
+        }
+        m_pendingKeys.remove(request.key);
+        removed.append(request.key);
+        return true;
+    });
+    m_stats.canceled += quint64(before - m_pending.size());
+    for (const QString& key : std::as_const(removed)) {
+        finishData(key, QByteArray());
+    }
+    m_decoding.removeIf([&sourceId](const QHash<QString, Request>::iterator it) {
+        return it.value().sourceId == sourceId;
+    });
+
+    const QString prefix = sourceId + QLatin1Char('/');
+    const QList<QString> keys = m_active.keys();
+    for (const QString& key : keys) {
+        if (key.startsWith(prefix)) {
+            abortActive(key);
+        }
+    }
+    startRequests();
+}
+
+void TileFetcher::cancelAll()
+{
+    m_stats.canceled += quint64(m_pending.size());
+    m_pending.clear();
+    m_pendingKeys.clear();
+    m_decoding.clear();
+    const QList<QString> keys = m_active.keys();
+    for (const QString& key : keys) {
+        abortActive(key);
+    }
+    const QList<QString> waiting = m_dataWaiters.keys();
+    for (const QString& key : waiting) {
+        finishData(key, QByteArray());
+    }
+}
+
+} // namespace YEFS
@@ -0,0 +1,175 @@
+#ifndef YEFS_TILEFETCHER_H
+#define YEFS_TILEFETCHER_H
+
+#include <QObject>
+#include <QCache>
+#include <QGeoRectangle>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <functional>
+
+class QNetworkAccessManager;
+class QNetworkDiskCache;
+class QNetworkReply;
+
+namespace YEFS {
+
+class OnlineTileSource;
+
+/**
+ * @brief 在线瓦片异步加载器
+ *
+ * 所有在线瓦片源共用一个 QNetworkAccessManager（连接复用、HTTP/2），
+ * 请求进入有界队列，按到视图中心的距离排序，同时进行的请求数受限，
+ * 同一主机（{s} 子域名视为同一主机）的并发数另有上限。
+ * 同一瓦片在排队、下载或解码期间的重复请求合并为一次；设置视口后，
+ * 移出视口（含一圈瓦片余量）或级别相差超过 1 的请求被丢弃或中止。
+ * 响应写入 QNetworkDiskCache，由 Qt 按 Cache-Control/Expires 判断新鲜度、
+ * 过期后带 ETag/Last-Modified 重新验证；网络失败时回退到磁盘中的旧瓦片。
+ * 解码在线程池中完成，解码后的图像进入按字节计的内存 LRU。
+ * 预取请求（prefetchTile）只在没有可发出的屏幕内请求时才占用并发，
+ * 且同时最多占用 prefetchBudget 个连接，完成后只写入磁盘缓存；
+ * 屏幕内请求到来时同一瓦片的预取请求被提升。
+ * requestTileData 返回已编码的瓦片字节（LocalTileServer 代理给 MapLibre），同样经磁盘缓存读取，
+ * 因此预取过的瓦片由缓存直接应答。
+ *
+ * 只能在 GUI 线程使用。instance() 为应用共享实例，也可单独构造
+ * （例如指向本地 HTTP 服务并使用独立的缓存目录）。
+ */
+class TileFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TileFetcher* instance();
+
+    explicit TileFetcher(QObject* parent = nullptr);
+    ~TileFetcher() override;
+
+    // 配置
+    void setCacheDirectory(const QString& directory);
+    QString cacheDirectory() const;
+    void setDiskCacheSize(qint64 bytes);
+    void setMemoryCacheSize(qint64 bytes);
+    void setMaxConcurrentRequests(int count);
+    int maxConcurrentRequests() const { return m_maxConcurrent; }
+    void setMaxRequestsPerHost(int count);
+    int maxRequestsPerHost() const { return m_maxPerHost; }
+    void setPrefetchBudget(int count);
+    int prefetchBudget() const { return m_prefetchBudget; }
+
+    // 视图中心，用于排定请求优先级
+    void setViewCenter(double latitude, double longitude);
+
+    // 可见范围与缩放级别，立即取消视口外的请求；无效范围表示不按视口过滤
+    void setViewport(const QGeoRectangle& region, double zoom);
+
+    // 内存命中时直接返回图像；否则排队下载并返回空图像，完成后发出 tileReady/tileFailed
+    QImage requestTile(const OnlineTileSource* source, int z, int x, int y);
+    QImage cachedTile(const QString& sourceId, int z, int x, int y) const;
+
+    // 已编码的瓦片字节：完成、失败或请求被取消时在 GUI 线程调用 done，失败时数据为空。
+    // 不随视口取消，由请求方（MapLibre）决定是否还需要
+    using DataCallback = std::function<void(const QByteArray& data)>;
+    void requestTileData(const OnlineTileSource* source, int z, int x, int y, DataCallback done);
+
+    // 预取：瓦片已缓存或已在请求中时返回 false；完成后只写入磁盘缓存，不发出 tileReady/tileFailed
+    bool prefetchTile(const OnlineTileSource* source, int z, int x, int y);
+    // 丢弃排队中的预取请求，进行中的预取继续完成
+    void cancelPrefetch();
+
+    // 丢弃排队中的请求并中止进行中的请求
+    void cancelSource(const QString& sourceId);
+    void cancelAll();
+
+    int pendingCount() const { return m_pending.size(); }
+    int activeCount() const { return m_active.size(); }
+
+    // 计数器
+    struct Statistics {
+        quint64 requests = 0;       // requestTile/requestTileData 调用次数
+        quint64 memoryHits = 0;     // 内存缓存命中
+        quint64 diskHits = 0;       // 由磁盘缓存应答（含离线回退）
+        quint64 coalesced = 0;      // 与排队、下载或解码中的同一瓦片合并
+        quint64 canceled = 0;       // 被丢弃或中止的请求
+        quint64 downloaded = 0;     // 从网络下载
+        quint64 failed = 0;
+        quint64 prefetched = 0;     // 排入的预取请求
+        quint64 prefetchUsed = 0;   // 预取请求被屏幕内请求提升
+    };
+    Statistics statistics() const { return m_stats; }
+    void resetStatistics() { m_stats = Statistics(); }
+
+signals:
+    void tileReady(const QString& sourceId, int z, int x, int y, const QImage& image);
+    void tileFailed(const QString& sourceId, int z, int x, int y, const QString& error);
+
+private:
+    struct Request {
+        QString key;
+        QString sourceId;
+        QString host;           // URL 模板中的主机名，{s} 不展开
+        QUrl url;
+        int z = 0;
+        int x = 0;
+        int y = 0;
+        bool prefetch = false;
+        bool decodeImage = false;   // 有 requestTile 调用方，完成后解码并发出 tileReady
+    };
+
+    struct ActiveRequest {
+        QNetworkReply* reply = nullptr;
+        Request request;
+    };
+
+    static QString tileKey(const QString& sourceId, int z, int x, int y);
+    static QString hostKey(const QString& urlTemplate);
+    double priority(const Request& request) const;
+    bool isInViewport(const Request& request) const;
+    void cancelOutsideViewport();
+    void abortActive(const QString& key);
+    Request* findRequest(const QString& key);
+    void promote(const QString& key, bool decodeImage);
+    Request makeRequest(const OnlineTileSource* source, int z, int x, int y) const;
+    void finishData(const QString& key, const QByteArray& data);
+    int activePrefetchCount() const;
+
+    void startRequests();
+    void onReplyFinished(QNetworkReply* reply, const QString& key);
+    void finishReply(const Request& request, const QByteArray& data);
+    void decode(const Request& request, const QByteArray& data);
+
+    static TileFetcher* s_instance;
+
+    QNetworkAccessManager* m_network = nullptr;
+    QNetworkDiskCache* m_diskCache = nullptr;
+    QList<Request> m_pending;
+    QSet<QString> m_pendingKeys;
+    QHash<QString, ActiveRequest> m_active;
+    QHash<QString, int> m_activePerHost;
+    QHash<QString, Request> m_decoding;
+    QHash<QString, QList<DataCallback>> m_dataWaiters;     // 等待编码字节的 requestTileData 调用方
+    mutable QCache<QString, QImage> m_memoryCache;     // 代价单位：KB
+    int m_maxConcurrent = 8;
+    int m_maxPerHost = 6;
+    int m_prefetchBudget = 2;
+    double m_centerX = 0.5;                             // 视图中心（归一化 Web Mercator）
+    double m_centerY = 0.5;
+
+    // 视口（归一化 Web Mercator），m_viewZoom < 0 表示未设置
+    double m_viewLeft = 0.0;
+    double m_viewTop = 0.0;
+    double m_viewRight = 1.0;
+    double m_viewBottom = 1.0;
+    int m_viewZoom = -1;
+
+    Statistics m_stats;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_TILEFETCHER_H
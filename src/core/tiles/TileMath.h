@@ -0,0 +1,64 @@
+#ifndef YEFS_TILEMATH_H
+#define YEFS_TILEMATH_H
+
+#include <QtMath>
+#include <cmath>
+
+namespace YEFS {
+
+/**
+ * @brief Web Mercator 瓦片坐标换算
+ *
+ * 归一化坐标 x、y 取值 [0, 1]，原点在左上角；级别 z 的瓦片 (tx, ty) 覆盖
+ * [tx / 2^z, (tx + 1) / 2^z) × [ty / 2^z, (ty + 1) / 2^z)。
+ */
+namespace TileMath {
+
+constexpr double MaxLatitude = 85.0511287798066;
+constexpr int MaxZoom = 24;
+
+inline double lonToX(double lon)
+{
+    return lon / 360.0 + 0.5;
+}
+
+inline double latToY(double lat)
+{
+    const double s = std::sin(qDegreesToRadians(qBound(-MaxLatitude, lat, MaxLatitude)));
+    const double y = 0.5 - 0.25 * std::log((1.0 + s) / (1.0 - s)) / M_PI;
+    return qBound(0.0, y, 1.0);
+}
+
+inline double xToLon(double x)
+{
+    return (x - 0.5) * 360.0;
+}
+
+inline double yToLat(double y)
+{
+    return qRadiansToDegrees(std::atan(std::sinh(M_PI * (1.0 - 2.0 * y))));
+}
+
+// 包含归一化坐标的瓦片行列号，越界时夹到有效范围
+inline int tileIndex(double normalized, int z)
+{
+    const int count = 1 << z;
+    return qBound(0, int(std::floor(normalized * count)), count - 1);
+}
+
+inline bool isValidTile(int z, int x, int y)
+{
+    return z >= 0 && z <= MaxZoom && x >= 0 && y >= 0 && x < (1 << z) && y < (1 << z);
+}
+
+// 有效瓦片的唯一键（z 占 6 位，x、y 各占 29 位）
+inline quint64 tileKey(int z, int x, int y)
+{
+    return (quint64(z) << 58) | (quint64(x) << 29) | quint64(y);
+}
+
+} // namespace TileMath
+
+} // namespace YEFS
+
+#endif // YEFS_TILEMATH_H
@@ -0,0 +1,309 @@
+#include "TilePack.h"
+#include "TileMath.h"
+#include "../MappedFile.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QtEndian>
+#include <cstring>
+#include <functional>
+
+namespace YEFS {
+
+namespace {
+
+struct RecordHeader {
+    quint8 type = 0;
+    int z = 0;
+    int x = 0;
+    int y = 0;
+    quint32 length = 0;
+};
+
+bool hasValidHeader(QByteArrayView data)
+{
+    if (data.size() < TilePackFormat::HeaderSize
+        || std::memcmp(data.data(), TilePackFormat::Magic, sizeof(TilePackFormat::Magic)) != 0) {
+        return false;
+    }
+    const auto* bytes = reinterpret_cast<const uchar*>(data.data());
+    return qFromLittleEndian<quint32>(bytes + 8) == TilePackFormat::Version
+        && qFromLittleEndian<quint32>(bytes + 12) == quint32(TilePackFormat::HeaderSize);
+}
+
+// 依次访问完整的记录，返回最后一条完整记录之后的偏移
+qint64 scanRecords(QByteArrayView data,
+                   const std::function<void(const RecordHeader&, qint64 payloadOffset)>& visit)
+{
+    const auto* bytes = reinterpret_cast<const uchar*>(data.data());
+    qint64 offset = TilePackFormat::HeaderSize;
+    while (offset + TilePackFormat::RecordHeaderSize <= data.size()) {
+        const uchar* p = bytes + offset;
+        RecordHeader header;
+        header.type = p[0];
+        header.z = p[1];
+        header.x = int(qFromLittleEndian<quint32>(p + 4));
+        header.y = int(qFromLittleEndian<quint32>(p + 8));
+        header.length = qFromLittleEndian<quint32>(p + 12);
+
+        const qint64 payloadOffset = offset + TilePackFormat::RecordHeaderSize;
+        if (header.type < TilePackFormat::Metadata || header.type > TilePackFormat::Missing
+            || header.length > TilePackFormat::MaxRecordLength
+            || payloadOffset + header.length > data.size()) {
+            break;
+        }
+        if (header.type == TilePackFormat::Metadata || TileMath::isValidTile(header.z, header.x, header.y)) {
+            visit(header, payloadOffset);
+        }
+        offset = payloadOffset + header.length;
+    }
+    return offset;
+}
+
+QJsonObject parseMetadata(QByteArrayView data, qint64 offset, quint32 length)
+{
+    return QJsonDocument::fromJson(QByteArray(data.data() + offset, length)).object();
+}
+
+} // namespace
+
+// ============================================================================
+// TilePack 实现
+// ============================================================================
+
+TilePack::TilePack(const QString& filePath)
+    : m_filePath(filePath)
+    , m_file(std::make_unique<MappedFile>(filePath))
+{
+    if (!m_file->isMapped()) {
+        m_errorString = m_file->errorString();
+        return;
+    }
+    const QByteArrayView data = m_file->data();
+    if (!hasValidHeader(data)) {
+        m_errorString = QStringLiteral("不是有效的离线瓦片包");
+        return;
+    }
+
+    const qint64 end = scanRecords(data, [this, data](const RecordHeader& header, qint64 payloadOffset) {
+        if (header.type == TilePackFormat::Metadata) {
+            m_metadata = parseMetadata(data, payloadOffset, header.length);
+            return;
+        }
+        Record record;
+        if (header.type == TilePackFormat::Tile) {
+            record.offset = payloadOffset;
+            record.length = header.length;
+        }
+        m_tiles.insert(TileMath::tileKey(header.z, header.x, header.y), record);
+    });
+
+    for (const Record& record : std::as_const(m_tiles)) {
+        if (record.length > 0) {
+            ++m_tileCount;
+        }
+    }
+    if (end < data.size()) {
+        qWarning() << "[TilePack] Ignoring incomplete tail in" << filePath << "at offset" << end;
+    }
+    m_valid = true;
+    qDebug() << "[TilePack] Opened" << filePath << "tiles:" << m_tileCount;
+}
+
+TilePack::~TilePack() = default;
+
+bool TilePack::isTilePack(QByteArrayView data)
+{
+    return hasValidHeader(data);
+}
+
+QString TilePack::format() const
+{
+    return m_metadata.value(QStringLiteral("format")).toString(QStringLiteral("png"));
+}
+
+int TilePack::minZoom() const
+{
+    return m_metadata.value(QStringLiteral("minzoom")).toInt(0);
+}
+
+int TilePack::maxZoom() const
+{
+    return m_metadata.value(QStringLiteral("maxzoom")).toInt(18);
+}
+
+bool TilePack::contains(int z, int x, int y) const
+{
+    const auto it = m_tiles.constFind(TileMath::tileKey(z, x, y));
+    return it != m_tiles.constEnd() && it->length > 0;
+}
+
+QByteArray TilePack::tile(int z, int x, int y) const
+{
+    if (!m_valid || !TileMath::isValidTile(z, x, y)) {
+        return QByteArray();
+    }
+    const auto it = m_tiles.constFind(TileMath::tileKey(z, x, y));
+    if (it == m_tiles.constEnd() || it->length == 0) {
+        return QByteArray();
+    }
+    return QByteArray(m_file->data().data() + it->offset, it->length);
+}
+
+// ============================================================================
+// TilePackWriter 实现
+// ============================================================================
+
+TilePackWriter::~TilePackWriter()
+{
+    close();
+}
+
+bool TilePackWriter::open(const QString& filePath)
+{
+    close();
+    m_existing.clear();
+    m_metadata = QJsonObject();
+    m_errorString.clear();
+
+    m_file.setFileName(filePath);
+    if (!scanExisting()) {
+        return false;
+    }
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    if (m_file.size() == 0) {
+        QByteArray header(TilePackFormat::HeaderSize, '\0');
+        std::memcpy(header.data(), TilePackFormat::Magic, sizeof(TilePackFormat::Magic));
+        qToLittleEndian<quint32>(TilePackFormat::Version, header.data() + 8);
+        qToLittleEndian<quint32>(quint32(TilePackFormat::HeaderSize), header.data() + 12);
+        if (m_file.write(header) != header.size()) {
+            m_errorString = m_file.errorString();
+            m_file.close();
+            return false;
+        }
+    }
+    m_file.seek(m_file.size());
+    return true;
+}
+
+bool TilePackWriter::scanExisting()
+{
+    if (!m_file.exists()) {
+        return true;
+    }
+
+    qint64 validEnd = 0;
+    {
+        MappedFile mapped(m_file.fileName());
+        if (!mapped.isMapped()) {
+            // 空文件按新文件处理
+            if (mapped.size() == 0) {
+                return true;
+            }
+            m_errorString = mapped.errorString();
+            return false;
+        }
+        const QByteArrayView data = mapped.data();
+        if (!hasValidHeader(data)) {
+            m_errorString = QStringLiteral("目标文件已存在且不是离线瓦片包");
+            return false;
+        }
+        validEnd = scanRecords(data, [this, data](const RecordHeader& header, qint64 payloadOffset) {
+            if (header.type == TilePackFormat::Metadata) {
+                m_metadata = parseMetadata(data, payloadOffset, header.length);
+            } else {
+                m_existing.insert(TileMath::tileKey(header.z, header.x, header.y));
+            }
+        });
+        if (validEnd == data.size()) {
+            return true;
+        }
+    }
+
+    // 上次下载中断时留下的半条记录
+    qDebug() << "[TilePackWriter] Truncating incomplete tail of" << m_file.fileName() << "to" << validEnd;
+    if (!m_file.resize(validEnd)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void TilePackWriter::close()
+{
+    if (m_file.isOpen()) {
+        m_file.flush();
+        m_file.close();
+    }
+}
+
+bool TilePackWriter::contains(int z, int x, int y) const
+{
+    return m_existing.contains(TileMath::tileKey(z, x, y));
+}
+
+bool TilePackWriter::writeTile(int z, int x, int y, const QByteArray& data)
+{
+    if (data.isEmpty()) {
+        return writeMissing(z, x, y);
+    }
+    return writeRecord(TilePackFormat::Tile, z, x, y, data);
+}
+
+bool TilePackWriter::writeMissing(int z, int x, int y)
+{
+    return writeRecord(TilePackFormat::Missing, z, x, y, QByteArray());
+}
+
+bool TilePackWriter::writeMetadata(const QJsonObject& metadata)
+{
+    if (!writeRecord(TilePackFormat::Metadata, 0, 0, 0,
+                     QJsonDocument(metadata).toJson(QJsonDocument::Compact))) {
+        return false;
+    }
+    m_metadata = metadata;
+    return true;
+}
+
+bool TilePackWriter::flush()
+{
+    return m_file.isOpen() && m_file.flush();
+}
+
+bool TilePackWriter::writeRecord(quint8 type, int z, int x, int y, const QByteArray& payload)
+{
+    if (!m_file.isOpen()) {
+        m_errorString = QStringLiteral("瓦片包未打开");
+        return false;
+    }
+    if (type != TilePackFormat::Metadata && !TileMath::isValidTile(z, x, y)) {
+        m_errorString = QStringLiteral("瓦片坐标无效");
+        return false;
+    }
+    if (quint64(payload.size()) > TilePackFormat::MaxRecordLength) {
+        m_errorString = QStringLiteral("瓦片数据过大");
+        return false;
+    }
+
+    char header[TilePackFormat::RecordHeaderSize] = {};
+    header[0] = char(type);
+    header[1] = char(z);
+    qToLittleEndian<quint32>(quint32(x), header + 4);
+    qToLittleEndian<quint32>(quint32(y), header + 8);
+    qToLittleEndian<quint32>(quint32(payload.size()), header + 12);
+
+    if (m_file.write(header, sizeof(header)) != qint64(sizeof(header))
+        || m_file.write(payload) != payload.size()) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    if (type != TilePackFormat::Metadata) {
+        m_existing.insert(TileMath::tileKey(z, x, y));
+    }
+    return true;
+}
+
+} // namespace YEFS
@@ -0,0 +1,132 @@
+#ifndef YEFS_TILEPACK_H
+#define YEFS_TILEPACK_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QSet>
+#include <QString>
+#include <memory>
+
+#include "ITileProvider.h"
+
+namespace YEFS {
+
+class MappedFile;
+
+/**
+ * @brief 离线瓦片包（.yefspack）
+ *
+ * 单文件、只追加的格式，便于下载中断后续传：
+ *   文件头   "YEFSPAK\0" | version(u32) | headerSize(u32)
+ *   记录     type(u8) | z(u8) | reserved(u16) | x(u32) | y(u32) | length(u32) | payload
+ * 整数均为小端。记录类型为元数据（JSON）、瓦片或缺失瓦片（服务端返回 404，续传时不再请求）。
+ * 同一瓦片或元数据出现多次时以最后一条为准；文件末尾不完整的记录视为未写完，读取时忽略。
+ */
+namespace TilePackFormat {
+
+constexpr char Magic[8] = {'Y', 'E', 'F', 'S', 'P', 'A', 'K', '\0'};
+constexpr quint32 Version = 1;
+constexpr qint64 HeaderSize = 16;
+constexpr qint64 RecordHeaderSize = 16;
+constexpr quint32 MaxRecordLength = 64 * 1024 * 1024;
+
+enum RecordType : quint8 {
+    Metadata = 1,
+    Tile = 2,
+    Missing = 3
+};
+
+} // namespace TilePackFormat
+
+/**
+ * @brief 离线瓦片包读取器
+ *
+ * 映射整个文件并建立 z/x/y → 偏移的索引，之后的读取只访问映射内存，
+ * 可在多个线程中同时调用，不访问网络。
+ */
+class TilePack : public ITileProvider
+{
+public:
+    explicit TilePack(const QString& filePath);
+    ~TilePack() override;
+
+    bool isValid() const { return m_valid; }
+    QString filePath() const { return m_filePath; }
+    QString errorString() const { return m_errorString; }
+
+    // 下载时写入的元数据：name、format、bounds、minzoom、maxzoom、attribution、complete
+    QJsonObject metadata() const { return m_metadata; }
+    QString format() const;
+    int minZoom() const;
+    int maxZoom() const;
+    int tileCount() const { return m_tileCount; }
+
+    bool contains(int z, int x, int y) const;
+    QByteArray tile(int z, int x, int y) const;
+
+    // ITileProvider 接口实现
+    QByteArray tileData(int z, int x, int y) override { return tile(z, x, y); }
+    QByteArray contentType() const override { return contentTypeForFormat(format()); }
+    QString fileExtension() const override { return format(); }
+
+    // 文件头是否为瓦片包
+    static bool isTilePack(QByteArrayView data);
+
+private:
+    struct Record {
+        qint64 offset = 0;
+        quint32 length = 0;
+    };
+
+    QString m_filePath;
+    std::unique_ptr<MappedFile> m_file;
+    QHash<quint64, Record> m_tiles;     // 缺失瓦片的 length 为 0
+    QJsonObject m_metadata;
+    int m_tileCount = 0;
+    bool m_valid = false;
+    QString m_errorString;
+};
+
+/**
+ * @brief 离线瓦片包写入器
+ *
+ * 打开已有文件时扫描全部记录，截掉末尾不完整的部分，已写入的瓦片通过 contains() 查询，
+ * 下载器据此跳过，实现断点续传。只能在单个线程中使用。
+ */
+class TilePackWriter
+{
+public:
+    TilePackWriter() = default;
+    ~TilePackWriter();
+
+    bool open(const QString& filePath);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_errorString; }
+
+    // 已有瓦片（含缺失记录）
+    bool contains(int z, int x, int y) const;
+    int existingCount() const { return m_existing.size(); }
+    QJsonObject metadata() const { return m_metadata; }
+
+    bool writeTile(int z, int x, int y, const QByteArray& data);
+    bool writeMissing(int z, int x, int y);
+    bool writeMetadata(const QJsonObject& metadata);
+    bool flush();
+
+private:
+    bool scanExisting();
+    bool writeRecord(quint8 type, int z, int x, int y, const QByteArray& payload);
+
+    QFile m_file;
+    QSet<quint64> m_existing;
+    QJsonObject m_metadata;
+    QString m_errorString;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_TILEPACK_H
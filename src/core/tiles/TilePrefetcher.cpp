@@ -0,0 +1,232 @@
+#include "TilePrefetcher.h"
+#include "TileFetcher.h"
+#include "TileMath.h"
+#include "../MapSourceManager.h"
+#include "../OnlineMapProvider.h"
+#include <algorithm>
+#include <cmath>
+
+namespace YEFS {
+
+namespace {
+
+constexpr int kScheduleIntervalMs = 100;
+constexpr qint64 kStationaryMs = 500;       // 超过该间隔没有相机更新视为已停止
+constexpr double kVelocitySmoothing = 0.5;
+constexpr int kTargetGraceMs = 1000;
+
+} // namespace
+
+TilePrefetcher* TilePrefetcher::s_instance = nullptr;
+
+TilePrefetcher* TilePrefetcher::instance()
+{
+    if (!s_instance) {
+        s_instance = new TilePrefetcher(TileFetcher::instance());
+    }
+    return s_instance;
+}
+
+TilePrefetcher::TilePrefetcher(TileFetcher* fetcher, QObject* parent)
+    : QObject(parent)
+    , m_fetcher(fetcher)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(kScheduleIntervalMs);
+    connect(&m_timer, &QTimer::timeout, this, &TilePrefetcher::prefetch);
+}
+
+void TilePrefetcher::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled) {
+        m_timer.stop();
+        m_fetcher->cancelPrefetch();
+    }
+}
+
+// ============================================================================
+// 相机状态
+// ============================================================================
+
+void TilePrefetcher::updateCamera(const QGeoRectangle& region, double zoom)
+{
+    if (!region.isValid()) {
+        return;
+    }
+
+    const double left = TileMath::lonToX(region.topLeft().longitude());
+    double right = TileMath::lonToX(region.bottomRight().longitude());
+    if (right < left) {
+        right += 1.0;       // 跨越 180° 经线
+    }
+    const double top = TileMath::latToY(region.topLeft().latitude());
+    const double bottom = TileMath::latToY(region.bottomRight().latitude());
+
+    View view;
+    view.centerX = (left + right) / 2.0;
+    view.centerY = (top + bottom) / 2.0;
+    view.width = right - left;
+    view.height = bottom - top;
+    view.zoom = zoom;
+
+    // 指数平滑的速度；间隔过长说明相机停过，不沿用旧速度
+    const qint64 elapsed = m_lastUpdate.isValid() ? m_lastUpdate.elapsed() : 0;
+    if (m_hasView && elapsed > 0 && elapsed < kStationaryMs) {
+        double dx = view.centerX - m_view.centerX;
+        dx -= std::round(dx);   // 经度方向取最短路径
+        const double vx = dx / elapsed;
+        const double vy = (view.centerY - m_view.centerY) / elapsed;
+        const double vz = (view.zoom - m_view.zoom) / elapsed;
+        m_velocityX = kVelocitySmoothing * vx + (1.0 - kVelocitySmoothing) * m_velocityX;
+        m_velocityY = kVelocitySmoothing * vy + (1.0 - kVelocitySmoothing) * m_velocityY;
+        m_velocityZoom = kVelocitySmoothing * vz + (1.0 - kVelocitySmoothing) * m_velocityZoom;
+    } else if (elapsed >= kStationaryMs) {
+        m_velocityX = m_velocityY = m_velocityZoom = 0.0;
+    }
+    m_lastUpdate.restart();
+    m_view = view;
+    m_hasView = true;
+
+    // 已到达 flyTo 目标
+    if (m_hasTarget && qAbs(view.zoom - m_target.zoom) < 0.5
+        && qAbs(view.centerX - m_target.centerX) < view.width / 2.0
+        && qAbs(view.centerY - m_target.centerY) < view.height / 2.0) {
+        m_hasTarget = false;
+    }
+    schedule();
+}
+
+void TilePrefetcher::setFlyToTarget(double latitude, double longitude, double zoom, int durationMs)
+{
+    if (!m_hasView) {
+        return;
+    }
+    // 目标视口的大小按级别差从当前视口缩放
+    const double targetZoom = zoom < 0 ? m_view.zoom : qBound(0.0, zoom, double(TileMath::MaxZoom));
+    const double scale = std::exp2(m_view.zoom - targetZoom);
+    m_target.centerX = TileMath::lonToX(longitude);
+    m_target.centerY = TileMath::latToY(latitude);
+    m_target.width = m_view.width * scale;
+    m_target.height = m_view.height * scale;
+    m_target.zoom = targetZoom;
+    m_hasTarget = true;
+    m_targetTimeoutMs = qMax(0, durationMs) + kTargetGraceMs;
+    m_targetTimer.restart();
+
+    // 动画一开始就需要目标瓦片，不等节流
+    m_timer.stop();
+    prefetch();
+}
+
+// ============================================================================
+// 预取
+// ============================================================================
+
+void TilePrefetcher::schedule()
+{
+    if (m_enabled && !m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void TilePrefetcher::prefetch()
+{
+    if (!m_enabled || !m_hasView) {
+        return;
+    }
+
+    QList<const OnlineTileSource*> sources;
+    const QList<IMapSource*> online = MapSourceManager::instance()->sourcesByType(MapSourceType::Online);
+    for (IMapSource* source : online) {
+        if (const auto* tileSource = qobject_cast<OnlineTileSource*>(source)) {
+            sources.append(tileSource);
+        }
+    }
+    if (sources.isEmpty()) {
+        return;
+    }
+
+    // 新的推算替换上一次尚未发出的预取
+    m_fetcher->cancelPrefetch();
+    int budget = m_maxTiles;
+
+    if (m_hasTarget && m_targetTimer.elapsed() > m_targetTimeoutMs) {
+        m_hasTarget = false;
+    }
+    if (m_hasTarget) {
+        addView(sources, m_target, budget);
+    }
+
+    // 相机在动时推算 lookAhead 之后的视口；位移不到半个视口或级别变化不到半级时不预取
+    View predicted = m_view;
+    predicted.centerX += m_velocityX * m_lookAheadMs;
+    predicted.centerY = qBound(0.0, m_view.centerY + m_velocityY * m_lookAheadMs, 1.0);
+    predicted.zoom = qBound(0.0, m_view.zoom + m_velocityZoom * m_lookAheadMs, double(TileMath::MaxZoom));
+    const double scale = std::exp2(m_view.zoom - predicted.zoom);
+    predicted.width *= scale;
+    predicted.height *= scale;
+
+    const bool panning = qAbs(predicted.centerX - m_view.centerX) > m_view.width / 2.0
+                      || qAbs(predicted.centerY - m_view.centerY) > m_view.height / 2.0;
+    const bool zooming = qAbs(predicted.zoom - m_view.zoom) >= 0.5;
+    if (panning || zooming) {
+        addView(sources, predicted, budget);
+    }
+}
+
+void TilePrefetcher::addView(const QList<const OnlineTileSource*>& sources, const View& view, int& budget)
+{
+    // 上一级瓦片少，在目标级别到达前可放大显示
+    const int z = qBound(0, int(std::floor(view.zoom)), TileMath::MaxZoom);
+    if (z > 0) {
+        addTiles(sources, view, z - 1, budget);
+    }
+    addTiles(sources, view, z, budget);
+}
+
+void TilePrefetcher::addTiles(const QList<const OnlineTileSource*>& sources, const View& view, int z, int& budget)
+{
+    if (budget <= 0) {
+        return;
+    }
+
+    const int count = 1 << z;
+    const int xStart = int(std::floor((view.centerX - view.width / 2.0) * count));
+    const int xEnd = qMin(xStart + count - 1, int(std::floor((view.centerX + view.width / 2.0) * count)));
+    const int yStart = TileMath::tileIndex(view.centerY - view.height / 2.0, z);
+    const int yEnd = TileMath::tileIndex(view.centerY + view.height / 2.0, z);
+
+    // 预算不够覆盖整个视口时，先取靠近视口中心的瓦片
+    struct Tile {
+        int x;
+        int y;
+        double distance;
+    };
+    QList<Tile> tiles;
+    const double cx = view.centerX * count;
+    const double cy = view.centerY * count;
+    for (int y = yStart; y <= yEnd; ++y) {
+        for (int x = xStart; x <= xEnd; ++x) {
+            const double dx = x + 0.5 - cx;
+            const double dy = y + 0.5 - cy;
+            tiles.append({((x % count) + count) % count, y, dx * dx + dy * dy});
+        }
+    }
+    std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) {
+        return a.distance < b.distance;
+    });
+
+    for (const Tile& tile : std::as_const(tiles)) {
+        for (const OnlineTileSource* source : sources) {
+            if (budget <= 0) {
+                return;
+            }
+            if (m_fetcher->prefetchTile(source, z, tile.x, tile.y)) {
+                --budget;
+            }
+        }
+    }
+}
+
+} // namespace YEFS
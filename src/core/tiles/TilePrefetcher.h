@@ -0,0 +1,85 @@
+#ifndef YEFS_TILEPREFETCHER_H
+#define YEFS_TILEPREFETCHER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QGeoRectangle>
+#include <QList>
+#include <QTimer>
+
+namespace YEFS {
+
+class OnlineTileSource;
+class TileFetcher;
+
+/**
+ * @brief 沿相机运动预取在线瓦片
+ *
+ * 由 MapLibreEngine 报告可见范围、缩放级别和 flyTo 目标。根据最近几次相机更新
+ * 估计平移和缩放速度，推算 lookAhead 毫秒后的视口；flyTo 时直接使用目标视口。
+ * 先排入上一级（瓦片少、可作为放大显示的过渡），再排入目标级别。
+ * 每次推算最多排入 maxTiles 个瓦片，并替换上一次尚未发出的预取；
+ * 实际下载经 TileFetcher 的预取通道，只占用空闲连接，不影响屏幕内请求。
+ */
+class TilePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TilePrefetcher* instance();
+
+    explicit TilePrefetcher(TileFetcher* fetcher, QObject* parent = nullptr);
+    ~TilePrefetcher() override = default;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void setLookAhead(int milliseconds) { m_lookAheadMs = qMax(0, milliseconds); }
+    int lookAhead() const { return m_lookAheadMs; }
+    void setMaxTiles(int count) { m_maxTiles = qMax(0, count); }
+    int maxTiles() const { return m_maxTiles; }
+
+    // 相机更新：可见范围与缩放级别
+    void updateCamera(const QGeoRectangle& region, double zoom);
+    // flyTo 目标，zoom < 0 表示保持当前级别；在 durationMs 加上余量后失效
+    void setFlyToTarget(double latitude, double longitude, double zoom, int durationMs);
+
+private:
+    // 归一化 Web Mercator 视口
+    struct View {
+        double centerX = 0.5;
+        double centerY = 0.5;
+        double width = 0.0;
+        double height = 0.0;
+        double zoom = 0.0;
+    };
+
+    void schedule();
+    void prefetch();
+    void addView(const QList<const OnlineTileSource*>& sources, const View& view, int& budget);
+    void addTiles(const QList<const OnlineTileSource*>& sources, const View& view, int z, int& budget);
+
+    static TilePrefetcher* s_instance;
+
+    TileFetcher* m_fetcher = nullptr;
+    bool m_enabled = true;
+    int m_lookAheadMs = 1000;
+    int m_maxTiles = 64;
+
+    View m_view;
+    bool m_hasView = false;
+    QElapsedTimer m_lastUpdate;
+    double m_velocityX = 0.0;           // 每毫秒的归一化位移
+    double m_velocityY = 0.0;
+    double m_velocityZoom = 0.0;        // 每毫秒的级别变化
+
+    View m_target;
+    bool m_hasTarget = false;
+    QElapsedTimer m_targetTimer;
+    int m_targetTimeoutMs = 0;
+
+    QTimer m_timer;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_TILEPREFETCHER_H
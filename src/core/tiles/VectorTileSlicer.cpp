@@ -0,0 +1,329 @@
+#include "VectorTileSlicer.h"
+#include "MvtEncoder.h"
+#include "TileMath.h"
+#include <QMutexLocker>
+#include <QPolygon>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+namespace YEFS {
+
+namespace {
+
+struct TilePoint {
+    double x;
+    double y;
+};
+
+using TileLine = QList<TilePoint>;
+
+// Liang-Barsky 线段裁剪，成功时 a、b 被改写为裁剪后的端点
+bool clipSegment(TilePoint& a, TilePoint& b, double min, double max)
+{
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    double t0 = 0.0;
+    double t1 = 1.0;
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { a.x - min, max - a.x, a.y - min, max - a.y };
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) {
+                return false;
+            }
+            continue;
+        }
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0) {
+            if (t > t1) return false;
+            t0 = qMax(t0, t);
+        } else {
+            if (t < t0) return false;
+            t1 = qMin(t1, t);
+        }
+    }
+    const TilePoint start = a;
+    if (t1 < 1.0) {
+        b = { start.x + t1 * dx, start.y + t1 * dy };
+    }
+    if (t0 > 0.0) {
+        a = { start.x + t0 * dx, start.y + t0 * dy };
+    }
+    return true;
+}
+
+// 折线裁剪：在范围外断开，得到若干段
+QList<TileLine> clipLine(const TileLine& line, double min, double max)
+{
+    QList<TileLine> result;
+    TileLine current;
+    for (int i = 1; i < line.size(); ++i) {
+        TilePoint a = line.at(i - 1);
+        TilePoint b = line.at(i);
+        const TilePoint end = b;
+        if (!clipSegment(a, b, min, max)) {
+            if (current.size() > 1) result.append(current);
+            current.clear();
+            continue;
+        }
+        if (current.isEmpty()) {
+            current.append(a);
+        }
+        current.append(b);
+        // 线段从范围内穿出时断开
+        if (b.x != end.x || b.y != end.y) {
+            result.append(current);
+            current.clear();
+        }
+    }
+    if (current.size() > 1) {
+        result.append(current);
+    }
+    return result;
+}
+
+// Sutherland-Hodgman 多边形裁剪，对一条轴对齐边界
+TileLine clipRingEdge(const TileLine& ring, bool alongX, double bound, bool keepGreater)
+{
+    TileLine result;
+    if (ring.isEmpty()) {
+        return result;
+    }
+    auto inside = [&](const TilePoint& p) {
+        const double v = alongX ? p.x : p.y;
+        return keepGreater ? v >= bound : v <= bound;
+    };
+    auto intersect = [&](const TilePoint& a, const TilePoint& b) {
+        const double t = alongX ? (bound - a.x) / (b.x - a.x) : (bound - a.y) / (b.y - a.y);
+        return TilePoint{ a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) };
+    };
+
+    TilePoint previous = ring.last();
+    bool previousInside = inside(previous);
+    for (const TilePoint& point : ring) {
+        const bool pointInside = inside(point);
+        if (pointInside != previousInside) {
+            result.append(intersect(previous, point));
+        }
+        if (pointInside) {
+            result.append(point);
+        }
+        previous = point;
+        previousInside = pointInside;
+    }
+    return result;
+}
+
+TileLine clipRing(TileLine ring, double min, double max)
+{
+    // 去掉闭合点，裁剪后再补上
+    if (ring.size() > 1 && ring.first().x == ring.last().x && ring.first().y == ring.last().y) {
+        ring.removeLast();
+    }
+    ring = clipRingEdge(ring, true, min, true);
+    ring = clipRingEdge(ring, true, max, false);
+    ring = clipRingEdge(ring, false, min, true);
+    ring = clipRingEdge(ring, false, max, false);
+    if (!ring.isEmpty()) {
+        ring.append(ring.first());
+    }
+    return ring;
+}
+
+// 取整到瓦片坐标并去掉连续重复点
+QPolygon quantize(const TileLine& line)
+{
+    QPolygon result;
+    result.reserve(line.size());
+    for (const TilePoint& point : line) {
+        const QPoint p(qRound(point.x), qRound(point.y));
+        if (result.isEmpty() || result.last() != p) {
+            result.append(p);
+        }
+    }
+    return result;
+}
+
+// 测量员公式面积的两倍（y 向下时顺时针为正）
+qint64 signedArea(const QPolygon& ring)
+{
+    qint64 area = 0;
+    for (int i = 1; i < ring.size(); ++i) {
+        area += qint64(ring.at(i - 1).x()) * ring.at(i).y() - qint64(ring.at(i).x()) * ring.at(i - 1).y();
+    }
+    return area;
+}
+
+} // namespace
+
+VectorTileSlicer::VectorTileSlicer(std::shared_ptr<const FeatureStore> store, SpatialIndex index,
+                                   const Options& options)
+    : m_store(std::move(store))
+    , m_index(std::move(index))
+    , m_options(options)
+{
+    // 抽稀需要顶点重要度；数据源没有时只新增这一列，其余各列仍与数据源共享
+    if (!m_store->hasImportance()) {
+        auto withImportance = std::make_shared<FeatureStore>(*m_store);
+        withImportance->computeImportance();
+        m_store = std::move(withImportance);
+    }
+    if (m_index.size() != m_store->featureCount()) {
+        m_index.build(*m_store);
+    }
+
+    const int count = m_store->coordinateCount();
+    const double* lon = m_store->longitudes();
+    const double* lat = m_store->latitudes();
+    m_x.resize(count);
+    m_y.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_x[i] = TileMath::lonToX(lon[i]);
+        m_y[i] = TileMath::latToY(lat[i]);
+    }
+
+    m_cache.setMaxCost(qMax<qint64>(0, m_options.cacheBytes));
+}
+
+QByteArray VectorTileSlicer::tile(int z, int x, int y)
+{
+    if (!TileMath::isValidTile(z, x, y)) {
+        return QByteArray();
+    }
+
+    const quint64 key = TileMath::tileKey(z, x, y);
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QByteArray* cached = m_cache.object(key)) {
+            return *cached;
+        }
+    }
+
+    // 不持锁构建，多个线程可以并行生成不同瓦片
+    const QByteArray data = buildTile(z, x, y);
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.insert(key, new QByteArray(data), data.size() + 64);
+    return data;
+}
+
+void VectorTileSlicer::clearCache()
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.clear();
+}
+
+QByteArray VectorTileSlicer::buildTile(int z, int x, int y) const
+{
+    const double scale = double(1 << z);
+    const double extent = m_options.extent;
+    const double pad = double(m_options.buffer) / extent;
+
+    // 带缓冲区的瓦片范围（经纬度）
+    const double minLon = TileMath::xToLon((x - pad) / scale);
+    const double maxLon = TileMath::xToLon((x + 1 + pad) / scale);
+    const double maxLat = TileMath::yToLat(qMax(0.0, (y - pad) / scale));
+    const double minLat = TileMath::yToLat(qMin(1.0, (y + 1 + pad) / scale));
+    const QList<int> candidates = m_index.search(minLon, minLat, maxLon, maxLat);
+    if (candidates.isEmpty()) {
+        return QByteArray();
+    }
+
+    // 当前级别半个像素以内的顶点可以丢弃，maxZoom 及以上保留全部顶点
+    const double centerLat = TileMath::yToLat((y + 0.5) / scale);
+    const double tolerance = z < m_options.maxZoom ? FeatureStore::toleranceForZoom(z, centerLat) : 0.0;
+
+    const double clipMin = -m_options.buffer;
+    const double clipMax = extent + m_options.buffer;
+    auto toTile = [&](int coord) {
+        return TilePoint{ (m_x.at(coord) * scale - x) * extent, (m_y.at(coord) * scale - y) * extent };
+    };
+    auto collect = [&](int part) {
+        TileLine line;
+        const int begin = m_store->coordBegin(part);
+        const int end = m_store->coordEnd(part);
+        line.reserve(end - begin);
+        for (int i = begin; i < end; ++i) {
+            if (tolerance <= 0.0 || m_store->importance(i) >= tolerance) {
+                line.append(toTile(i));
+            }
+        }
+        return line;
+    };
+
+    MvtEncoder encoder(m_options.layerName, m_options.extent);
+    for (int feature : candidates) {
+        // GeometryCollection 的成员类型可能不同：按组取类型，点、线、面分别作为一个 MVT 要素
+        QPolygon points;
+        QList<QPolygon> lines;
+        QList<QPolygon> polygons;
+
+        for (int group = m_store->groupBegin(feature); group < m_store->groupEnd(feature); ++group) {
+            switch (m_store->groupType(feature, group)) {
+            case GeometryType::Point:
+            case GeometryType::MultiPoint:
+                for (int i = m_store->coordBegin(m_store->partBegin(group));
+                     i < m_store->coordBegin(m_store->partEnd(group)); ++i) {
+                    const TilePoint p = toTile(i);
+                    if (p.x >= clipMin && p.x <= clipMax && p.y >= clipMin && p.y <= clipMax) {
+                        points.append(QPoint(qRound(p.x), qRound(p.y)));
+                    }
+                }
+                break;
+
+            case GeometryType::LineString:
+            case GeometryType::MultiLineString:
+                for (int part = m_store->partBegin(group); part < m_store->partEnd(group); ++part) {
+                    for (const TileLine& piece : clipLine(collect(part), clipMin, clipMax)) {
+                        const QPolygon line = quantize(piece);
+                        if (line.size() > 1) {
+                            lines.append(line);
+                        }
+                    }
+                }
+                break;
+
+            case GeometryType::Polygon:
+            case GeometryType::MultiPolygon:
+                for (int part = m_store->partBegin(group); part < m_store->partEnd(group); ++part) {
+                    QPolygon ring = quantize(clipRing(collect(part), clipMin, clipMax));
+                    const bool outer = part == m_store->partBegin(group);
+                    const qint64 area = ring.size() >= 4 ? signedArea(ring) : 0;
+                    if (area == 0) {
+                        if (outer) break;   // 外环被裁掉后内环也没有意义
+                        continue;
+                    }
+                    // MVT 要求外环面积为正、内环为负
+                    if ((area > 0) != outer) {
+                        std::reverse(ring.begin(), ring.end());
+                    }
+                    polygons.append(ring);
+                }
+                break;
+
+            case GeometryType::GeometryCollection:
+                break;
+            }
+        }
+
+        if (points.isEmpty() && lines.isEmpty() && polygons.isEmpty()) {
+            continue;
+        }
+        const QVariantMap properties = m_store->properties(feature);
+        const quint64 id = quint64(feature) + 1;
+        if (!points.isEmpty()) {
+            encoder.addFeature(MvtEncoder::Point, { points }, properties, id);
+        }
+        if (!lines.isEmpty()) {
+            encoder.addFeature(MvtEncoder::LineString, lines, properties, id);
+        }
+        if (!polygons.isEmpty()) {
+            encoder.addFeature(MvtEncoder::Polygon, polygons, properties, id);
+        }
+    }
+
+    return encoder.isEmpty() ? QByteArray() : encoder.encode();
+}
+
+} // namespace YEFS
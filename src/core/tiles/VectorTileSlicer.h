@@ -0,0 +1,71 @@
+#ifndef YEFS_VECTORTILESLICER_H
+#define YEFS_VECTORTILESLICER_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <memory>
+
+#include "../FeatureStore.h"
+#include "../SpatialIndex.h"
+#include "ITileProvider.h"
+
+namespace YEFS {
+
+/**
+ * @brief 矢量瓦片切片器
+ *
+ * 按需把 FeatureStore 切成 z/x/y 矢量瓦片（思路同 geojson-vt）：
+ * 坐标预先投影到 Web Mercator，请求瓦片时先用空间索引取出候选要素，
+ * 按顶点重要度抽稀到当前级别半个像素，再裁剪到带缓冲区的瓦片范围，
+ * 最后编码为 MVT。生成的瓦片放入按字节计的 LRU 缓存，tile() 可在多个线程中同时调用。
+ *
+ * 要素存储以只读方式共享，空间索引直接使用数据源已建好的索引（隐式共享，不重建）。
+ * 构造时投影全部坐标（缺少顶点重要度时还要计算），大数据集应在线程池中构造。
+ */
+class VectorTileSlicer : public ITileProvider
+{
+public:
+    struct Options {
+        QString layerName = QStringLiteral("features");
+        int extent = 4096;          // 瓦片坐标范围
+        int buffer = 64;            // 裁剪缓冲区（瓦片坐标）
+        int maxZoom = 14;           // 不再抽稀的级别，更高级别由地图放大显示
+        qint64 cacheBytes = 32 * 1024 * 1024;
+    };
+
+    // index 应为 store 的空间索引；为空或与要素数不符时重新构建
+    VectorTileSlicer(std::shared_ptr<const FeatureStore> store, SpatialIndex index,
+                     const Options& options = Options());
+
+    const Options& options() const { return m_options; }
+    int featureCount() const { return m_store->featureCount(); }
+
+    // MVT 编码的瓦片；瓦片中没有要素或坐标越界时返回空数组
+    QByteArray tile(int z, int x, int y);
+
+    void clearCache();
+
+    // ITileProvider 接口实现
+    QByteArray tileData(int z, int x, int y) override { return tile(z, x, y); }
+    QByteArray contentType() const override { return QByteArrayLiteral("application/x-protobuf"); }
+    QString fileExtension() const override { return QStringLiteral("pbf"); }
+
+private:
+    QByteArray buildTile(int z, int x, int y) const;
+
+    std::shared_ptr<const FeatureStore> m_store;
+    SpatialIndex m_index;
+    QList<double> m_x;              // 归一化 Web Mercator 坐标 [0, 1]
+    QList<double> m_y;
+    Options m_options;
+
+    QMutex m_cacheMutex;
+    QCache<quint64, QByteArray> m_cache;
+};
+
+} // namespace YEFS
+
+#endif // YEFS_VECTORTILESLICER_H
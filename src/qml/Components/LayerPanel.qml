@@ -72,10 +72,60 @@ Rectangle {
             width: parent.width
         }
 
+        // 导入进度
+        Row {
+            width: parent.width
+            height: 28
+            spacing: 8
+            visible: MapSourceManager.importing
+
+            Column {
+                width: parent.width - cancelImportButton.width - 8
+                anchors.verticalCenter: parent.verticalCenter
+                spacing: 4
+
+                HusText {
+                    text: qsTr('正在导入 %1/%2').arg(MapSourceManager.importCompleted).arg(MapSourceManager.importTotal)
+                    font.pixelSize: 12
+                    color: HusTheme.Primary.colorTextSecondary
+                }
+
+                Rectangle {
+                    width: parent.width
+                    height: 4
+                    radius: 2
+                    color: HusTheme.Primary.colorFillPrimary
+
+                    Rectangle {
+                        width: parent.width * MapSourceManager.importProgress
+                        height: parent.height
+                        radius: parent.radius
+                        color: HusTheme.Primary.colorPrimary
+                    }
+                }
+            }
+
+            HusIconButton {
+                id: cancelImportButton
+                width: 28
+                height: 28
+                iconSource: HusIcon.CloseOutlined
+                iconSize: 14
+                type: HusButton.Type_Text
+                anchors.verticalCenter: parent.verticalCenter
+                onClicked: MapSourceManager.cancelImport()
+
+                HusToolTip {
+                    visible: parent.hovered
+                    text: qsTr('取消导入')
+                }
+            }
+        }
+
         // 图层列表
         ScrollView {
             width: parent.width
-            height: parent.height - 100
+            height: parent.height - (MapSourceManager.importing ? 138 : 100)
             clip: true
 
             Column {
@@ -233,12 +283,22 @@ Rectangle {
             }
             
             if (files.length > 0) {
-                let success = MapSourceManager.loadFiles(files)
-                if (success) {
-                    HusApp.showSuccess(qsTr('导入成功'))
-                } else {
-                    HusApp.showError(qsTr('部分文件导入失败'))
-                }
+                // 后台并行导入，结果在 onImportFinished 中提示
+                MapSourceManager.loadFiles(files)
+            }
+        }
+    }
+
+    Connections {
+        target: MapSourceManager
+
+        function onImportFinished(loadedCount, failedFiles, canceled) {
+            if (canceled) {
+                HusApp.showSuccess(qsTr('已取消导入，已导入 %1 个文件').arg(loadedCount))
+            } else if (failedFiles.length === 0) {
+                HusApp.showSuccess(qsTr('导入成功'))
+            } else {
+                HusApp.showError(qsTr('%1 个文件导入失败').arg(failedFiles.length))
             }
         }
     }
@@ -37,6 +37,23 @@ Rectangle {
         zoomLevel: SettingsManager.getValue("map", "defaultZoom", 2)
         coordinate: [39.9042, 116.4074]
 
+        // 相机变化报告给地图引擎，合并后更新在线瓦片的视口优先级与预取
+        function reportCamera() {
+            MapLibreEngine.onViewportSizeChanged(width, height)
+            MapLibreEngine.onCenterChanged(coordinate[0], coordinate[1])
+            MapLibreEngine.onZoomChanged(zoomLevel)
+            MapLibreEngine.onBearingChanged(bearing)
+            MapLibreEngine.onPitchChanged(pitch)
+        }
+
+        Component.onCompleted: reportCamera()
+        onCoordinateChanged: MapLibreEngine.onCenterChanged(coordinate[0], coordinate[1])
+        onZoomLevelChanged: MapLibreEngine.onZoomChanged(zoomLevel)
+        onBearingChanged: MapLibreEngine.onBearingChanged(bearing)
+        onPitchChanged: MapLibreEngine.onPitchChanged(pitch)
+        onWidthChanged: MapLibreEngine.onViewportSizeChanged(width, height)
+        onHeightChanged: MapLibreEngine.onViewportSizeChanged(width, height)
+
         // 地图手势处理
         PinchHandler {
             id: pinch
@@ -229,6 +229,7 @@ HusWindow {
             onClickMenu: function(deep, key, keyPath, data) {
                 if (data) {
                     if (!data.hasOwnProperty('menuChildren')) {
+                        PluginManager.activateForPage(data.source);
                         containerLoader.source = data.source;
                         containerLoader.visible = true;
                         console.debug('onClickMenu', deep, key, keyPath, JSON.stringify(data));
@@ -289,8 +290,10 @@ HusWindow {
                 iconSource: HusIcon.SettingOutlined
                 onClicked: {
                     console.log("[Settings] Button clicked, active:", settingsLoader.active, "visible:", settingsLoader.visible);
-                    if (!settingsLoader.active)
+                    if (!settingsLoader.active) {
+                        PluginManager.activateForPage(settingsLoader.source.toString());
                         settingsLoader.active = true;
+                    }
                     settingsLoader.visible = !settingsLoader.visible;
                     console.log("[Settings] After toggle, visible:", settingsLoader.visible);
                 }
@@ -318,6 +321,8 @@ HusWindow {
                 anchors.fill: parent
                 visible: !settingsLoader.visible
                 source: './Home/MapPage.qml'
+
+                Component.onCompleted: PluginManager.activateForPage(source.toString())
             }
 
             // 设置页面 Loader